@@ -0,0 +1,516 @@
+// fw_bench - host benchmarks of the firmware hot paths (runs main/ code on the sim/ HAL)
+//
+// Build (Linux, one command), LIBS = Arduino libraries folder (ArduinoJson 7, TinyGPSPlus):
+//   g++ -O2 -std=gnu++17 -pthread -DARDUINO=10819 -DARDUINOJSON_ENABLE_PROGMEM=0
+//       -Isim/hal -Imain -I$LIBS/ArduinoJson/src -I$LIBS/TinyGPSPlus/src
+//       bench/fw_bench.cpp main/SdModule.cpp main/GpsModule.cpp main/CanModule.cpp main/TimeManager.cpp
+//       sim/Sim*.cpp $LIBS/TinyGPSPlus/src/TinyGPS++.cpp -o fw_bench
+// Usage:
+//   ./fw_bench [--filter substring] [--min-time-ms 300] [--sd bench_sd] [--nmea track.nmea] > bench.jsonl
+//
+// One JSON object per benchmark on stdout:
+//   {"name":"serialize/tb_writer","iterations":2097152,"ns_per_op":151.2,"ops_per_s":6613756,"bytes_per_op":186,"allocs_per_op":0.00}
+// allocs_per_op counts heap allocations (operator new, malloc, calloc, realloc; glibc) in the timed loop.
+// Pending queue benchmarks count one op per record. Compare runs with any JSON Lines tool
+// (e.g. jq -s 'map({(.name): .ns_per_op}) | add' bench.jsonl).
+
+#include <malloc.h>
+#include <unistd.h>
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <TinyGPSPlus.h>
+#include "SensorData.h"
+#include "SdModule.h"
+#include "GpsModule.h"
+#include "NmeaParser.h"
+#include "CanModule.h"
+#include "CanAggregator.h"
+#include "SensorSlot.h"
+#include "LatencyStats.h"
+#include "TimeManager.h"
+
+SemaphoreHandle_t sdMutex = NULL; // Used by SdModule (main.ino)
+
+static std::string benchFilter;
+static double minTimeNs = 300e6;
+static std::string sdBase = "bench_sd";
+static volatile uint64_t benchSink; // Keeps results alive
+
+// -----------------------------------------------------
+// ------------------ Allocation count -----------------
+// -----------------------------------------------------
+
+// Every heap allocation in the process, counted by the overrides below (glibc's __libc_* do the work)
+static std::atomic<uint64_t> heapAllocs{0};
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size) {
+    heapAllocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+void* calloc(size_t count, size_t size) {
+    heapAllocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+void* realloc(void* ptr, size_t size) {
+    heapAllocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+void free(void* ptr) { __libc_free(ptr); }
+}
+
+void* operator new(size_t size) {
+    heapAllocs.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = __libc_malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* ptr) noexcept { __libc_free(ptr); }
+void operator delete[](void* ptr) noexcept { __libc_free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { __libc_free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { __libc_free(ptr); }
+
+void simFinish(const char* reason) {
+    fprintf(stderr, "[BENCH] Firmware ended the run (%s)\n", reason);
+    fflush(stdout);
+    _exit(1);
+}
+
+static double nowNs() {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool selected(const char* name) {
+    return benchFilter.empty() || strstr(name, benchFilter.c_str());
+}
+
+static void emit(const char* name, uint64_t iterations, double totalNs, double bytesPerOp,
+                 const LatencyHistogram* latency = nullptr, double allocsPerOp = -1) {
+    double nsPerOp = totalNs / iterations;
+    printf("{\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.1f,\"ops_per_s\":%.0f", name,
+           (unsigned long long)iterations, nsPerOp, 1e9 / nsPerOp);
+    if (bytesPerOp > 0) printf(",\"bytes_per_op\":%.0f,\"mb_per_s\":%.2f", bytesPerOp, bytesPerOp * 1e3 / nsPerOp);
+    if (latency) printf(",\"p99_us\":%lu,\"max_us\":%lu", (unsigned long)latency->percentile(99), (unsigned long)latency->maxUs);
+    if (allocsPerOp >= 0) printf(",\"allocs_per_op\":%.2f", allocsPerOp);
+    printf("}\n");
+    fflush(stdout);
+}
+
+// Runs body(n) with growing n until it takes minTimeNs. body returns the bytes produced or
+// consumed per op (0 when not meaningful).
+template <typename F>
+static void bench(const char* name, F body) {
+    if (!selected(name)) return;
+    uint64_t n = 1;
+    for (;;) {
+        uint64_t allocs = heapAllocs.load(std::memory_order_relaxed);
+        double start = nowNs();
+        double bytesPerOp = body(n);
+        double elapsed = nowNs() - start;
+        allocs = heapAllocs.load(std::memory_order_relaxed) - allocs;
+        if (elapsed >= minTimeNs || n >= (1ULL << 32)) {
+            emit(name, n, elapsed, bytesPerOp, nullptr, (double)allocs / n);
+            return;
+        }
+        double scale = elapsed > 0 ? minTimeNs * 1.2 / elapsed : 100;
+        n = (uint64_t)(n * std::min(std::max(scale, 2.0), 100.0));
+    }
+}
+
+static SensorData sampleRecord(uint64_t i) {
+    SensorData d = {};
+    d.ts = 1767225600000ULL + i * 15000;
+    d.ts_source = TIME_GPS;
+    d.lat = 52.2297 + (i % 1000) * 1e-6;
+    d.lon = 21.0122 - (i % 1000) * 1e-6;
+    d.alt = 112.4;
+    d.vel = 36.27;
+    d.temp = 21.5f;
+    d.can_vel = 35.9f;
+    d.can_vel_min = 34.2f;
+    d.can_vel_max = 37.1f;
+    d.can_vel_avg = 35.64f;
+    d.can_vel_n = 1500;
+    d.lgr_ts = d.ts - 120;
+    d.ltr_ts = d.ts - 750;
+    d.lcr_ts = d.ts - 5;
+    d.ec = 0;
+    d.rssi = -61;
+    d.drain_batch = 50;
+    d.drain_gap = 100;
+    d.gps_age = 120;
+    d.temp_age = 750;
+    d.can_age = 5;
+    d.gps_sats = 9;
+    d.gps_hdop = 0.9f;
+    d.gps_fixq = 1;
+    return d;
+}
+
+// -----------------------------------------------------
+// ------------------- Serialisation -------------------
+// -----------------------------------------------------
+
+static void benchSerialisation() {
+    SensorData record = sampleRecord(7);
+    static char buf[1024];
+
+    bench("serialize/tb_json", [&](uint64_t n) {
+        size_t len = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            JsonDocument doc;
+            JsonObject root = doc.to<JsonObject>();
+            sensorDataToTb(record, root);
+            len = serializeJson(doc, buf, sizeof(buf));
+            benchSink += len;
+        }
+        return (double)len;
+    });
+    bench("serialize/sd_json", [&](uint64_t n) {
+        size_t len = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            JsonDocument doc;
+            JsonObject root = doc.to<JsonObject>();
+            sensorDataToSd(record, root);
+            len = serializeJson(doc, buf, sizeof(buf));
+            benchSink += len;
+        }
+        return (double)len;
+    });
+    bench("serialize/tb_writer", [&](uint64_t n) {
+        size_t len = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            JsonWriter out(buf, sizeof(buf));
+            sensorDataWriteTb(record, out);
+            len = out.length();
+            benchSink += len;
+        }
+        return (double)len;
+    });
+    bench("serialize/sd_writer", [&](uint64_t n) {
+        size_t len = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            JsonWriter out(buf, sizeof(buf));
+            sensorDataWriteSd(record, out);
+            len = out.length();
+            benchSink += len;
+        }
+        return (double)len;
+    });
+}
+
+// -----------------------------------------------------
+// ------------------------ CAN ------------------------
+// -----------------------------------------------------
+
+static void benchCan() {
+    CanModule can(21, 22);
+    twai_message_t msg = {};
+    msg.identifier = 0x123;
+    msg.data_length_code = 8;
+    for (int i = 0; i < 8; ++i) msg.data[i] = (uint8_t)(0x11 * (i + 1));
+
+    bench("can/read_signal_be16", [&](uint64_t n) {
+        float sum = 0;
+        for (uint64_t i = 0; i < n; ++i) sum += can.readSignal(msg, 0x123, 0, 16, true, 0.1f);
+        benchSink += (uint64_t)sum;
+        return 0.0;
+    });
+    bench("can/read_signal_le16", [&](uint64_t n) {
+        float sum = 0;
+        for (uint64_t i = 0; i < n; ++i) sum += can.readSignal(msg, 0x123, 16, 16, false, 0.1f);
+        benchSink += (uint64_t)sum;
+        return 0.0;
+    });
+    bench("can/decode_frame", [&](uint64_t n) {
+        CanSignalValues values;
+        values.updated = 0;
+        float sum = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            can.decode(msg, values);
+            sum += values.value[0];
+        }
+        benchSink += (uint64_t)sum + values.updated;
+        return 0.0;
+    });
+    bench("can/aggregate", [&](uint64_t n) {
+        CanAggregator agg;
+        CanSignalValues values;
+        values.updated = CAN_SIGNAL_BIT(vehicle_speed);
+        for (uint64_t i = 0; i < n; ++i) {
+            values.value[CAN_SIG_vehicle_speed] = (float)(i & 1023) * 0.1f;
+            agg.add(values);
+        }
+        CanSignalSummary out[CAN_SIGNAL_COUNT];
+        agg.take(out);
+        benchSink += out[CAN_SIG_vehicle_speed].count;
+        return 0.0;
+    });
+    bench("can/read_signal_other_id", [&](uint64_t n) {
+        float sum = 0;
+        for (uint64_t i = 0; i < n; ++i) sum += can.readSignal(msg, 0x124, 0, 16, true, 0.1f);
+        benchSink += (uint64_t)sum;
+        return 0.0;
+    });
+}
+
+// -----------------------------------------------------
+// ------------------------ GPS ------------------------
+// -----------------------------------------------------
+
+static void benchGps() {
+    // 64 epochs of NMEA per op, pushed through the UART buffer and GpsModule::process()
+    std::string block;
+    for (uint64_t epoch = 0; epoch < 64; ++epoch) block += simNmeaEpoch(epoch);
+
+    // Parser alone on the same stream (--nmea: a recorded log): NmeaParser vs TinyGPSPlus
+    bench("gps/parse_nmea_parser", [&](uint64_t n) {
+        NmeaParser parser;
+        for (uint64_t i = 0; i < n; ++i) {
+            for (char c : block) benchSink += parser.encode(c);
+        }
+        benchSink += parser.fix().lat;
+        return (double)block.size();
+    });
+    bench("gps/parse_tinygps", [&](uint64_t n) {
+        TinyGPSPlus parser;
+        for (uint64_t i = 0; i < n; ++i) {
+            for (char c : block) benchSink += parser.encode(c);
+        }
+        benchSink += (uint64_t)parser.location.lat();
+        return (double)block.size();
+    });
+
+    GpsModule gps(17, 16, 115200);
+    gps.begin();
+    bench("gps/process", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            simGpsFeed(block.data(), block.size());
+            while (gps.available()) benchSink += gps.process();
+        }
+        return (double)block.size();
+    });
+    // What a sensor read costs now that parsing runs on UART events: a copy of the published fix
+    bench("gps/get_data", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) benchSink += gps.getData().satellites;
+        return 0.0;
+    });
+}
+
+// -----------------------------------------------------
+// ----------------------- Time ------------------------
+// -----------------------------------------------------
+
+static void benchTime() {
+    TimeManager::begin(-1);
+    bench("time/timestamp_unsynced", [](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) benchSink += TimeManager::getTimestampMs();
+        return 0.0;
+    });
+    TimeManager::syncTime(1767225600000ULL);
+    bench("time/timestamp_synced", [](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) benchSink += TimeManager::getTimestampMs();
+        return 0.0;
+    });
+    bench("time/timestamp_us", [](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) benchSink += TimeManager::getTimestampUs();
+        return 0.0;
+    });
+}
+
+// -----------------------------------------------------
+// --------------------- Snapshot ----------------------
+// -----------------------------------------------------
+
+// Snapshot assembly while a TaskCAN stand-in publishes the frame time after every frame as fast as it can.
+// "mutex": the former global SensorData + dataSem; "slots": SensorSlot per sensor (main.ino).
+// One op = one snapshot, taken back to back for --min-time-ms; p99_us/max_us from a LatencyHistogram
+// (bucket upper bound, so "2" means under 2 µs).
+static void benchSnapshot() {
+
+    if (selected("snapshot/assemble_mutex_flood")) {
+        static SensorData shared;
+        SemaphoreHandle_t sem = xSemaphoreCreateMutex();
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> frames{0};
+        std::thread flood([&] {
+            for (uint64_t i = 1; !stop.load(std::memory_order_relaxed); ++i) {
+                xSemaphoreTake(sem, portMAX_DELAY);
+                shared.lcr_ts = i;
+                xSemaphoreGive(sem);
+                frames.store(i, std::memory_order_relaxed);
+            }
+        });
+        while (frames.load() < 1000) std::this_thread::yield();
+        uint64_t snapshots = 0;
+        static LatencyHistogram latency;
+        latency.reset();
+        double start = nowNs();
+        for (double t = start; t - start < minTimeNs; snapshots++) {
+            xSemaphoreTake(sem, portMAX_DELAY);
+            shared.ts = snapshots;
+            SensorData snapshot = shared;
+            xSemaphoreGive(sem);
+            benchSink += snapshot.lcr_ts;
+            double end = nowNs();
+            latency.record((uint32_t)((end - t) / 1000));
+            t = end;
+        }
+        double elapsed = nowNs() - start;
+        stop = true;
+        flood.join();
+        emit("snapshot/assemble_mutex_flood", snapshots, elapsed, 0, &latency);
+        fprintf(stderr, "[BENCH] mutex flood: %.1f M frames published\n", frames.load() / 1e6);
+        vSemaphoreDelete(sem);
+    }
+
+    if (selected("snapshot/assemble_slots_flood")) {
+        static SensorSlot<GpsSample> gpsLatest;
+        static SensorSlot<TempSample> tempLatest;
+        static SensorSlot<CanSample> canLatest;
+        GpsSample gps = {};
+        gps.lat = 52.2297;
+        gps.fix = true;
+        gpsLatest.publish(gps);
+        TempSample temp = {};
+        temp.temp = 21.5f;
+        temp.ok = true;
+        tempLatest.publish(temp);
+
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> frames{0};
+        std::thread flood([&] {
+            CanSample sample;
+            for (uint64_t i = 1; !stop.load(std::memory_order_relaxed); ++i) {
+                sample.frameTs = i;
+                canLatest.publish(sample);
+                frames.store(i, std::memory_order_relaxed);
+            }
+        });
+        while (frames.load() < 1000) std::this_thread::yield();
+        SensorData data = {};
+        uint64_t snapshots = 0;
+        static LatencyHistogram latency;
+        latency.reset();
+        double start = nowNs();
+        for (double t = start; t - start < minTimeNs; snapshots++) {
+            CanSample lastFrame;
+            if (gpsLatest.read(gps)) data.lat = gps.lat;
+            if (tempLatest.read(temp)) data.temp = temp.temp;
+            if (canLatest.read(lastFrame)) data.lcr_ts = lastFrame.frameTs;
+            data.ts = snapshots;
+            SensorData snapshot = data;
+            benchSink += snapshot.lcr_ts;
+            double end = nowNs();
+            latency.record((uint32_t)((end - t) / 1000));
+            t = end;
+        }
+        double elapsed = nowNs() - start;
+        stop = true;
+        flood.join();
+        emit("snapshot/assemble_slots_flood", snapshots, elapsed, 0, &latency);
+        fprintf(stderr, "[BENCH] slots flood: %.1f M frames published\n", frames.load() / 1e6);
+    }
+}
+
+// -----------------------------------------------------
+// ------------------- Pending queue -------------------
+// -----------------------------------------------------
+
+static void benchPending(int records) {
+    char name[64];
+    bool writeCase = selected((snprintf(name, sizeof(name), "pending/write_%d", records), name));
+    bool readCase = selected((snprintf(name, sizeof(name), "pending/first_batch_%d", records), name));
+    bool drainCase = selected((snprintf(name, sizeof(name), "pending/drain_%d", records), name));
+    if (!writeCase && !readCase && !drainCase) return;
+
+    simConfig.sdRoot = sdBase + "/pending_" + std::to_string(records);
+    std::filesystem::remove_all(simConfig.sdRoot);
+    SdModule* sd = new SdModule(5);
+    sd->setFlushPolicy(16384, 5000);
+    if (!sd->ensureReady(true)) {
+        fprintf(stderr, "[BENCH] SD init failed in %s\n", simConfig.sdRoot.c_str());
+        return;
+    }
+
+    // Append in groups of 64 records, like TaskSdWriter
+    const int group = 64;
+    std::vector<SensorData> batch(group);
+    double start = nowNs();
+    for (int i = 0; i < records; i += group) {
+        int count = std::min(group, records - i);
+        for (int j = 0; j < count; ++j) batch[j] = sampleRecord(i + j);
+        sd->logToPending(batch.data(), count);
+        sd->flushIfDue();
+    }
+    sd->flush();
+    if (writeCase) emit((snprintf(name, sizeof(name), "pending/write_%d", records), name), records, nowNs() - start, 0);
+
+    static char payload[16384];
+    size_t length = 0;
+    PendingCursor next;
+
+    // Latency of the first backlog batch with the whole queue pending (one op = one batch)
+    if (readCase) {
+        int reps = 200;
+        start = nowNs();
+        for (int i = 0; i < reps; ++i) benchSink += sd->readPendingBatch(payload, sizeof(payload), 50, length, next);
+        emit((snprintf(name, sizeof(name), "pending/first_batch_%d", records), name), reps, nowNs() - start, length);
+    }
+
+    // Full drain: read 50-record batches and commit the cursor behind each one
+    if (drainCase) {
+        int drained = 0;
+        start = nowNs();
+        for (;;) {
+            int count = sd->readPendingBatch(payload, sizeof(payload), 50, length, next);
+            if (count == 0) break;
+            sd->commitPendingCursor(next);
+            drained += count;
+        }
+        double elapsed = nowNs() - start;
+        if (drained != records) fprintf(stderr, "[BENCH] Drained %d of %d records\n", drained, records);
+        emit((snprintf(name, sizeof(name), "pending/drain_%d", records), name), drained ? drained : 1, elapsed, 0);
+    }
+    delete sd;
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--filter") benchFilter = argv[i + 1];
+        else if (arg == "--min-time-ms") minTimeNs = atof(argv[i + 1]) * 1e6;
+        else if (arg == "--sd") sdBase = argv[i + 1];
+        else if (arg == "--nmea") simConfig.nmeaFile = argv[i + 1];
+        else {
+            fprintf(stderr, "usage: fw_bench [--filter substring] [--min-time-ms N] [--sd DIR] [--nmea FILE]\n");
+            return 2;
+        }
+    }
+
+    simConfig.speed = 1.0; // millis() is real time
+    simConfig.quiet = true; // Firmware Serial output
+    simClockStart();
+    sdMutex = xSemaphoreCreateMutex();
+    std::filesystem::create_directories(sdBase);
+
+    benchSerialisation();
+    benchCan();
+    benchGps();
+    benchTime();
+    benchSnapshot();
+    for (int records : {1000, 10000, 100000}) benchPending(records);
+    return 0;
+}
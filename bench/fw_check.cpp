@@ -0,0 +1,601 @@
+// fw_check - host checks of firmware code paths (runs main/ code on the sim/ HAL)
+//
+// Build (Linux, one command), LIBS = Arduino libraries folder (ArduinoJson 7):
+//   g++ -O2 -std=gnu++17 -pthread -DARDUINO=10819 -DARDUINOJSON_ENABLE_PROGMEM=0
+//       -Isim/hal -Imain -I$LIBS/ArduinoJson/src
+//       bench/fw_check.cpp main/SdModule.cpp main/GpsModule.cpp main/TimeManager.cpp sim/Sim*.cpp -o fw_check
+// Usage:
+//   ./fw_check [--filter substring] [--sd check_sd]
+//
+// Prints one line per failed expectation and a summary per check; exits with 1 if anything failed.
+
+#include <unistd.h>
+#include <cmath>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include "SensorData.h"
+#include "ArchiveCodec.h"
+#include "JsonWriter.h"
+#include "SdModule.h"
+#include "GpsModule.h"
+#include "GpsTrack.h"
+#include "SnapshotBuffer.h"
+
+SemaphoreHandle_t sdMutex = NULL; // Used by SdModule (main.ino)
+
+static std::string checkFilter;
+static std::string sdBase = "check_sd";
+static int failures = 0;
+
+void simFinish(const char* reason) {
+    fprintf(stderr, "[CHECK] Firmware ended the run (%s)\n", reason);
+    _exit(1);
+}
+
+#define EXPECT(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            failures++; \
+            printf("  FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    } while (0)
+
+// Runs body() if selected by --filter and prints its result
+template <typename F>
+static void check(const char* name, F body) {
+    if (!checkFilter.empty() && !strstr(name, checkFilter.c_str())) return;
+    int before = failures;
+    body();
+    printf("%s %s\n", failures == before ? "ok  " : "FAIL", name);
+    fflush(stdout);
+}
+
+// Float fields equal after quantisation (NaN only matches NaN)
+static bool sameQuantized(double a, double b, double step) {
+    if (std::isnan(a) || std::isnan(b)) return std::isnan(a) && std::isnan(b);
+    return fabs(a - b) <= step / 2;
+}
+
+// -----------------------------------------------------
+// ------------------- Binary archive ------------------
+// -----------------------------------------------------
+
+static void checkArchive() {
+    check("archive/nan_round_trip", [] {
+        // CAN summaries are NaN while no frame arrived; neighbours of a null field must stay exact
+        SensorData in[6] = {};
+        for (int i = 0; i < 6; ++i) {
+            in[i].ts = 1767225600000ULL + i * 15000;
+            in[i].lat = 52.2297 + i * 1e-5;
+            in[i].temp = 21.5f + i;
+            in[i].can_vel = 35.9f;
+            in[i].can_vel_min = 34.2f;
+            in[i].can_vel_max = 37.1f;
+            in[i].can_vel_avg = 35.64f;
+            in[i].can_vel_n = 100 + i;
+            in[i].lcr_ts = in[i].ts - 5;
+            in[i].rssi = -61;
+        }
+        for (int i : {1, 2, 4}) {
+            in[i].can_vel = NAN;
+            in[i].can_vel_min = NAN;
+            in[i].can_vel_max = NAN;
+            in[i].can_vel_avg = NAN;
+            in[i].can_vel_n = 0;
+        }
+        in[4].lat = NAN;
+        in[5].alt = INFINITY; // Not representable in JSON either: stored as null
+
+        uint8_t payload[sizeof(in) / sizeof(in[0]) * ARCHIVE_MAX_RECORD_SIZE];
+        SensorData zero = {};
+        size_t len = 0;
+        for (int i = 0; i < 6; ++i) {
+            len += archiveEncodeRecord(in[i], i ? in[i - 1] : zero, payload + len);
+            EXPECT(len <= (size_t)(i + 1) * ARCHIVE_MAX_RECORD_SIZE, "record %d over ARCHIVE_MAX_RECORD_SIZE", i);
+        }
+
+        size_t pos = 0;
+        SensorData prev = zero, out;
+        for (int i = 0; i < 6; ++i) {
+            EXPECT(archiveDecodeRecord(payload, len, pos, prev, out), "record %d truncated", i);
+            EXPECT(out.ts == in[i].ts, "record %d ts %llu", i, (unsigned long long)out.ts);
+            EXPECT(sameQuantized(out.lat, in[i].lat, 1e-7), "record %d lat %.9f", i, out.lat);
+            EXPECT(i == 5 ? std::isnan(out.alt) : sameQuantized(out.alt, in[i].alt, 1e-7), "record %d alt %f", i, out.alt);
+            EXPECT(sameQuantized(out.temp, in[i].temp, 1e-4), "record %d temp %f", i, out.temp);
+            EXPECT(sameQuantized(out.can_vel, in[i].can_vel, 1e-4), "record %d can_vel %f", i, out.can_vel);
+            EXPECT(sameQuantized(out.can_vel_min, in[i].can_vel_min, 1e-4), "record %d can_vel_min %f", i, out.can_vel_min);
+            EXPECT(sameQuantized(out.can_vel_max, in[i].can_vel_max, 1e-4), "record %d can_vel_max %f", i, out.can_vel_max);
+            EXPECT(sameQuantized(out.can_vel_avg, in[i].can_vel_avg, 1e-4), "record %d can_vel_avg %f", i, out.can_vel_avg);
+            EXPECT(out.can_vel_n == in[i].can_vel_n, "record %d can_vel_n %d", i, out.can_vel_n);
+            EXPECT(out.lcr_ts == in[i].lcr_ts, "record %d lcr_ts", i);
+            EXPECT(out.rssi == in[i].rssi, "record %d rssi %d", i, out.rssi);
+            prev = out;
+        }
+        EXPECT(pos == len, "%zu of %zu bytes decoded", pos, len);
+
+        SensorData worst = {};
+        worst.ts = UINT64_MAX;
+        worst.lat = -1e300;
+        EXPECT(archiveEncodeRecord(worst, zero, payload) <= ARCHIVE_MAX_RECORD_SIZE, "worst case record too large");
+    });
+}
+
+// -----------------------------------------------------
+// ----------------- Number formatting -----------------
+// -----------------------------------------------------
+
+template <typename T>
+static void expectJson(T value, const char* expected, int line) {
+    char buf[64];
+    JsonWriter out(buf, sizeof(buf));
+    out.value(value);
+    if (strcmp(buf, expected) != 0) {
+        failures++;
+        printf("  FAIL %s:%d: %s %.17g -> \"%s\", expected \"%s\"\n", __FILE__, line,
+               sizeof(T) >= 8 ? "double" : "float", (double)value, buf, expected);
+    }
+}
+
+static void checkJson() {
+    // Expected text is what ArduinoJson 7 serializeJson() prints for the same value (float converted
+    // to double, binary power-of-ten normalisation, 9/6 decimal places, half-up carry, zeros dropped)
+    check("json/float_edges", [] {
+        expectJson(0.0, "0", __LINE__);
+        expectJson(-0.0, "0", __LINE__);  // value < 0.0 is false for -0
+        expectJson(-0.0f, "0", __LINE__);
+        expectJson(NAN, "null", __LINE__);
+        expectJson(-INFINITY, "null", __LINE__);
+        expectJson((float)NAN, "null", __LINE__);
+
+        expectJson(9999999.0, "9999999", __LINE__); // Below the 1e7 exponent threshold
+        expectJson(1e7, "1e7", __LINE__);
+        expectJson(1e7f, "1e7", __LINE__);
+        expectJson(9999999.0f, "9999999", __LINE__);
+        expectJson(12345678.9, "1.23456789e7", __LINE__);
+        expectJson(1.5e300, "1.5e300", __LINE__);
+
+        expectJson(1e-5, "1e-5", __LINE__);         // At the negative threshold
+        expectJson(1e-5f, "1e-5", __LINE__);        // 9.99999974e-6 as double, rounds up with carry
+        expectJson(0.000012, "0.000012", __LINE__); // Above it: plain decimals
+        expectJson(2.5e-7, "2.5e-7", __LINE__);
+
+        expectJson(9.9999999999, "10", __LINE__);    // Rounding carry into the integral part
+        expectJson(9.9999999999e7, "1e8", __LINE__); // ... and into the exponent
+        expectJson(0.9999996f, "1", __LINE__);
+        expectJson(0.5f, "0.5", __LINE__);
+
+        expectJson(0.1f, "0.1", __LINE__);          // 0.100000001 as double, 6 places
+        expectJson(35.64f, "35.64", __LINE__);      // 35.6399994 as double
+        expectJson(21.5f, "21.5", __LINE__);
+        expectJson(-52.2297, "-52.2297", __LINE__);
+        expectJson(52.2314491, "52.2314491", __LINE__);
+        expectJson(4294967295.0, "4.294967295e9", __LINE__);
+    });
+}
+
+// -----------------------------------------------------
+// --------------------- Time index --------------------
+// -----------------------------------------------------
+
+// True if 'offset' is the start of a JSON line of the file
+static bool isLineStart(const std::string &path, uint32_t offset) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    char head[8] = {};
+    bool ok = true;
+    if (offset > 0) {
+        fseek(f, offset - 1, SEEK_SET);
+        ok = fgetc(f) == '\n';
+    }
+    fseek(f, offset, SEEK_SET);
+    ok = ok && fread(head, 1, 6, f) == 6 && memcmp(head, "{\"ts\":", 6) == 0;
+    fclose(f);
+    return ok;
+}
+
+static void checkIndex() {
+    check("index/missing_sidecar", [] {
+        // An archive copied in without .idx: web lookups stay within a bounded window, then the
+        // writer task rebuilds the sidecar a slice at a time
+        simConfig.sdRoot = sdBase + "/index";
+        std::filesystem::remove_all(simConfig.sdRoot);
+        std::filesystem::create_directories(simConfig.sdRoot);
+        std::string oldPath = simConfig.sdRoot + "/LOG_20260101_000000.jsonl";
+        FILE* f = fopen(oldPath.c_str(), "wb");
+        const uint64_t t0 = 1767225600000ULL;
+        const int records = 6000; // 15 s apart, about 25 h and 800 KB
+        for (int i = 0; i < records; ++i) {
+            fprintf(f, "{\"ts\":%llu,\"lat\":52.2297,\"lon\":21.0122,\"alt\":100.5,\"temp\":21.5,\"pad\":\"%0*d\"}\r\n",
+                    (unsigned long long)(t0 + i * 15000ULL), 60 + i % 40, i);
+        }
+        fclose(f);
+        uint32_t oldSize = std::filesystem::file_size(oldPath);
+        f = fopen((simConfig.sdRoot + "/LOG_20260102_010000.jsonl").c_str(), "wb"); // Latest, left alone
+        fprintf(f, "{\"ts\":%llu,\"lat\":52.23}\r\n", (unsigned long long)(t0 + records * 15000ULL));
+        fclose(f);
+
+        SdModule sd(5);
+        EXPECT(sd.ensureReady(true), "SD init failed in %s", simConfig.sdRoot.c_str());
+
+        std::vector<ArchiveSpan> spans;
+        sd.findArchiveSpans(t0 + 3600000, t0 + 7200000, spans);
+        EXPECT(spans.size() == 1 && spans[0].start == 0 && spans[0].end == oldSize,
+               "unindexed file not returned whole (%zu spans)", spans.size());
+
+        // Backwards steps are one window each and land on line starts
+        uint32_t before = oldSize, offset = 0;
+        int steps = 0;
+        while (before > 0 && sd.previousIndexOffset("/LOG_20260101_000000.jsonl", before, offset)) {
+            EXPECT(offset < before && before - offset <= 8192, "step %u -> %u", before, offset);
+            EXPECT(offset == 0 || isLineStart(oldPath, offset), "offset %u is not a line start", offset);
+            if (offset >= before) break;
+            before = offset;
+            steps++;
+        }
+        EXPECT(before == 0, "backward walk stopped at %u after %d steps", before, steps);
+
+        int wakeups = 0;
+        while (!std::filesystem::exists(simConfig.sdRoot + "/LOG_20260101_000000.idx") && wakeups < 1000) {
+            sd.rebuildIndexStep();
+            wakeups++;
+        }
+        EXPECT(wakeups > 1 && wakeups < 1000, "index built in %d wakeups", wakeups);
+        EXPECT(!std::filesystem::exists(simConfig.sdRoot + "/LOG_20260102_010000.idx"), "latest archive indexed");
+        EXPECT(!std::filesystem::exists(simConfig.sdRoot + "/LOG_20260101_000000.idt"), "temporary index left");
+
+        FILE* idx = fopen((simConfig.sdRoot + "/LOG_20260101_000000.idx").c_str(), "rb");
+        uint8_t entry[12];
+        uint64_t lastTs = 0;
+        int entries = 0;
+        while (idx && fread(entry, 1, sizeof(entry), idx) == sizeof(entry)) {
+            uint64_t ts;
+            uint32_t at;
+            memcpy(&ts, entry, 8);
+            memcpy(&at, entry + 8, 4);
+            EXPECT(ts >= lastTs + 60000 || entries == 0, "entry %d ts %llu", entries, (unsigned long long)ts);
+            EXPECT(isLineStart(oldPath, at), "entry %d offset %u", entries, at);
+            lastTs = ts;
+            entries++;
+        }
+        if (idx) fclose(idx);
+        EXPECT(entries == records / 4, "%d index entries", entries);
+
+        sd.findArchiveSpans(t0 + 3600000, t0 + 7200000, spans);
+        EXPECT(spans.size() == 1 && spans[0].start > 0 && spans[0].end - spans[0].start < oldSize / 20,
+               "indexed span not narrowed");
+    });
+
+    check("index/framed_fallback", [] {
+        // Binary and compressed archives without .idx: backward steps land on frame headers
+        for (ArchiveFormat format : {ARCHIVE_BINARY, ARCHIVE_JSONL_LZ}) {
+            simConfig.sdRoot = sdBase + "/index_framed";
+            std::filesystem::remove_all(simConfig.sdRoot);
+            std::filesystem::create_directories(simConfig.sdRoot);
+            SdModule sd(5);
+            sd.setArchiveFormat(format);
+            std::string path = simConfig.sdRoot + (format == ARCHIVE_BINARY ? "/LOG_20260101_000000.bin" : "/LOG_20260101_000000.lz");
+            fclose(fopen(path.c_str(), "wb")); // Reused by logToArchive (no clock needed for a name)
+            EXPECT(sd.ensureReady(true), "SD init failed in %s", simConfig.sdRoot.c_str());
+
+            SensorData batch[16] = {};
+            for (int i = 0; i < 4000; i += 16) {
+                for (int j = 0; j < 16; ++j) {
+                    batch[j].ts = 1767225600000ULL + (i + j) * 15000ULL;
+                    batch[j].lat = 52.2297 + (i + j) * 1e-5;
+                    batch[j].lon = 21.0122;
+                    batch[j].temp = 21.5f;
+                }
+                sd.logToArchive(batch, 16);
+            }
+            sd.flush();
+            String name = path.substr(simConfig.sdRoot.size()).c_str();
+            std::string idxPath = path.substr(0, path.rfind('.')) + ".idx";
+            EXPECT(std::filesystem::remove(idxPath), "format %d wrote no %s", format, idxPath.c_str());
+
+            std::vector<uint8_t> data(std::filesystem::file_size(path));
+            FILE* f = fopen(path.c_str(), "rb");
+            size_t got = f ? fread(data.data(), 1, data.size(), f) : 0;
+            if (f) fclose(f);
+            EXPECT(got == data.size() && data.size() > 8192 * 4, "format %d archive %zu bytes", format, data.size());
+
+            uint32_t before = data.size(), offset = 0;
+            int steps = 0;
+            while (before > 0 && steps < 10000) {
+                if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+                bool found = sd.previousIndexOffset(name, before, offset);
+                if (sdMutex) xSemaphoreGive(sdMutex);
+                if (!found) break;
+                EXPECT(offset < before && before - offset <= 8192, "format %d step %u -> %u", format, before, offset);
+                EXPECT(offset == 0 || data[offset] == LOG_FRAME_MAGIC, "format %d offset %u is not a frame", format, offset);
+                if (offset >= before) break;
+                before = offset;
+                steps++;
+            }
+            EXPECT(before == 0, "format %d backward walk stopped at %u", format, before);
+        }
+    });
+}
+
+// -----------------------------------------------------
+// ------------------- Pending queue -------------------
+// -----------------------------------------------------
+
+static SensorData pendingRecord(uint64_t i) {
+    SensorData d = {};
+    d.ts = 1767225600000ULL + i * 15000;
+    d.lat = 52.2297 + (i % 1000) * 1e-6;
+    d.lon = 21.0122;
+    d.temp = 21.5f;
+    d.can_vel_n = (int)i;
+    d.rssi = -61;
+    return d;
+}
+
+// Next record index from a "[{"ts":...},...]" payload, -1 at the end
+static long long nextPayloadRecord(const char* &p) {
+    p = strstr(p, "{\"ts\":");
+    if (!p) return -1;
+    p += 6;
+    return (long long)((strtoull(p, nullptr, 10) - 1767225600000ULL) / 15000);
+}
+
+static void checkPending() {
+    check("pending/replay_100k", [] {
+        // 100k-record backlog through the queue log: power loss with a torn frame at the tail,
+        // reboots with an unacknowledged batch and with a committed cursor. Every record must
+        // come out once, in order, and acknowledged ones never again.
+        const int records = 100000;
+        const int tornAt = 60000;
+        simConfig.sdRoot = sdBase + "/replay";
+        std::filesystem::remove_all(simConfig.sdRoot);
+        std::string queue = simConfig.sdRoot + "/queue";
+
+        SdModule* sd = new SdModule(5);
+        EXPECT(sd->ensureReady(true), "SD init failed in %s", simConfig.sdRoot.c_str());
+        SensorData batch[64];
+        for (int i = 0; i < records; i += 64) {
+            if (i == tornAt) {
+                // Power loss mid-write: half a frame at the end of the tail segment, then reboot
+                sd->flush();
+                delete sd;
+                std::string tail;
+                for (auto &e : std::filesystem::directory_iterator(queue)) {
+                    if (e.path().extension() == ".seg" && e.path().string() > tail) tail = e.path().string();
+                }
+                const char torn[] = "\xA5\x00\x2C\x01\x12\x34\x56\x78{\"ts\":1767225600000,\"values\":{\"lat\":52.2";
+                FILE* f = fopen(tail.c_str(), "ab");
+                fwrite(torn, 1, sizeof(torn) - 1, f);
+                fclose(f);
+                sd = new SdModule(5);
+                EXPECT(sd->ensureReady(true), "remount after power loss");
+            }
+            int count = std::min(64, records - i);
+            for (int j = 0; j < count; ++j) batch[j] = pendingRecord(i + j);
+            EXPECT(sd->logToPending(batch, count), "append at record %d", i);
+            sd->flushIfDue();
+        }
+        sd->flush();
+
+        static char payload[16384];
+        size_t length = 0;
+        PendingCursor next;
+        long long expected = 0;
+        bool rebootedUnacked = false, rebootedAcked = false;
+        int batches = 0;
+        for (;;) {
+            int count = sd->readPendingBatch(payload, sizeof(payload), 300, length, next);
+            if (count == 0) break;
+            payload[length] = 0;
+
+            const char* p = payload;
+            long long got;
+            int parsed = 0;
+            while ((got = nextPayloadRecord(p)) >= 0) {
+                if (got != expected) {
+                    EXPECT(got == expected, "batch %d: record %lld, expected %lld", batches, got, expected);
+                    expected = got; // Report the first gap only
+                }
+                expected++;
+                parsed++;
+            }
+            EXPECT(parsed == count, "batch %d: %d records in payload, %d reported", batches, parsed, count);
+
+            if (!rebootedUnacked && expected > records / 4) {
+                // Reboot before the ack: the batch is read again from the saved cursor
+                rebootedUnacked = true;
+                expected -= count;
+                delete sd;
+                sd = new SdModule(5);
+                EXPECT(sd->ensureReady(true), "remount with unacknowledged batch");
+                continue;
+            }
+            EXPECT(sd->commitPendingCursor(next), "commit after record %lld", expected);
+            batches++;
+
+            if (!rebootedAcked && expected > records / 2) {
+                // Reboot after the ack: the cursor is reloaded, nothing acknowledged comes back
+                rebootedAcked = true;
+                delete sd;
+                sd = new SdModule(5);
+                EXPECT(sd->ensureReady(true), "remount with committed cursor");
+            }
+        }
+        EXPECT(expected == records, "drained %lld of %d records", expected, records);
+        EXPECT(rebootedUnacked && rebootedAcked, "reboots not exercised");
+
+        // Acknowledging is a 12-byte cursor write; drained segments are deleted
+        std::error_code error;
+        EXPECT(std::filesystem::file_size(queue + "/cursor.bin", error) == 12, "cursor file size");
+        int segments = 0;
+        for (auto &e : std::filesystem::directory_iterator(queue)) segments += e.path().extension() == ".seg";
+        EXPECT(segments <= 1, "%d segments left after the drain", segments);
+        delete sd;
+    });
+}
+
+// -----------------------------------------------------
+// ------------------ Snapshot Buffer ------------------
+// -----------------------------------------------------
+
+static void checkSnapshot() {
+    check("snapshot/shrink_during_stall", [] {
+        // BUFFER_CAPACITY shrink while the SD writer cannot spill: nothing is dropped, the shrink waits
+        SnapshotBuffer buffer;
+        EXPECT(buffer.begin(60), "begin");
+        SensorData rec = {};
+        for (int i = 0; i < 60; ++i) {
+            rec.ts = i;
+            EXPECT(buffer.push(rec), "push %d reported overflow", i);
+        }
+
+        buffer.requestCapacity(10);
+        EXPECT(buffer.capacityPending() && buffer.overflow() == 50, "overflow %d", buffer.overflow());
+        EXPECT(!buffer.applyCapacity() && buffer.capacity() == 60, "shrink applied before the spill");
+
+        SensorData spill[SNAPSHOT_SPILL_SLACK];
+        int count = buffer.takeOverflow(spill, SNAPSHOT_SPILL_SLACK);
+        buffer.spillDone(spill, count, 0); // SD write failed: back to the front
+        EXPECT(buffer.size() == 60 && buffer.lost() == 0, "size %d lost %u after a failed spill", buffer.size(), buffer.lost());
+
+        uint64_t nextTs = 0;
+        while ((count = buffer.takeOverflow(spill, SNAPSHOT_SPILL_SLACK)) > 0) {
+            for (int i = 0; i < count; ++i) EXPECT(spill[i].ts == nextTs++, "spilled ts %llu", (unsigned long long)spill[i].ts);
+            buffer.spillDone(spill, count, count);
+        }
+        EXPECT(buffer.applyCapacity() && buffer.capacity() == 10 && !buffer.capacityPending(), "shrink not applied");
+        EXPECT(buffer.spilled() == 50 && buffer.lost() == 0, "spilled %u lost %u", buffer.spilled(), buffer.lost());
+
+        // Pushes over the capacity never wait: the slack holds them, then the oldest is lost
+        for (int i = 0; i < SNAPSHOT_SPILL_SLACK + 1; ++i) {
+            rec.ts = 60 + i;
+            EXPECT(!buffer.push(rec), "push %d over capacity not reported", i);
+        }
+        EXPECT(buffer.overflow() == SNAPSHOT_SPILL_SLACK && buffer.lost() == 1,
+               "overflow %d lost %u", buffer.overflow(), buffer.lost());
+
+        SensorData out[64];
+        int popped = buffer.pop(out, 64);
+        EXPECT(popped == 10 + SNAPSHOT_SPILL_SLACK, "popped %d", popped);
+        for (int i = 0; i < popped; ++i) {
+            EXPECT(out[i].ts == nextTs + 1 + i, "popped ts %llu", (unsigned long long)out[i].ts); // Oldest (50) lost
+        }
+    });
+}
+
+// -----------------------------------------------------
+// --------------------- GPS track ---------------------
+// -----------------------------------------------------
+
+static void nmeaSentence(std::string &out, const char* body) {
+    uint8_t sum = 0;
+    for (const char* c = body; *c; ++c) sum ^= (uint8_t)*c;
+    char tail[8];
+    snprintf(tail, sizeof(tail), "*%02X\r\n", sum);
+    out += "$";
+    out += body;
+    out += tail;
+}
+
+static void checkTrack() {
+    check("track/replay_10hz", [] {
+        // 90 s of 10 Hz GGA + RMC epochs through GpsModule (NmeaParser, epoch assembly) into the ring,
+        // drained in blocks as TaskSdWriter does; the decoded blocks must hold every fix, 100 ms apart
+        const int epochs = 900;
+        const uint64_t startMs = 1767268800000ULL; // 2026-01-01 12:00:00 UTC
+        simGpsFeed("", 0); // Bytes come from this check only, no synthetic receiver
+        GpsModule gps(17, 16, 115200);
+        gps.begin();
+        GpsTrackRing ring;
+        gps.setTrackMode(10, &ring);
+
+        std::vector<std::vector<uint8_t>> blocks;
+        GpsTrackFix fixes[GPS_TRACK_BLOCK_FIXES];
+        auto drain = [&](uint32_t min) {
+            while (ring.size() >= min) {
+                int count = ring.pop(fixes, GPS_TRACK_BLOCK_FIXES);
+                std::vector<uint8_t> block(GPS_TRACK_BLOCK_SIZE);
+                block.resize(gpsTrackEncodeBlock(fixes, count, block.data()));
+                blocks.push_back(block);
+            }
+        };
+
+        for (int i = 0; i < epochs; ++i) {
+            uint64_t ms = startMs + (uint64_t)i * 100;
+            uint32_t sec = (uint32_t)(ms / 1000 % 86400);
+            char hms[16], lat[24], body[128];
+            snprintf(hms, sizeof(hms), "%02u%02u%02u.%02u", sec / 3600, sec / 60 % 60, sec % 60, (unsigned)(ms % 1000 / 10));
+            snprintf(lat, sizeof(lat), "52%08.5f", 13.782 + i * 0.0006); // 1e-5 degrees per fix
+            std::string epoch;
+            snprintf(body, sizeof(body), "GPGGA,%s,%s,N,02100.73200,E,1,09,0.9,112.0,M,33.9,M,,", hms, lat);
+            nmeaSentence(epoch, body);
+            snprintf(body, sizeof(body), "GPRMC,%s,A,%s,N,02100.73200,E,19.44,90.0,010126,,,A", hms, lat);
+            nmeaSentence(epoch, body);
+            simGpsFeed(epoch.data(), epoch.size());
+            while (gps.available()) gps.process();
+            drain(GPS_TRACK_BLOCK_FIXES);
+        }
+        gps.setTrackMode(0, &ring); // Pushes the last epoch
+        drain(1);
+        EXPECT(ring.dropped() == 0, "%u fixes dropped", ring.dropped());
+
+        // Decode: [base_ms:8] then [dt_ms:4][lat:4]... per fix
+        auto get = [](const uint8_t* p, int bytes) {
+            uint64_t v = 0;
+            for (int i = 0; i < bytes; i++) v |= (uint64_t)p[i] << (8 * i);
+            return v;
+        };
+        // Each fix 100 ms and 1e-5 degrees after the one before (the first one at the start of the stream)
+        int total = 0, gaps = 0;
+        uint64_t previousMs = startMs - 100;
+        int32_t previousLat = 522297000 - 100;
+        for (const std::vector<uint8_t> &block : blocks) {
+            EXPECT((block.size() - GPS_TRACK_BLOCK_HEADER) % GPS_TRACK_RECORD_SIZE == 0, "block length %zu", block.size());
+            uint64_t base = get(block.data(), 8);
+            for (size_t at = GPS_TRACK_BLOCK_HEADER; at + GPS_TRACK_RECORD_SIZE <= block.size(); at += GPS_TRACK_RECORD_SIZE) {
+                uint64_t ms = base + get(&block[at], 4);
+                int32_t lat = (int32_t)get(&block[at + 4], 4);
+                if (ms - previousMs != 100 || abs(lat - previousLat - 100) > 2) {
+                    EXPECT(++gaps > 3, "fix %d: dt %lld ms, lat step %d", total, (long long)(ms - previousMs), lat - previousLat);
+                }
+                previousMs = ms;
+                previousLat = lat;
+                total++;
+            }
+        }
+        EXPECT(total == epochs, "%d fixes decoded, expected %d", total, epochs);
+        EXPECT(gaps == 0, "%d fixes not 100 ms after the previous one", gaps);
+    });
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--filter") checkFilter = argv[i + 1];
+        else if (arg == "--sd") sdBase = argv[i + 1];
+        else {
+            fprintf(stderr, "usage: fw_check [--filter substring] [--sd DIR]\n");
+            return 2;
+        }
+    }
+
+    simConfig.speed = 1.0; // millis() is real time
+    simConfig.quiet = true; // Firmware Serial output
+    simClockStart();
+    sdMutex = xSemaphoreCreateMutex();
+    std::filesystem::create_directories(sdBase);
+
+    checkArchive();
+    checkJson();
+    checkIndex();
+    checkPending();
+    checkSnapshot();
+    checkTrack();
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
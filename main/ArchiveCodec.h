@@ -0,0 +1,90 @@
+#pragma once
+#include <Arduino.h>
+#include "SensorData.h"
+#include "ArchiveSchema.h"
+#include "LogFrame.h"
+#include "ArchiveLz.h"
+
+// Archive file format
+enum ArchiveFormat {
+    ARCHIVE_JSONL    = 0, // One JSON object per line (sensorDataToSd)
+    ARCHIVE_BINARY   = 1, // CRC-framed binary records (see ArchiveSchema.h)
+    ARCHIVE_JSONL_LZ = 2  // JSON lines in compressed blocks (see ArchiveLz.h)
+};
+
+// Worst case size of one encoded record: a 10-byte varint per IsSd field (18 fields = 180 bytes)
+#define XX_ARCHIVE_MAX_SIZE(Type, Name, Key, IsTel, IsSd) + ((IsSd) ? 10 : 0)
+#define ARCHIVE_MAX_RECORD_SIZE (0 SENSOR_DATA_MAP(XX_ARCHIVE_MAX_SIZE))
+
+template <typename T> struct ArchiveFieldType;
+template <> struct ArchiveFieldType<uint64_t> { static const uint8_t code = ARCHIVE_TYPE_U64; };
+template <> struct ArchiveFieldType<int>      { static const uint8_t code = ARCHIVE_TYPE_INT; };
+template <> struct ArchiveFieldType<double>   { static const uint8_t code = ARCHIVE_TYPE_F64; };
+template <> struct ArchiveFieldType<float>    { static const uint8_t code = ARCHIVE_TYPE_F32; };
+template <> struct ArchiveFieldType<uint8_t>  { static const uint8_t code = ARCHIVE_TYPE_U8; };
+template <> struct ArchiveFieldType<bool>     { static const uint8_t code = ARCHIVE_TYPE_BOOL; };
+
+// Writes the schema frame payload. Returns its length.
+inline size_t archiveWriteSchema(uint8_t* out, size_t cap) {
+    size_t n = 0;
+    uint8_t fields = 0;
+    memcpy(out, "SDLB", 4);
+    n = 6; // magic + version + count (count patched below)
+
+#define XX_SCHEMA(Type, Name, Key, IsTel, IsSd) \
+    if (IsSd) { \
+        size_t keyLen = strlen(Key); \
+        if (n + 2 + keyLen > cap) return 0; \
+        out[n++] = ArchiveFieldType<Type>::code; \
+        out[n++] = (uint8_t)keyLen; \
+        memcpy(out + n, Key, keyLen); \
+        n += keyLen; \
+        fields++; \
+    }
+    SENSOR_DATA_MAP(XX_SCHEMA)
+#undef XX_SCHEMA
+
+    out[4] = ARCHIVE_SCHEMA_VERSION;
+    out[5] = fields;
+    return n;
+}
+
+// Encodes one record (IsSd fields) as delta to 'prev'. Returns bytes written.
+inline size_t archiveEncodeRecord(const SensorData &data, const SensorData &prev, uint8_t* out) {
+    size_t n = 0;
+
+#define XX_ENCODE(Type, Name, Key, IsTel, IsSd) \
+    if (IsSd) { \
+        if (ArchiveFieldType<Type>::code == ARCHIVE_TYPE_U8 || ArchiveFieldType<Type>::code == ARCHIVE_TYPE_BOOL) { \
+            out[n++] = (uint8_t)data.Name; \
+        } else { \
+            int64_t delta = archiveDelta(archiveQuantize(data.Name), archiveQuantize(prev.Name)); \
+            n += archivePutVarint(out + n, archiveZigzag(delta)); \
+        } \
+    }
+    SENSOR_DATA_MAP(XX_ENCODE)
+#undef XX_ENCODE
+
+    return n;
+}
+
+// Decodes one record written by archiveEncodeRecord. Returns false on truncated input.
+inline bool archiveDecodeRecord(const uint8_t* in, size_t len, size_t &pos, const SensorData &prev, SensorData &data) {
+    data = prev;
+
+#define XX_DECODE(Type, Name, Key, IsTel, IsSd) \
+    if (IsSd) { \
+        if (ArchiveFieldType<Type>::code == ARCHIVE_TYPE_U8 || ArchiveFieldType<Type>::code == ARCHIVE_TYPE_BOOL) { \
+            if (pos >= len) return false; \
+            data.Name = (Type)in[pos++]; \
+        } else { \
+            uint64_t raw; \
+            if (!archiveGetVarint(in, len, pos, raw)) return false; \
+            archiveDequantize(archiveUndelta(archiveQuantize(prev.Name), archiveUnzigzag(raw)), data.Name); \
+        } \
+    }
+    SENSOR_DATA_MAP(XX_DECODE)
+#undef XX_DECODE
+
+    return true;
+}
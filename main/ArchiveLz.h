@@ -0,0 +1,119 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Compressed archive (LOG_*.lz): JSON lines packed into blocks of up to ARCHIVE_LZ_BLOCK_SIZE
+// bytes, each block LZ77-compressed on its own and stored as one LogFrame (flags = ARCHIVE_FRAME_LZ).
+// Blocks hold whole lines and do not reference each other, so a torn frame loses one block only.
+//
+// Block stream: a flag byte for the next 8 items (bit set = match, LSB first), then the items
+//   literal: [byte]
+//   match:   [offset-1 bits 0..7][offset-1 bits 8..11 | (length-3) << 4]
+//            (length-3) >= 15 continues in extra bytes: 255, 255, ..., last < 255 (added up)
+#define ARCHIVE_FRAME_LZ       0x02
+#define ARCHIVE_LZ_BLOCK_SIZE  4096 // Uncompressed bytes per block (offsets fit in 12 bits)
+#define ARCHIVE_LZ_MAX_OUTPUT  (ARCHIVE_LZ_BLOCK_SIZE + ARCHIVE_LZ_BLOCK_SIZE / 8 + 16) // All literals
+#define ARCHIVE_LZ_HASH_BITS   10   // Compressor scratch: (1 << bits) uint16_t entries (2 KB)
+#define ARCHIVE_LZ_MIN_MATCH   3
+
+inline uint32_t archiveLzHash(const uint8_t* p) {
+    uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+    return (v * 2654435761u) >> (32 - ARCHIVE_LZ_HASH_BITS);
+}
+
+// Compresses 'len' (<= ARCHIVE_LZ_BLOCK_SIZE) bytes into 'out' (ARCHIVE_LZ_MAX_OUTPUT bytes).
+// 'table' is scratch space of (1 << ARCHIVE_LZ_HASH_BITS) entries. Returns compressed length.
+inline size_t archiveLzCompress(const uint8_t* in, size_t len, uint8_t* out, uint16_t* table) {
+    for (size_t i = 0; i < ((size_t)1 << ARCHIVE_LZ_HASH_BITS); ++i) table[i] = 0xFFFF;
+
+    size_t ip = 0;
+    size_t op = 0;
+    size_t flagPos = 0;
+    int flagBit = 8;
+
+    while (ip < len) {
+        if (flagBit == 8) {
+            flagPos = op++;
+            out[flagPos] = 0;
+            flagBit = 0;
+        }
+
+        // Longest match at the last position with the same 3-byte hash
+        size_t matchLen = 0;
+        size_t matchOffset = 0;
+        if (ip + ARCHIVE_LZ_MIN_MATCH <= len) {
+            uint32_t h = archiveLzHash(in + ip);
+            uint16_t candidate = table[h];
+            table[h] = (uint16_t)ip;
+            if (candidate != 0xFFFF) {
+                size_t n = 0;
+                while (ip + n < len && in[candidate + n] == in[ip + n]) n++;
+                if (n >= ARCHIVE_LZ_MIN_MATCH) {
+                    matchLen = n;
+                    matchOffset = ip - candidate;
+                }
+            }
+        }
+
+        if (matchLen) {
+            out[flagPos] |= (uint8_t)(1 << flagBit);
+            uint32_t offset = matchOffset - 1;
+            uint32_t extra = matchLen - ARCHIVE_LZ_MIN_MATCH;
+            out[op++] = (uint8_t)(offset & 0xFF);
+            out[op++] = (uint8_t)((offset >> 8) | ((extra < 15 ? extra : 15) << 4));
+            if (extra >= 15) {
+                extra -= 15;
+                while (extra >= 255) {
+                    out[op++] = 255;
+                    extra -= 255;
+                }
+                out[op++] = (uint8_t)extra;
+            }
+
+            // Positions inside the match stay findable
+            for (size_t k = 1; k < matchLen && ip + k + ARCHIVE_LZ_MIN_MATCH <= len; ++k) {
+                table[archiveLzHash(in + ip + k)] = (uint16_t)(ip + k);
+            }
+            ip += matchLen;
+        } else {
+            out[op++] = in[ip++];
+        }
+        flagBit++;
+    }
+    return op;
+}
+
+// Decompresses one block. Returns the decompressed length, or -1 on malformed input.
+inline int archiveLzDecompress(const uint8_t* in, size_t len, uint8_t* out, size_t cap) {
+    size_t ip = 0;
+    size_t op = 0;
+
+    while (ip < len) {
+        uint8_t flags = in[ip++];
+        for (int bit = 0; bit < 8 && ip < len; ++bit) {
+            if (!(flags & (1 << bit))) {
+                if (op >= cap) return -1;
+                out[op++] = in[ip++];
+                continue;
+            }
+
+            if (ip + 2 > len) return -1;
+            size_t offset = ((size_t)in[ip] | ((size_t)(in[ip + 1] & 0x0F) << 8)) + 1;
+            size_t length = in[ip + 1] >> 4;
+            ip += 2;
+            if (length == 15) {
+                uint8_t b;
+                do {
+                    if (ip >= len) return -1;
+                    b = in[ip++];
+                    length += b;
+                } while (b == 255);
+            }
+            length += ARCHIVE_LZ_MIN_MATCH;
+
+            if (offset > op || op + length > cap) return -1;
+            for (size_t k = 0; k < length; ++k, ++op) out[op] = out[op - offset]; // May overlap
+        }
+    }
+    return (int)op;
+}
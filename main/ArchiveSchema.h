@@ -0,0 +1,80 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+// Binary archive (LOG_*.bin) format and number coding. No Arduino dependencies: tools/sdlog_decode
+// includes it too. Record encoding from SensorData is in ArchiveCodec.h.
+//
+// The file is a sequence of LogFrame frames:
+//   - flags = ARCHIVE_FRAME_SCHEMA: "SDLB", version, field count, then per field [type][name length][name]
+//   - flags = ARCHIVE_FRAME_RECORDS: records, the first one encoded against zero (keyframe),
+//     the following ones as deltas to the previous record in the same frame.
+// Each frame decodes on its own, so a torn write loses only that frame.
+#define ARCHIVE_FRAME_RECORDS  0x00
+#define ARCHIVE_FRAME_SCHEMA   0x01
+#define ARCHIVE_SCHEMA_VERSION 1
+
+// Field type codes (schema header), derived from the X-macro types
+#define ARCHIVE_TYPE_U64   1 // zigzag varint delta
+#define ARCHIVE_TYPE_INT   2 // zigzag varint delta
+#define ARCHIVE_TYPE_F64   3 // value * 1e7, zigzag varint delta (ARCHIVE_Q_NULL = NaN)
+#define ARCHIVE_TYPE_F32   4 // value * 1e4, zigzag varint delta (ARCHIVE_Q_NULL = NaN)
+#define ARCHIVE_TYPE_U8    5 // raw byte
+#define ARCHIVE_TYPE_BOOL  6 // raw byte
+
+#define ARCHIVE_F64_SCALE 1e7
+#define ARCHIVE_F32_SCALE 1e4f
+#define ARCHIVE_F_LIMIT   9.0e18 // Scaled magnitudes from here on do not fit int64 and are stored as null
+
+// Quantised value reserved for NaN/inf/out of range floats (decodes back to NaN, "null" in JSON).
+// Deltas wrap modulo 2^64, so a field going to or from null costs one 10-byte varint and
+// the other fields and records of the frame are unaffected.
+#define ARCHIVE_Q_NULL INT64_MIN
+
+// --- Varint helpers ---
+
+inline size_t archivePutVarint(uint8_t* out, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+inline bool archiveGetVarint(const uint8_t* in, size_t len, size_t &pos, uint64_t &v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && pos < len; shift += 7) {
+        uint8_t b = in[pos++];
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+inline uint64_t archiveZigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+inline int64_t archiveUnzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+// Delta coding modulo 2^64 (no signed overflow when a side is ARCHIVE_Q_NULL)
+inline int64_t archiveDelta(int64_t q, int64_t prev) { return (int64_t)((uint64_t)q - (uint64_t)prev); }
+inline int64_t archiveUndelta(int64_t prev, int64_t delta) { return (int64_t)((uint64_t)prev + (uint64_t)delta); }
+
+// --- Per-type quantisation (value <-> integer stored in the stream) ---
+
+inline int64_t archiveQuantize(uint64_t v) { return (int64_t)v; }
+inline int64_t archiveQuantize(int v)      { return v; }
+inline int64_t archiveQuantizeScaled(double s) {
+    if (!(fabs(s) < ARCHIVE_F_LIMIT)) return ARCHIVE_Q_NULL; // Also NaN
+    return (int64_t)llround(s);
+}
+inline int64_t archiveQuantize(double v)   { return archiveQuantizeScaled(v * ARCHIVE_F64_SCALE); }
+inline int64_t archiveQuantize(float v)    { return archiveQuantizeScaled((double)(v * ARCHIVE_F32_SCALE)); }
+
+inline void archiveDequantize(int64_t q, uint64_t &v) { v = (uint64_t)q; }
+inline void archiveDequantize(int64_t q, int &v)      { v = (int)q; }
+inline void archiveDequantize(int64_t q, double &v)   { v = q == ARCHIVE_Q_NULL ? NAN : (double)q / ARCHIVE_F64_SCALE; }
+inline void archiveDequantize(int64_t q, float &v)    { v = q == ARCHIVE_Q_NULL ? NAN : (float)q / ARCHIVE_F32_SCALE; }
+inline void archiveDequantize(int64_t q, uint8_t &v)  { v = (uint8_t)q; } // Raw types, kept for the X-macro
+inline void archiveDequantize(int64_t q, bool &v)     { v = q != 0; }
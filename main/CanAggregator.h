@@ -0,0 +1,83 @@
+#pragma once
+#include <Arduino.h>
+#include <math.h>
+#include <atomic>
+#include "CanSignals.h"
+
+// Statistics of one signal over a coordinator interval
+struct CanSignalSummary {
+    uint32_t count; // Decoded values in the interval
+    float last;     // Most recent value (valid if count > 0)
+    float min;      // NAN if count == 0 (written as null)
+    float max;
+    float mean;
+};
+
+// Per-signal min/max/mean/count/last between coordinator ticks, without a lock.
+// TaskCAN (single producer) adds decoded values to the active bank; the coordinator (single consumer)
+// switches banks, waits for an add() still running on the old one (a few hundred cycles at most)
+// and reads and clears it.
+class CanAggregator {
+public:
+    // --- Producer (TaskCAN) ---
+    void add(const CanSignalValues &values) {
+        if (!values.updated) return;
+
+        // Claim the active bank; retry if the consumer switched meanwhile
+        int b;
+        do {
+            b = _active.load();
+            _writing.store(b);
+        } while (_active.load() != b);
+
+        Bank &bank = _bank[b];
+        for (int i = 0; i < CAN_SIGNAL_COUNT; i++) {
+            if (!(values.updated & (1ULL << i))) continue;
+            float v = values.value[i];
+            Acc &a = bank.acc[i];
+            if (a.count == 0 || v < a.min) a.min = v;
+            if (a.count == 0 || v > a.max) a.max = v;
+            a.sum += v;
+            a.last = v;
+            a.count++;
+        }
+
+        _writing.store(-1, std::memory_order_release);
+    }
+
+    // --- Consumer (coordinator) ---
+
+    // Statistics since the previous call (one entry per CanSignal); starts a new interval
+    void take(CanSignalSummary out[CAN_SIGNAL_COUNT]) {
+        int old = _active.load();
+        _active.store(old ^ 1);
+        while (_writing.load() == old) taskYIELD(); // add() in progress on the old bank
+
+        Bank &bank = _bank[old];
+        for (int i = 0; i < CAN_SIGNAL_COUNT; i++) {
+            Acc &a = bank.acc[i];
+            out[i].count = a.count;
+            out[i].last = a.last;
+            out[i].min = a.count ? a.min : NAN;
+            out[i].max = a.count ? a.max : NAN;
+            out[i].mean = a.count ? (float)(a.sum / a.count) : NAN;
+            a = Acc();
+        }
+    }
+
+private:
+    struct Acc {
+        uint32_t count = 0;
+        float last = 0;
+        float min = 0;
+        float max = 0;
+        double sum = 0;
+    };
+    struct Bank {
+        Acc acc[CAN_SIGNAL_COUNT];
+    };
+
+    Bank _bank[2];
+    std::atomic<int> _active{0};   // Bank add() writes to
+    std::atomic<int> _writing{-1}; // Bank an add() is writing to, -1 if none
+};
@@ -0,0 +1,133 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+// Raw CAN capture log (CAN_*.can): every received frame, in blocks of up to CAN_CAPTURE_BLOCK_SIZE
+// bytes, each stored as one LogFrame (flags = CAN_CAPTURE_FRAME_BLOCK).
+// Block: [base_us:8 LE] then records [dt_us:4 LE][id:4 LE][dlc:1][data:dlc]
+//   base_us = Unix time (µs) of the first record, dt_us = record time - base_us
+//   id bit 31 = extended frame, bit 30 = remote frame, bits 28..0 = identifier
+// Decode on a PC with tools/canlog_export (candump -l or Vector ASC text).
+#define CAN_CAPTURE_FRAME_BLOCK  0x10
+#define CAN_CAPTURE_BLOCK_SIZE   8192
+#define CAN_CAPTURE_BLOCK_HEADER 8
+#define CAN_CAPTURE_RECORD_MAX   17
+#define CAN_CAPTURE_ID_EXTD      (1u << 31)
+#define CAN_CAPTURE_ID_RTR       (1u << 30)
+#define CAN_CAPTURE_ID_MASK      0x1FFFFFFFu
+
+// Double buffer between TaskCAN (producer) and TaskSdWriter (consumer): frames go into the active
+// block while the other one is written to the card. A frame is dropped only when both blocks are
+// waiting for the card. Blocks are handed over in fill order.
+class CanCaptureBuffer {
+public:
+    // --- Producer (TaskCAN) ---
+
+    // Starts a session. False while the previous session is still being written.
+    bool start() {
+        if (_session.load(std::memory_order_acquire)) return false;
+        for (int i = 0; i < 2; i++) {
+            _len[i] = 0;
+            _full[i].store(false, std::memory_order_relaxed);
+        }
+        _active = 0;
+        _next = 0;
+        _dropped = 0;
+        _ending.store(false, std::memory_order_relaxed);
+        _session.store(true, std::memory_order_release);
+        return true;
+    }
+
+    // Appends a frame. Returns the length of a block sealed to make room (0 if none).
+    size_t add(uint64_t timeUs, uint32_t id, bool extended, bool remote, uint8_t dlc, const uint8_t* data) {
+        if (dlc > 8) dlc = 8;
+        if (remote) dlc = 0; // No payload on the bus (the DLC is not kept)
+
+        // Seal a block that is full or whose dt_us (32 bit) would overflow
+        size_t sealed = 0;
+        if (!_full[_active].load(std::memory_order_acquire) && _len[_active] > 0 &&
+            (_len[_active] + CAN_CAPTURE_RECORD_MAX > CAN_CAPTURE_BLOCK_SIZE || timeUs - _base[_active] > 0xFFFFFFFFULL)) {
+            sealed = seal();
+        }
+        if (_full[_active].load(std::memory_order_acquire)) {
+            _dropped++; // Both blocks wait for the card
+            return sealed;
+        }
+
+        uint8_t* block = _block[_active];
+        size_t n = _len[_active];
+        if (n == 0) {
+            _base[_active] = timeUs;
+            putLe(block, timeUs, 8);
+            n = CAN_CAPTURE_BLOCK_HEADER;
+        }
+        uint32_t word = (id & CAN_CAPTURE_ID_MASK) | (extended ? CAN_CAPTURE_ID_EXTD : 0) | (remote ? CAN_CAPTURE_ID_RTR : 0);
+        putLe(block + n, timeUs - _base[_active], 4);
+        putLe(block + n + 4, word, 4);
+        block[n + 8] = dlc;
+        memcpy(block + n + 9, data, dlc);
+        _len[_active] = n + 9 + dlc;
+        return sealed;
+    }
+
+    // Hands the active block to the consumer. Returns its length (0 if it was empty or already sealed).
+    size_t seal() {
+        if (_full[_active].load(std::memory_order_acquire) || _len[_active] == 0) return 0;
+        size_t len = _len[_active];
+        _full[_active].store(true, std::memory_order_release);
+        _active ^= 1;
+        return len;
+    }
+
+    // Seals the last block and ends the session once the consumer has written it
+    size_t finish() {
+        size_t len = seal();
+        _ending.store(true, std::memory_order_release);
+        return len;
+    }
+
+    bool active() const { return _session.load(std::memory_order_acquire) && !_ending.load(std::memory_order_acquire); }
+    bool pending() const { return !_full[_active].load(std::memory_order_acquire) && _len[_active] > 0; } // Unsealed records
+    uint64_t pendingSinceUs() const { return _base[_active]; } // Time of the first unsealed record
+    uint32_t dropped() const { return _dropped; }
+
+    // --- Consumer (TaskSdWriter) ---
+
+    // Oldest sealed block, nullptr if none
+    const uint8_t* full(size_t &len) {
+        if (!_full[_next].load(std::memory_order_acquire)) return nullptr;
+        len = _len[_next];
+        return _block[_next];
+    }
+
+    // The block returned by full() is written and can be reused
+    void release() {
+        _len[_next] = 0;
+        _full[_next].store(false, std::memory_order_release);
+        _next ^= 1;
+    }
+
+    // Session finished and every block written: the log can be closed
+    bool finished() const {
+        return _ending.load(std::memory_order_acquire) && _session.load(std::memory_order_acquire) &&
+               !_full[0].load(std::memory_order_acquire) && !_full[1].load(std::memory_order_acquire);
+    }
+
+    void close() { _session.store(false, std::memory_order_release); }
+
+private:
+    uint8_t _block[2][CAN_CAPTURE_BLOCK_SIZE];
+    size_t _len[2] = {0, 0};
+    uint64_t _base[2] = {0, 0};
+    std::atomic<bool> _full[2] = {{false}, {false}};
+    std::atomic<bool> _session{false};
+    std::atomic<bool> _ending{false};
+    int _active = 0;   // Producer side
+    int _next = 0;     // Consumer side
+    uint32_t _dropped = 0;
+
+    static void putLe(uint8_t* out, uint64_t v, int bytes) {
+        for (int i = 0; i < bytes; i++) out[i] = (uint8_t)(v >> (8 * i));
+    }
+};
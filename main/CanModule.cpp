@@ -1,15 +1,45 @@
 #include "CanModule.h"
 
-CanModule::CanModule(int rxPin, int txPin) : _rxPin(rxPin), _txPin(txPin), _isInitialized(false) {}
+// Signal definitions (CanSignals.h)
+struct CanSignalDef {
+    uint32_t id;
+    int startBit;
+    int length;
+    bool isBigEndian;
+    bool isSigned;
+    float factor;
+    float offset;
+    float min;
+    float max;
+};
+
+static const CanSignalDef CAN_SIGNALS[CAN_SIGNAL_COUNT] = {
+#define XX_DEF(Name, Id, Start, Len, BE, Signed, Factor, Offset, Min, Max) {Id, Start, Len, BE, Signed, Factor, Offset, Min, Max},
+    CAN_SIGNAL_MAP(XX_DEF)
+#undef XX_DEF
+};
+
+static inline uint32_t idSlotIndex(uint32_t id) {
+    return (id * 2654435761u) >> (32 - CAN_ID_TABLE_BITS); // Fibonacci hashing
+}
+
+CanModule::CanModule(int rxPin, int txPin) : _rxPin(rxPin), _txPin(txPin), _isInitialized(false) {
+    compileSignals();
+}
 
 // -----------------------------------------------------
 // --------------- Public Methods ----------------------
 // -----------------------------------------------------
 
-bool CanModule::begin() {
+bool CanModule::begin(int rxQueueLen) {
     twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT((gpio_num_t)_txPin, (gpio_num_t)_rxPin, TWAI_MODE_NORMAL);
+    _rxQueueLen = rxQueueLen;
+    g_config.rx_queue_len = rxQueueLen;
+    g_config.alerts_enabled = TWAI_ALERT_RX_DATA | TWAI_ALERT_RX_QUEUE_FULL | TWAI_ALERT_RX_FIFO_OVERRUN |
+                              TWAI_ALERT_BUS_ERROR | TWAI_ALERT_BUS_OFF | TWAI_ALERT_BUS_RECOVERED;
     twai_timing_config_t t_config = TWAI_TIMING_CONFIG_500KBITS();
     twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+    if (!_acceptAll) f_config = acceptanceFilter();
 
     // Install TWAI driver
     if (twai_driver_install(&g_config, &t_config, &f_config) != ESP_OK) {
@@ -24,16 +54,51 @@ bool CanModule::begin() {
     }
 
     _isInitialized = true;
-    Serial.println("[CAN] Initialized and started at 500kbps");
+    Serial.printf("[CAN] Initialized and started at 500kbps (filter 0x%08lX/0x%08lX, RX queue %d)\n",
+                  (unsigned long)f_config.acceptance_code, (unsigned long)f_config.acceptance_mask, rxQueueLen);
     return true;
 }
 
+bool CanModule::setAcceptAll(bool acceptAll) {
+    if (!_isInitialized || acceptAll == _acceptAll) return _isInitialized;
+    _acceptAll = acceptAll;
+
+    // The filter is fixed at install time
+    twai_stop();
+    twai_driver_uninstall();
+    _isInitialized = false;
+    return begin(_rxQueueLen);
+}
+
+bool CanModule::waitForFrames(TickType_t timeout) {
+    if (!_isInitialized) {
+        vTaskDelay(timeout);
+        return false;
+    }
+
+    uint32_t alerts = 0;
+    if (twai_read_alerts(&alerts, timeout) != ESP_OK) return false; // Timeout
+
+    if (alerts & TWAI_ALERT_BUS_OFF) {
+        Serial.println("[CAN] Bus off, recovering...");
+        _busOff++;
+        twai_initiate_recovery(); // Driver stops; restarted on BUS_RECOVERED
+    }
+    if (alerts & TWAI_ALERT_BUS_RECOVERED) {
+        Serial.println("[CAN] Bus recovered");
+        twai_start();
+    }
+    return alerts & TWAI_ALERT_RX_DATA;
+}
+
 bool CanModule::getMessage(twai_message_t &message) {
     if (!_isInitialized) return false;
     
     // Receive message with zero timeout (non-blocking)
     esp_err_t res = twai_receive(&message, 0);
-    return (res == ESP_OK);
+    if (res != ESP_OK) return false;
+    _received++;
+    return true;
 }
 
 float CanModule::readSignal(const twai_message_t &message, uint32_t id, int startBit, int length, bool isBigEndian, float factor) {
@@ -78,6 +143,56 @@ float CanModule::readSignal(const twai_message_t &message, uint32_t id, int star
     return (float)rawValue * factor;
 }
 
+int CanModule::decode(const twai_message_t &message, CanSignalValues &values) {
+    const IdSlot* slot = findId(message.identifier);
+    if (!slot) {
+        _unmatched++; // Accepted by the (approximate) hardware filter only
+        return 0;
+    }
+
+    // Whole payload as one word in both byte orders; each signal is then a shift and a mask
+    uint8_t dlc = message.data_length_code > 8 ? 8 : message.data_length_code;
+    uint64_t le = 0;
+    memcpy(&le, message.data, dlc); // ESP32 is little endian, missing bytes stay 0
+    uint64_t be = __builtin_bswap64(le);
+
+    int decoded = 0;
+    for (int i = slot->first; i < slot->first + slot->count; i++) {
+        const Extractor &e = _extractors[i];
+        if (dlc < e.minDlc) continue;
+
+        uint64_t raw = ((e.isBigEndian ? be : le) >> e.shift) & e.mask;
+        float value;
+        if (e.isSigned) {
+            value = (float)((int64_t)(raw << (64 - e.length)) >> (64 - e.length)); // Sign extension
+        } else {
+            value = (float)raw;
+        }
+        value = value * e.factor + e.offset;
+        if (e.min < e.max && (value < e.min || value > e.max)) continue; // Out of range
+
+        values.value[e.signal] = value;
+        values.updated |= 1ULL << e.signal;
+        decoded++;
+    }
+    return decoded;
+}
+
+CanStats CanModule::getStats() {
+    CanStats stats = {};
+    stats.received = _received;
+    stats.unmatched = _unmatched;
+    stats.busOff = _busOff;
+
+    twai_status_info_t status;
+    if (_isInitialized && twai_get_status_info(&status) == ESP_OK) {
+        stats.rxMissed = status.rx_missed_count;
+        stats.rxOverrun = status.rx_overrun_count;
+        stats.busErrors = status.bus_error_count;
+    }
+    return stats;
+}
+
 void CanModule::stop() {
     if (_isInitialized) {
         twai_stop();
@@ -86,3 +201,85 @@ void CanModule::stop() {
         Serial.println("[CAN] Stopped");
     }
 }
+
+// -----------------------------------------------------
+// --------------- Private Methods ---------------------
+// -----------------------------------------------------
+
+void CanModule::compileSignals() {
+    memset(_idTable, 0, sizeof(_idTable));
+
+    // Group signals by frame id (table order within a frame), one hash slot per id
+    int n = 0;
+    for (int s = 0; s < CAN_SIGNAL_COUNT; s++) {
+        uint32_t id = CAN_SIGNALS[s].id;
+        if (findId(id)) continue; // Frame already compiled
+
+        uint32_t index = idSlotIndex(id);
+        while (_idTable[index].count) index = (index + 1) & (CAN_ID_TABLE_SIZE - 1);
+        _idTable[index].id = id;
+        _idTable[index].first = n;
+
+        for (int t = s; t < CAN_SIGNAL_COUNT; t++) {
+            const CanSignalDef &def = CAN_SIGNALS[t];
+            if (def.id != id) continue;
+
+            Extractor &e = _extractors[n++];
+            e.signal = t;
+            e.length = def.length;
+            e.mask = def.length == 64 ? ~0ULL : (1ULL << def.length) - 1;
+            // Big endian stream bit 0 is the word MSB; little endian bit 0 is the word LSB
+            e.shift = def.isBigEndian ? 64 - def.startBit - def.length : def.startBit;
+            e.minDlc = (def.startBit + def.length + 7) / 8;
+            e.isBigEndian = def.isBigEndian;
+            e.isSigned = def.isSigned;
+            e.factor = def.factor;
+            e.offset = def.offset;
+            e.min = def.min;
+            e.max = def.max;
+            _idTable[index].count++;
+        }
+    }
+}
+
+const CanModule::IdSlot* CanModule::findId(uint32_t id) const {
+    uint32_t index = idSlotIndex(id);
+    while (_idTable[index].count) {
+        if (_idTable[index].id == id) return &_idTable[index];
+        index = (index + 1) & (CAN_ID_TABLE_SIZE - 1);
+    }
+    return nullptr;
+}
+
+twai_filter_config_t CanModule::acceptanceFilter() const {
+    twai_filter_config_t filter = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+
+    // Code = bits shared by all mapped ids, mask = bits that differ (don't care)
+    uint32_t first = 0;
+    uint32_t differ = 0;
+    bool standard = false;
+    bool extended = false;
+    for (int i = 0; i < CAN_ID_TABLE_SIZE; i++) {
+        if (!_idTable[i].count) continue;
+        uint32_t id = _idTable[i].id;
+        if (!standard && !extended) first = id;
+        differ |= id ^ first;
+        if (id > 0x7FF) extended = true;
+        else standard = true;
+    }
+
+    // One filter cannot match both frame formats (different register layouts)
+    if (standard == extended) return filter;
+
+    if (standard) {
+        // [31:21] id, [20] RTR, [19:0] first data bytes (ignored)
+        filter.acceptance_code = first << 21;
+        filter.acceptance_mask = (differ << 21) | 0x1FFFFF;
+    } else {
+        // [31:3] id, [2] RTR, [1:0] unused
+        filter.acceptance_code = first << 3;
+        filter.acceptance_mask = (differ << 3) | 0x7;
+    }
+    filter.single_filter = true;
+    return filter;
+}
@@ -1,19 +1,72 @@
 #pragma once
 #include <Arduino.h>
 #include "driver/twai.h"
+#include "CanSignals.h"
+
+#define CAN_ID_TABLE_BITS 6 // Frame id hash table: 64 slots (at most half used)
+#define CAN_ID_TABLE_SIZE (1 << CAN_ID_TABLE_BITS)
+static_assert(CAN_SIGNAL_COUNT * 2 <= CAN_ID_TABLE_SIZE, "Raise CAN_ID_TABLE_BITS");
+
+// Receive counters (driver status + decoder)
+struct CanStats {
+    uint32_t received;  // Frames taken from the RX queue
+    uint32_t unmatched; // Passed the acceptance filter but carry no mapped signal
+    uint32_t rxMissed;  // Lost at a full RX queue (driver)
+    uint32_t rxOverrun; // Lost at a full hardware RX FIFO (driver)
+    uint32_t busErrors;
+    uint32_t busOff;    // Bus-off events (recovered automatically)
+};
 
 // CAN Module (TWAI for ESP32)
 class CanModule {
 public:
     CanModule(int rxPin, int txPin);
 
-    bool begin(); // Initialize and start CAN
+    bool begin(int rxQueueLen = 32); // Initialize and start CAN (acceptance filter from CAN_SIGNAL_MAP)
+    bool setAcceptAll(bool acceptAll); // Restarts the driver with an accept-all filter (raw capture) or the derived one
+    bool waitForFrames(TickType_t timeout); // Sleeps until frames are queued (RX alert) or timeout, handles bus-off
     bool getMessage(twai_message_t &message); // Receive message (non-blocking)
-    float readSignal(const twai_message_t &message, uint32_t id, int startBit, int length, bool isBigEndian, float factor); // Generic signal extraction
+    float readSignal(const twai_message_t &message, uint32_t id, int startBit, int length, bool isBigEndian, float factor); // Generic signal extraction (ad hoc, bit by bit)
+    int decode(const twai_message_t &message, CanSignalValues &values); // All CAN_SIGNAL_MAP signals of the frame, returns how many were updated
+    CanStats getStats();
     void stop(); // Stop and uninstall driver
 
 private:
     int _rxPin;
     int _txPin;
     bool _isInitialized;
+    int _rxQueueLen = 32;
+    bool _acceptAll = false;
+    uint32_t _received = 0;
+    uint32_t _unmatched = 0;
+    uint32_t _busOff = 0;
+
+    // Signal extractor compiled from CAN_SIGNAL_MAP: raw = (frame word >> shift) & mask
+    struct Extractor {
+        uint64_t mask;
+        float factor;
+        float offset;
+        float min;
+        float max;
+        uint8_t signal; // CanSignal
+        uint8_t shift;
+        uint8_t length;
+        uint8_t minDlc; // Frames shorter than this do not carry the signal
+        bool isBigEndian;
+        bool isSigned;
+    };
+
+    // Frame id -> its extractors (count 0 = empty slot, linear probing)
+    struct IdSlot {
+        uint32_t id;
+        uint8_t first;
+        uint8_t count;
+    };
+
+    Extractor _extractors[CAN_SIGNAL_COUNT]; // Grouped by frame id
+    IdSlot _idTable[CAN_ID_TABLE_SIZE];
+
+    void compileSignals(); // Builds _extractors and _idTable
+    twai_filter_config_t acceptanceFilter() const; // Single filter covering the mapped frame ids
+    const IdSlot* findId(uint32_t id) const;
 };
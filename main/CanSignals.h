@@ -0,0 +1,38 @@
+#pragma once
+#include <Arduino.h>
+
+// CAN signal table (DBC subset), compiled by CanModule into mask/shift extractors
+// XX(Name, FrameId, StartBit, Length, IsBigEndian, IsSigned, Factor, Offset, Min, Max)
+//   Bits are numbered as a stream: big endian (Motorola) index 0 = Byte0.Bit7 (MSB first),
+//   little endian (Intel) index 0 = Byte0.Bit0. value = raw * Factor + Offset.
+//   Values outside [Min, Max] are dropped (Min == Max disables the check).
+//   Frame ids above 0x7FF are extended (29-bit) frames. The TWAI acceptance filter is derived from these ids.
+// Example: XX(engine_speed, 0x123, 16, 16, true, false, 0.25f, 0.0f, 0.0f, 16000.0f)
+#define CAN_SIGNAL_MAP(XX) \
+    XX(vehicle_speed, 0x123, 0, 16, true, false, 0.1f, 0.0f, 0.0f, 400.0f)
+
+    //X-Macro signals
+    //Vehicle speed (km/h)
+
+enum CanSignal {
+#define XX_ENUM(Name, Id, Start, Len, BE, Signed, Factor, Offset, Min, Max) CAN_SIG_##Name,
+    CAN_SIGNAL_MAP(XX_ENUM)
+#undef XX_ENUM
+    CAN_SIGNAL_COUNT
+};
+
+#define CAN_SIGNAL_BIT(Name) (1ULL << CAN_SIG_##Name)
+
+static_assert(CAN_SIGNAL_COUNT <= 64, "CanSignalValues.updated holds one bit per signal");
+
+#define XX_CHECK(Name, Id, Start, Len, BE, Signed, Factor, Offset, Min, Max) \
+    static_assert((Len) >= 1 && (Start) >= 0 && (Start) + (Len) <= 64, "CAN signal " #Name " does not fit in 8 bytes"); \
+    static_assert((Id) <= 0x1FFFFFFF, "CAN signal " #Name " has an invalid frame id");
+CAN_SIGNAL_MAP(XX_CHECK)
+#undef XX_CHECK
+
+// Decoded values of one frame (only signals carried by that frame are updated)
+struct CanSignalValues {
+    float value[CAN_SIGNAL_COUNT];
+    uint64_t updated; // Bit per signal (CAN_SIGNAL_BIT)
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <Arduino.h>
+
+// Backlog drain rate controller (AIMD)
+// While batches are acknowledged within the target time the batch grows by a fixed step and the
+// gap between batches halves. A failure halves the batch and doubles the gap; live data
+// waiting in the RAM queue halves the batch so the backlog yields to fresh records.
+class DrainController {
+public:
+    void begin(int minBatch, int maxBatch, uint32_t minGapMs, uint32_t maxGapMs, uint32_t startGapMs) {
+        _minBatch = minBatch;
+        _maxBatch = maxBatch;
+        _minGapMs = minGapMs;
+        _maxGapMs = maxGapMs;
+        _batch = minBatch;
+        _gapMs = startGapMs;
+    }
+
+    void setMaxBatch(int maxBatch) {
+        _maxBatch = maxBatch < _minBatch ? _minBatch : maxBatch;
+        if (_batch > _maxBatch) _batch = _maxBatch;
+    }
+
+    int batchSize() const { return _batch; }
+    uint32_t gapMs() const { return _gapMs; }
+
+    // Batch acknowledged 'ackMs' after its publish (ack marker round trip, including the batches
+    // still in flight ahead of it)
+    void onSuccess(uint32_t ackMs) {
+        if (ackMs > TARGET_ACK_MS) return; // Link is busy - hold the current rate
+        _batch += BATCH_STEP;
+        if (_batch > _maxBatch) _batch = _maxBatch;
+        _gapMs /= 2;
+        if (_gapMs < _minGapMs) _gapMs = _minGapMs;
+    }
+
+    void onFailure() {
+        _batch /= 2;
+        if (_batch < _minBatch) _batch = _minBatch;
+        _gapMs *= 2;
+        if (_gapMs > _maxGapMs) _gapMs = _maxGapMs;
+    }
+
+    // Live records are waiting behind the backlog
+    void onPressure() {
+        _batch /= 2;
+        if (_batch < _minBatch) _batch = _minBatch;
+    }
+
+private:
+    static const int BATCH_STEP = 10;
+    // With PUBLISH_WINDOW batches in flight a batch's ack also waits for those ahead of it:
+    // 1 s means the link carries a full window per second and still has headroom
+    static const uint32_t TARGET_ACK_MS = 1000;
+
+    int _minBatch = 1;
+    int _maxBatch = 1;
+    uint32_t _minGapMs = 0;
+    uint32_t _maxGapMs = 0;
+    int _batch = 1;
+    uint32_t _gapMs = 0;
+};
@@ -11,9 +11,18 @@ GpsModule::GpsModule(int rxPin, int txPin, long baudRate, int uartNr)
 
 void GpsModule::begin() {
     Serial.print("[GPS] Initializing GpsModule object ---> ");
+    if (!_fixMutex) _fixMutex = xSemaphoreCreateMutex();
+    _gpsSerial.setRxBufferSize(GPS_RX_BUFFER_SIZE); // Before begin()
     _gpsSerial.begin(_baudRate, SERIAL_8N1, _rxPin, _txPin);
     Serial.printf("Config: Baud=%ld, RX=%d, TX=%d ---> ", _baudRate, _rxPin, _txPin);
     _lastFixTime = millis();
+
+    // Parse on UART events: once per burst (line idle for GPS_RX_TIMEOUT_SYMBOLS), no polling
+    _gpsSerial.setRxTimeout(GPS_RX_TIMEOUT_SYMBOLS);
+    _gpsSerial.onReceiveError([this](hardwareSerial_error_t err) {
+        if (err == UART_BUFFER_FULL_ERROR || err == UART_FIFO_OVF_ERROR) _rxOverflows++;
+    });
+    _gpsSerial.onReceive([this]() { process(); }, true);
     Serial.println("Initialization finished");
 }
 
@@ -37,96 +46,177 @@ void GpsModule::sleep() {
     _gpsSerial.println("$PAIR003*39");
 }
 
+void GpsModule::setTrackMode(int rateHz, GpsTrackRing* ring) {
+    char cmd[24];
+    if (rateHz > 0 && ring) {
+        // Fix interval (PAIR050), then GGA + RMC only (PAIR062: GLL, GSA, GSV, VTG off) to keep the UART well below its rate
+        snprintf(cmd, sizeof(cmd), "PAIR050,%d", 1000 / rateHz);
+        sendCommand(cmd);
+        for (int type = 1; type <= 5; type++) {
+            if (type == 4) continue; // RMC
+            snprintf(cmd, sizeof(cmd), "PAIR062,%d,0", type);
+            sendCommand(cmd);
+        }
+        lock();
+        _track = ring;
+        _trackFixValid = false;
+        ring->setActive(true);
+        unlock();
+        Serial.printf("[GPS] Track mode on (%d Hz)\n", rateHz);
+    } else {
+        lock();
+        if (_track) {
+            if (_trackFixValid) _track->push(_trackFix); // Last epoch
+            _track->setActive(false);
+        }
+        _track = NULL;
+        _trackFixValid = false;
+        unlock();
+
+        // Back to 1 Hz with every sentence
+        sendCommand("PAIR050,1000");
+        for (int type = 0; type <= 5; type++) {
+            snprintf(cmd, sizeof(cmd), "PAIR062,%d,1", type);
+            sendCommand(cmd);
+        }
+        Serial.println("[GPS] Track mode off");
+    }
+}
+
 int GpsModule::available() {
     return _gpsSerial.available();
 }
 
 bool GpsModule::process() {
     bool encoded = false;
-
-    while (_gpsSerial.available() > 0) {
-            char c = _gpsSerial.read();
-            if (DEBUG_RAW) Serial.write(c);
-
-            if (_gps.encode(c)) {
+    uint8_t buf[128];
+
+    int n;
+    while ((n = _gpsSerial.available()) > 0) {
+        n = _gpsSerial.read(buf, n < (int)sizeof(buf) ? n : sizeof(buf));
+        for (int i = 0; i < n; i++) {
+            if (DEBUG_RAW) Serial.write(buf[i]);
+            if (_nmea.encode((char)buf[i])) {
                 encoded = true;
-                
-                // If we have valid location data, update timestamp
-                if (_gps.location.isValid()) {
-                    _lastFixTime = millis();
-                    if (!_fixAcquired) {
-                        Serial.println("[GPS] First FIX after wake/startup!");
-                        _fixAcquired = true;
-                    }
-                }
+                publish();
             }
         }
-        
-        // Check data timeout (if module transmits anything)
-        if (millis() - _lastFixTime > (GPS_DATA_TIMEOUT_MS * 4) && _fixAcquired) {
-             // Warning only if we had a fix, and now total silence on the line
-             // Serial.println("[GPS][WARN] Long silence on RX port.");
-        }
+    }
     return encoded;
 }
 
 bool GpsModule::hasFix() {
-    // We consider FIX valid if library says isValid AND data is fresh (e.g. < 5 sec)
-    // TinyGPSPlus location.age() returns age in ms since last update
-    if (!_gps.location.isValid()) return false;
-    return (_gps.location.age() < 5000);
+    // We consider FIX valid if the parser had a location AND it is fresh (e.g. < 5 sec)
+    lock();
+    bool fix = _fix.valid && millis() - _lastFixTime < GPS_DATA_TIMEOUT_MS;
+    unlock();
+    return fix;
 }
 
 GpsDataPacket GpsModule::getData() {
-    GpsDataPacket packet = {0.0, 0.0, 0.0, 0.0, 0, 0.0, false};
-    
-    if (hasFix()) {
-        packet.lat = _gps.location.lat();
-        packet.lon = _gps.location.lng();
-        packet.alt = _gps.altitude.meters();
-        packet.vel = _gps.speed.kmph();
-        packet.satellites = _gps.satellites.value();
-        packet.hdop = _gps.hdop.hdop();
-        packet.valid = true;
-    } 
-    
+    GpsDataPacket packet = {};
+
+    lock();
+    uint32_t age = millis() - _lastFixTime;
+    if (_fix.valid && age < GPS_DATA_TIMEOUT_MS) {
+        packet = _fix;
+        packet.ageMs = age;
+    }
+    packet.satellites = _fix.satellites;
+    packet.hdop = _fix.hdop;
+    packet.fixQuality = _fix.fixQuality;
+    unlock();
+
     return packet;
 }
 
+GpsStats GpsModule::getStats() {
+    GpsStats stats; // Counters written by the UART event task (single words, read without the lock)
+    stats.sentences = _nmea.passedChecksum();
+    stats.checksumErrors = _nmea.failedChecksum();
+    stats.rxOverflows = _rxOverflows;
+    return stats;
+}
+
 bool GpsModule::isTimeAvailable() {
-    return _gps.date.isValid() && _gps.time.isValid();
+    lock();
+    bool available = _unixMs != 0;
+    unlock();
+    return available;
 }
 
-uint64_t GpsModule::getUnixTime() {
-    if (!isTimeAvailable()) return 0;
+uint64_t GpsModule::getUnixTime(int64_t* parsedUs) {
+    lock();
+    uint64_t unixMs = _unixMs;
+    if (parsedUs) *parsedUs = _unixParsedUs;
+    unlock();
+    return unixMs;
+}
 
-    // Get time components
-    int year = _gps.date.year();
-    // Handle year format (library usually returns full year, but just in case)
-    if (year < 100) year += 2000; 
-    
-    struct tm t = {0};
-    t.tm_year = year - 1900;
-    t.tm_mon  = _gps.date.month() - 1;
-    t.tm_mday = _gps.date.day();
-    t.tm_hour = _gps.time.hour();
-    t.tm_min  = _gps.time.minute();
-    t.tm_sec  = _gps.time.second();
-    t.tm_isdst = 0;
-
-    // Set timezone to UTC for mktime
-    const char* oldtz = getenv("TZ");
-    setenv("TZ", "UTC0", 1);
-    tzset();
-
-    time_t secs = mktime(&t);
-
-    // Restore timezone (for system order)
-    if (oldtz) setenv("TZ", oldtz, 1);
-    else unsetenv("TZ");
-    tzset();
-
-    if (secs <= 0) return 0;
-
-    return (uint64_t)secs * 1000ULL;
+// -----------------------------------------------------
+// --------------- Private Methods ---------------------
+// -----------------------------------------------------
+
+// Called after each sentence with a valid checksum
+void GpsModule::publish() {
+    uint8_t updated = _nmea.takeUpdated();
+    const NmeaFix &nmea = _nmea.fix();
+    bool location = (updated & NMEA_UPDATED_LOCATION) && nmea.locationValid;
+    uint64_t unixMs = (updated & NMEA_UPDATED_TIME) ? _nmea.unixMs() : 0;
+    int64_t parsedUs = esp_timer_get_time();
+    bool motion = updated & NMEA_UPDATED_MOTION; // VTG may follow the position of its epoch
+    if (!location && !motion && !unixMs && !(updated & NMEA_UPDATED_QUALITY)) return;
+
+    lock();
+    if (location) {
+        _fix.lat = nmea.lat / 1e7;
+        _fix.lon = nmea.lon / 1e7;
+        _fix.alt = nmea.altCm / 100.0;
+        _fix.valid = true;
+        _lastFixTime = millis();
+    }
+    if (location || motion) _fix.vel = nmea.speedCms * 0.036;
+    if (updated & NMEA_UPDATED_QUALITY) {
+        _fix.satellites = nmea.satellites;
+        _fix.hdop = nmea.hdopCenti / 100.0;
+        _fix.fixQuality = nmea.fixQuality;
+    }
+    if (unixMs) {
+        _unixMs = unixMs;
+        _unixParsedUs = parsedUs;
+    }
+
+    // Track mode: sentences of one epoch share its time; a new time completes the previous fix
+    if (_track) {
+        if (unixMs && unixMs != _trackFix.timeMs) {
+            if (_trackFixValid) _track->push(_trackFix);
+            _trackFix = {};
+            _trackFix.timeMs = unixMs;
+            _trackFixValid = false;
+        }
+        if (location && _trackFix.timeMs) {
+            _trackFix.lat = nmea.lat;
+            _trackFix.lon = nmea.lon;
+            _trackFix.altCm = nmea.altCm;
+            _trackFix.satellites = nmea.satellites;
+            _trackFix.hdopDm = nmea.hdopCenti / 10 > 255 ? 255 : (uint8_t)(nmea.hdopCenti / 10);
+            _trackFixValid = true;
+        }
+        if ((location || motion) && _trackFixValid) {
+            _trackFix.speedCms = nmea.speedCms > 65535 ? 65535 : (uint16_t)nmea.speedCms;
+            _trackFix.courseCdeg = nmea.courseCdeg;
+        }
+    }
+    unlock();
+
+    if (location && !_fixAcquired) {
+        Serial.println("[GPS] First FIX after wake/startup!");
+        _fixAcquired = true;
+    }
+}
+
+void GpsModule::sendCommand(const char* body) {
+    uint8_t sum = 0;
+    for (const char* c = body; *c; c++) sum ^= (uint8_t)*c;
+    _gpsSerial.printf("$%s*%02X\r\n", body, sum);
 }
@@ -1,8 +1,13 @@
 #pragma once
 #include <Arduino.h>
-#include <TinyGPSPlus.h>
 #include <HardwareSerial.h>
 #include <time.h>
+#include "esp_timer.h"
+#include "GpsTrack.h"
+#include "NmeaParser.h"
+
+#define GPS_RX_BUFFER_SIZE 2048   // UART RX buffer (bytes), holds several NMEA epochs
+#define GPS_RX_TIMEOUT_SYMBOLS 10 // Line idle time (symbols) that ends a burst and wakes the parser
 
 // Helper structure for returning a complete set of data
 struct GpsDataPacket {
@@ -10,33 +15,46 @@ struct GpsDataPacket {
     double lon;
     double alt;
     double vel;
-    uint32_t satellites;
+    uint32_t satellites; // Satellites, HDOP and fix quality of the last GGA (also without a fix)
     double hdop;
+    uint8_t fixQuality;  // 0 none, 1 GPS, 2 DGPS, 4 RTK fixed, 5 RTK float, 6 dead reckoning
+    uint32_t ageMs; // Time since the fix was parsed
     bool valid;
 };
 
+// Receive counters (since begin)
+struct GpsStats {
+    uint32_t sentences;      // NMEA sentences with a valid checksum
+    uint32_t checksumErrors;
+    uint32_t rxOverflows;    // UART buffer/FIFO overflow events (bytes lost)
+};
+
 // GPS Module (Quectel L80 / PAIR commands)
+// NMEA (RMC/GGA/VTG/ZDA, NmeaParser.h) is parsed in the background: the UART event task calls process()
+// at the end of each burst (RX timeout), which publishes the latest fix. getData()/hasFix()/getUnixTime() only copy it.
 class GpsModule {
 public:
     // Constructor: accepts pin numbers, baudrate and UART number (default 1 for ESP32)
     GpsModule(int rxPin, int txPin, long baudRate = 115200, int uartNr = 1);
 
-    void begin(); // Serial port initialization
+    void begin(); // Serial port initialization, starts background parsing
     void wake(); // Wake up module (Quectel PAIR commands)
     void sleep(); // Sleep module (Quectel PAIR commands)
+    void setTrackMode(int rateHz, GpsTrackRing* ring); // rateHz > 0: fix rate + GGA/RMC only, every fix to 'ring'; 0: back to 1 Hz, all sentences
 
     int available(); // Checks if data available in serial buffer
-    bool process(); // Main read function - processes incoming data
+    bool process(); // Parses all buffered bytes and publishes the fix (UART event task)
 
     bool hasFix(); // Checks if we have a current fix
-    GpsDataPacket getData(); // Returns structure with data
+    GpsDataPacket getData(); // Returns the latest fix
+    GpsStats getStats();
 
     bool isTimeAvailable(); // Checks if time is available
-    uint64_t getUnixTime(); // Returns Unix time in ms (synchronized with GPS)
+    uint64_t getUnixTime(int64_t* parsedUs = NULL); // Returns Unix time in ms of the latest GPS epoch (parsedUs: esp_timer time it was parsed)
 
 private:
     HardwareSerial _gpsSerial;
-    TinyGPSPlus _gps;
+    NmeaParser _nmea;
     
     int _rxPin;
     int _txPin;
@@ -44,9 +62,24 @@ private:
     
     unsigned long _lastFixTime;
     bool _fixAcquired;
+
+    // Published state (guarded by _fixMutex)
+    SemaphoreHandle_t _fixMutex = NULL;
+    GpsDataPacket _fix = {};
+    uint64_t _unixMs = 0;
+    int64_t _unixParsedUs = 0;
+    volatile uint32_t _rxOverflows = 0;
+
+    // Track mode (guarded by _fixMutex): the fix of the current epoch is pushed when the next epoch starts
+    GpsTrackRing* _track = NULL;
+    GpsTrackFix _trackFix = {};
+    bool _trackFixValid = false;
     
     const unsigned long GPS_DATA_TIMEOUT_MS = 5000; 
     const bool DEBUG_RAW = false;
 
-    bool validateChecksum(); // Checksum helper
+    void sendCommand(const char* body); // Sends "$<body>*<checksum>"
+    void publish(); // Copies updated parser fields to the published fix
+    void lock() { if (_fixMutex) xSemaphoreTake(_fixMutex, portMAX_DELAY); }
+    void unlock() { if (_fixMutex) xSemaphoreGive(_fixMutex); }
 };
@@ -0,0 +1,97 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+// GPS track log (TRK_*.trk): every fix in track mode, in blocks stored as one LogFrame each
+// (flags = GPS_TRACK_FRAME_BLOCK).
+// Block: [base_ms:8 LE] then GPS_TRACK_RECORD_SIZE-byte records
+//   [dt_ms:4][lat:4][lon:4][alt_cm:4][speed_cms:2][course_cdeg:2][satellites:1][hdop_dm:1] (LE)
+//   base_ms = GPS time (Unix ms) of the first fix, dt_ms = fix time - base_ms, lat/lon in 1e-7 degrees
+// Decode on a PC with tools/track_export (CSV or GPX).
+#define GPS_TRACK_FRAME_BLOCK  0x11
+#define GPS_TRACK_BLOCK_HEADER 8
+#define GPS_TRACK_RECORD_SIZE  22
+#define GPS_TRACK_BLOCK_FIXES  128  // Fixes per block (12.8 s at 10 Hz)
+#define GPS_TRACK_RING_SIZE    512  // Fixes buffered in RAM (51 s at 10 Hz), power of two
+#define GPS_TRACK_BLOCK_SIZE   (GPS_TRACK_BLOCK_HEADER + GPS_TRACK_BLOCK_FIXES * GPS_TRACK_RECORD_SIZE)
+
+struct GpsTrackFix {
+    uint64_t timeMs;     // GPS time (Unix ms)
+    int32_t lat;         // 1e-7 degrees
+    int32_t lon;
+    int32_t altCm;
+    uint16_t speedCms;
+    uint16_t courseCdeg; // 0.01 degrees
+    uint8_t satellites;
+    uint8_t hdopDm;      // HDOP * 10
+};
+
+// Fixed-size ring between the GPS parser (producer, UART event task) and TaskSdWriter (consumer).
+// A fix is dropped (and counted) only when the ring is full.
+class GpsTrackRing {
+public:
+    // --- Producer ---
+    bool push(const GpsTrackFix &fix) {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) >= GPS_TRACK_RING_SIZE) {
+            _dropped++;
+            return false;
+        }
+        _fixes[head & (GPS_TRACK_RING_SIZE - 1)] = fix;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Track mode on/off (producer side); the consumer closes the log once stopped and drained
+    void setActive(bool active) { _active.store(active, std::memory_order_release); }
+    bool active() const { return _active.load(std::memory_order_acquire); }
+
+    // --- Consumer ---
+    int pop(GpsTrackFix* out, int max) {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        uint32_t count = _head.load(std::memory_order_acquire) - tail;
+        if (count > (uint32_t)max) count = max;
+        for (uint32_t i = 0; i < count; i++) out[i] = _fixes[(tail + i) & (GPS_TRACK_RING_SIZE - 1)];
+        _tail.store(tail + count, std::memory_order_release);
+        return (int)count;
+    }
+
+    uint32_t size() const { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire); }
+    uint32_t dropped() const { return _dropped; }
+
+private:
+    GpsTrackFix _fixes[GPS_TRACK_RING_SIZE];
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _tail{0};
+    std::atomic<bool> _active{false};
+    uint32_t _dropped = 0;
+};
+
+static_assert((GPS_TRACK_RING_SIZE & (GPS_TRACK_RING_SIZE - 1)) == 0, "GPS_TRACK_RING_SIZE must be a power of two");
+
+// Encodes up to GPS_TRACK_BLOCK_FIXES fixes into 'out' (GPS_TRACK_BLOCK_SIZE bytes). Returns the length.
+// Fixes more than 49 days after the first one must start a new block (dt_ms is 32 bit).
+inline size_t gpsTrackEncodeBlock(const GpsTrackFix* fixes, int count, uint8_t* out) {
+    auto put = [](uint8_t* p, uint64_t v, int bytes) {
+        for (int i = 0; i < bytes; i++) p[i] = (uint8_t)(v >> (8 * i));
+    };
+    if (count <= 0) return 0;
+    if (count > GPS_TRACK_BLOCK_FIXES) count = GPS_TRACK_BLOCK_FIXES;
+
+    uint64_t base = fixes[0].timeMs;
+    put(out, base, 8);
+    uint8_t* p = out + GPS_TRACK_BLOCK_HEADER;
+    for (int i = 0; i < count; i++, p += GPS_TRACK_RECORD_SIZE) {
+        const GpsTrackFix &f = fixes[i];
+        put(p, f.timeMs - base, 4);
+        put(p + 4, (uint32_t)f.lat, 4);
+        put(p + 8, (uint32_t)f.lon, 4);
+        put(p + 12, (uint32_t)f.altCm, 4);
+        put(p + 16, f.speedCms, 2);
+        put(p + 18, f.courseCdeg, 2);
+        p[20] = f.satellites;
+        p[21] = f.hdopDm;
+    }
+    return GPS_TRACK_BLOCK_HEADER + (size_t)count * GPS_TRACK_RECORD_SIZE;
+}
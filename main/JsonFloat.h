@@ -0,0 +1,136 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+// Float to JSON text exactly like ArduinoJson 7 (TextFormatter::writeFloat / FloatParts.hpp):
+// the value is converted to JsonFloat (double) first, normalised with binary powers of ten outside
+// 1e-5..1e7, then split into integral part, rounded decimals (9 places for double, 6 for float) and
+// exponent, trailing zeros dropped. NaN and inf are "null", -0 is "0".
+// Shared by JsonWriter (firmware) and tools/sdlog_decode, so both print what serializeJson() prints.
+#define JSON_FLOAT_PLACES_DOUBLE 9
+#define JSON_FLOAT_PLACES_FLOAT  6
+#define JSON_FLOAT_MAX_LENGTH    32 // "-4294967295.999999999e-308" fits
+
+struct JsonFloatParts {
+    uint32_t integral;
+    uint32_t decimal;
+    int16_t exponent;
+    int8_t decimalPlaces;
+};
+
+// Scales value into 1..1e7 when it is outside 1e-5..1e7. Returns the power of ten taken out.
+inline int16_t jsonNormalizeFloat(double &value) {
+    static const double positive[9] = {1e1, 1e2, 1e4, 1e8, 1e16, 1e32, 1e64, 1e128, 1e256};
+    static const double negative[9] = {1e-1, 1e-2, 1e-4, 1e-8, 1e-16, 1e-32, 1e-64, 1e-128, 1e-256};
+    int16_t powersOf10 = 0;
+    int index = 8;
+    int bit = 1 << index;
+
+    if (value >= 1e7) {
+        for (; index >= 0; index--) {
+            if (value >= positive[index]) {
+                value *= negative[index];
+                powersOf10 = (int16_t)(powersOf10 + bit);
+            }
+            bit >>= 1;
+        }
+    }
+    if (value > 0 && value <= 1e-5) {
+        for (; index >= 0; index--) {
+            if (value < negative[index] * 10) {
+                value *= positive[index];
+                powersOf10 = (int16_t)(powersOf10 - bit);
+            }
+            bit >>= 1;
+        }
+    }
+    return powersOf10;
+}
+
+// value >= 0
+inline JsonFloatParts jsonDecomposeFloat(double value, int8_t decimalPlaces) {
+    uint32_t maxDecimalPart = 1;
+    for (int i = 0; i < decimalPlaces; ++i) maxDecimalPart *= 10;
+
+    int16_t exponent = jsonNormalizeFloat(value);
+
+    uint32_t integral = (uint32_t)value;
+    for (uint32_t tmp = integral; tmp >= 10; tmp /= 10) {
+        maxDecimalPart /= 10;
+        decimalPlaces--;
+    }
+
+    double remainder = (value - (double)integral) * (double)maxDecimalPart;
+    uint32_t decimal = (uint32_t)remainder;
+    remainder = remainder - (double)decimal;
+
+    // Round half up, carry into the integral part (and the exponent)
+    decimal += (uint32_t)(remainder * 2);
+    if (decimal >= maxDecimalPart) {
+        decimal = 0;
+        integral++;
+        if (exponent && integral >= 10) {
+            exponent++;
+            integral = 1;
+        }
+    }
+
+    while (decimal % 10 == 0 && decimalPlaces > 0) {
+        decimal /= 10;
+        decimalPlaces--;
+    }
+    return {integral, decimal, exponent, decimalPlaces};
+}
+
+// Writes the JSON text of value to out (at least JSON_FLOAT_MAX_LENGTH bytes, not terminated).
+// Returns its length.
+inline size_t jsonFormatFloat(char* out, double value, int8_t decimalPlaces) {
+    size_t n = 0;
+    if (isnan(value) || isinf(value)) {
+        memcpy(out, "null", 4);
+        return 4;
+    }
+    if (value < 0.0) {
+        out[n++] = '-';
+        value = -value;
+    }
+
+    JsonFloatParts parts = jsonDecomposeFloat(value, decimalPlaces);
+
+    char tmp[10];
+    size_t t = sizeof(tmp);
+    do {
+        tmp[--t] = (char)('0' + parts.integral % 10);
+        parts.integral /= 10;
+    } while (parts.integral);
+    memcpy(out + n, tmp + t, sizeof(tmp) - t);
+    n += sizeof(tmp) - t;
+
+    if (parts.decimalPlaces > 0) {
+        out[n++] = '.';
+        for (int i = parts.decimalPlaces - 1; i >= 0; --i) {
+            out[n + i] = (char)('0' + parts.decimal % 10);
+            parts.decimal /= 10;
+        }
+        n += parts.decimalPlaces;
+    }
+
+    if (parts.exponent) {
+        out[n++] = 'e';
+        int e = parts.exponent;
+        if (e < 0) {
+            out[n++] = '-';
+            e = -e;
+        }
+        t = sizeof(tmp);
+        do {
+            tmp[--t] = (char)('0' + e % 10);
+            e /= 10;
+        } while (e);
+        memcpy(out + n, tmp + t, sizeof(tmp) - t);
+        n += sizeof(tmp) - t;
+    }
+    return n;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <Arduino.h>
+#include "JsonFloat.h"
+
+// JSON text writer without a document: formats into a fixed buffer, a Print sink,
+// or nowhere (length only). Numbers are formatted like ArduinoJson 7, so the output
+// is byte-identical to serializeJson() of the same values.
+// It is a Print itself, so serializeJson(doc, writer) gets the same buffering/counting.
+class JsonWriter : public Print {
+public:
+    JsonWriter() {} // Counts bytes only
+    JsonWriter(char* buf, size_t cap) : _buf(buf), _cap(cap) {
+        if (cap) buf[0] = '\0';
+    }
+    explicit JsonWriter(Print &out) : _out(&out) {}
+    ~JsonWriter() { flush(); }
+
+    size_t length() const { return _len; } // Bytes written (or needed, when overflowed)
+    bool overflowed() const { return _overflow; } // Buffer too small or Print write failed
+
+    // Print interface
+    size_t write(uint8_t c) override {
+        write((const char*)&c, 1);
+        return 1;
+    }
+    size_t write(const uint8_t* s, size_t n) override {
+        write((const char*)s, n);
+        return n;
+    }
+
+    // Pushes staged bytes to the Print sink
+    void flush() override {
+        if (_out && _stageLen) {
+            if (_out->write((const uint8_t*)_stage, _stageLen) != _stageLen) _overflow = true;
+            _stageLen = 0;
+        }
+    }
+
+    void write(const char* s, size_t n) {
+        if (_out) {
+            // Small writes are staged, a Print write can be a socket send
+            if (_stageLen + n > sizeof(_stage)) flush();
+            if (n > sizeof(_stage)) {
+                if (_out->write((const uint8_t*)s, n) != n) _overflow = true;
+            } else {
+                memcpy(_stage + _stageLen, s, n);
+                _stageLen += n;
+            }
+        } else if (_buf && !_overflow) {
+            if (_len + n < _cap) {
+                memcpy(_buf + _len, s, n);
+                _buf[_len + n] = '\0';
+            } else {
+                _overflow = true;
+            }
+        }
+        _len += n;
+    }
+    void write(const char* s) { write(s, strlen(s)); }
+    void write(char c) { write(&c, 1); }
+
+    // "key": (keys are literals from the X-macro, no escaping)
+    void key(const char* k) {
+        write('"');
+        write(k);
+        write("\":", 2);
+    }
+
+    void value(uint64_t v) { writeUnsigned(v); }
+    void value(uint8_t v)  { writeUnsigned(v); }
+    void value(int v) {
+        if (v < 0) {
+            write('-');
+            writeUnsigned((uint64_t)(-(int64_t)v));
+        } else {
+            writeUnsigned((uint64_t)v);
+        }
+    }
+    void value(bool v) { v ? write("true", 4) : write("false", 5); }
+    void value(double v) { writeFloat(v, JSON_FLOAT_PLACES_DOUBLE); }
+    void value(float v)  { writeFloat(v, JSON_FLOAT_PLACES_FLOAT); } // Through double, like ArduinoJson
+
+private:
+    char* _buf = nullptr;
+    size_t _cap = 0;
+    Print* _out = nullptr;
+    size_t _len = 0;
+    bool _overflow = false;
+    char _stage[256];
+    size_t _stageLen = 0;
+
+    void writeUnsigned(uint64_t v) {
+        char tmp[20];
+        size_t n = sizeof(tmp);
+        do {
+            tmp[--n] = (char)('0' + v % 10);
+            v /= 10;
+        } while (v);
+        write(tmp + n, sizeof(tmp) - n);
+    }
+
+    void writeFloat(double x, int8_t places) {
+        char tmp[JSON_FLOAT_MAX_LENGTH];
+        write(tmp, jsonFormatFloat(tmp, x, places));
+    }
+};
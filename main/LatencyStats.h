@@ -0,0 +1,47 @@
+#pragma once
+#include <Arduino.h>
+
+// Log2 latency histogram in microseconds: bucket i counts samples in [2^i, 2^(i+1)) us
+struct LatencyHistogram {
+    static const int BUCKETS = 24; // Up to ~16 s
+
+    uint32_t counts[BUCKETS] = {0};
+    uint32_t samples = 0;
+    uint32_t maxUs = 0;
+    uint64_t totalUs = 0;
+
+    void record(uint32_t us) {
+        int bucket = 0;
+        while (bucket < BUCKETS - 1 && (us >> (bucket + 1)) != 0) bucket++;
+        counts[bucket]++;
+        samples++;
+        totalUs += us;
+        if (us > maxUs) maxUs = us;
+    }
+
+    void reset() {
+        memset(counts, 0, sizeof(counts));
+        samples = 0;
+        maxUs = 0;
+        totalUs = 0;
+    }
+
+    // Upper bound (us) of the bucket containing the given percentile (0..100)
+    uint32_t percentile(float p) const {
+        if (samples == 0) return 0;
+        uint32_t target = (uint32_t)(samples * p / 100.0f);
+        uint32_t seen = 0;
+        for (int i = 0; i < BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen > target) return 1UL << (i + 1);
+        }
+        return maxUs;
+    }
+
+    void print(const char* name) const {
+        if (samples == 0) return;
+        Serial.printf("[STATS] %s: n=%lu avg=%lu us p50<%lu us p99<%lu us max=%lu us\n",
+                      name, (unsigned long)samples, (unsigned long)(totalUs / samples),
+                      (unsigned long)percentile(50), (unsigned long)percentile(99), (unsigned long)maxUs);
+    }
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Record framing for append-only SD logs
+// [magic:1][flags:1][length:2 LE][crc32:4 LE][payload:length]
+// A torn write (power loss) breaks only one frame - readers resync on the next magic byte.
+#define LOG_FRAME_MAGIC        0xA5
+#define LOG_FRAME_HEADER_SIZE  8
+#define LOG_FRAME_MAX_PAYLOAD  1024
+
+struct LogFrameHeader {
+    uint8_t  flags;
+    uint16_t length;
+    uint32_t crc;
+};
+
+// CRC-32 (IEEE 802.3, reflected), nibble table to keep flash usage small
+inline uint32_t logCrc32(const uint8_t* data, size_t len, uint32_t crc = 0) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+// Fills 'out' (LOG_FRAME_HEADER_SIZE bytes) with the header for 'payload'
+inline void logFrameEncodeHeader(uint8_t* out, const uint8_t* payload, uint16_t length, uint8_t flags = 0) {
+    uint32_t crc = logCrc32(payload, length);
+    out[0] = LOG_FRAME_MAGIC;
+    out[1] = flags;
+    out[2] = (uint8_t)(length & 0xFF);
+    out[3] = (uint8_t)(length >> 8);
+    out[4] = (uint8_t)(crc & 0xFF);
+    out[5] = (uint8_t)((crc >> 8) & 0xFF);
+    out[6] = (uint8_t)((crc >> 16) & 0xFF);
+    out[7] = (uint8_t)(crc >> 24);
+}
+
+// Parses a header. Returns false if magic or length are not plausible.
+// Logs with larger frames (compressed archive blocks) pass their own limit.
+inline bool logFrameDecodeHeader(const uint8_t* in, LogFrameHeader &hdr, uint16_t maxLength = LOG_FRAME_MAX_PAYLOAD) {
+    if (in[0] != LOG_FRAME_MAGIC) return false;
+    hdr.flags  = in[1];
+    hdr.length = (uint16_t)(in[2] | (in[3] << 8));
+    hdr.crc    = (uint32_t)in[4] | ((uint32_t)in[5] << 8) | ((uint32_t)in[6] << 16) | ((uint32_t)in[7] << 24);
+    return hdr.length > 0 && hdr.length <= maxLength;
+}
+
+// Verifies payload against header CRC
+inline bool logFrameVerify(const LogFrameHeader &hdr, const uint8_t* payload) {
+    return logCrc32(payload, hdr.length) == hdr.crc;
+}
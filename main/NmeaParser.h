@@ -0,0 +1,348 @@
+#pragma once
+#include <stdint.h>
+
+// Allocation-free NMEA 0183 parser for the sentences the logger uses: RMC, GGA, VTG, ZDA (any talker).
+// Other sentences are skipped without checksumming. Fields are parsed in fixed point while the
+// bytes arrive; a sentence changes the published fields only when its checksum matches.
+enum NmeaSentence : uint8_t { NMEA_NONE = 0, NMEA_RMC, NMEA_GGA, NMEA_VTG, NMEA_ZDA };
+
+// Fields updated by a sentence (takeUpdated())
+#define NMEA_UPDATED_LOCATION (1 << 0) // Position of a valid fix (RMC 'A' / GGA quality > 0)
+#define NMEA_UPDATED_TIME     (1 << 1) // UTC time of day (RMC/GGA/ZDA)
+#define NMEA_UPDATED_DATE     (1 << 2) // UTC date (RMC/ZDA)
+#define NMEA_UPDATED_MOTION   (1 << 3) // Speed and course (RMC/VTG)
+#define NMEA_UPDATED_QUALITY  (1 << 4) // Fix quality, satellites, HDOP, altitude (GGA)
+
+#define NMEA_MAX_SENTENCE 96 // Longer sentences are dropped (NMEA allows 82 bytes)
+
+struct NmeaFix {
+    bool locationValid; // Last RMC/GGA reported a fix
+    int32_t lat;        // 1e-7 degrees
+    int32_t lon;
+    int32_t altCm;      // Above mean sea level
+    uint32_t speedCms;  // Speed over ground (cm/s)
+    uint16_t courseCdeg;
+    uint8_t fixQuality; // GGA: 0 none, 1 GPS, 2 DGPS, 4 RTK fixed, 5 RTK float, 6 dead reckoning
+    uint8_t satellites;
+    uint16_t hdopCenti; // HDOP * 100
+    bool timeValid;
+    bool dateValid;
+    uint32_t timeCs;    // UTC time of day (centiseconds)
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+};
+
+// Days since 1970-01-01 of a civil (proleptic Gregorian) date
+inline int64_t nmeaDaysFromCivil(int year, int month, int day) {
+    int y = year - (month <= 2);
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (int64_t)era * 146097 + doe - 719468;
+}
+
+class NmeaParser {
+public:
+    // Feeds one byte. Returns the sentence type when a sentence with a valid checksum ends, else NMEA_NONE.
+    NmeaSentence encode(char c) {
+        if (c == '$') {
+            begin();
+            return NMEA_NONE;
+        }
+        if (_state == SKIP) return NMEA_NONE;
+        if (++_length > NMEA_MAX_SENTENCE) {
+            _state = SKIP;
+            return NMEA_NONE;
+        }
+
+        if (_state == CHECKSUM) {
+            int digit = hexDigit(c);
+            if (digit < 0) {
+                _state = SKIP;
+                return NMEA_NONE;
+            }
+            _received = (_received << 4) | digit;
+            if (++_checksumDigits < 2) return NMEA_NONE;
+            _state = SKIP;
+            if (_received != _checksum) {
+                _failed++;
+                return NMEA_NONE;
+            }
+            _passed++;
+            commit();
+            return _type;
+        }
+
+        // Field data
+        if (c == '\r' || c == '\n') {
+            _state = SKIP; // No checksum: dropped
+            return NMEA_NONE;
+        }
+        if (c == '*') {
+            endField();
+            _state = CHECKSUM;
+            return NMEA_NONE;
+        }
+        _checksum ^= (uint8_t)c;
+        if (c == ',') {
+            endField();
+            if (_state == SKIP) return NMEA_NONE;
+            _field++;
+            _fieldLength = 0;
+            return NMEA_NONE;
+        }
+        if (_fieldLength < FIELD_SIZE - 1) _term[_fieldLength++] = c;
+        else _state = SKIP; // No field of the parsed sentences is this long
+        return NMEA_NONE;
+    }
+
+    const NmeaFix &fix() const { return _fix; }
+
+    // NMEA_UPDATED_* bits set since the last call
+    uint8_t takeUpdated() {
+        uint8_t updated = _updated;
+        _updated = 0;
+        return updated;
+    }
+
+    // UTC date and time of the last sentence as Unix ms (0 until both are known)
+    uint64_t unixMs() const {
+        if (!_fix.timeValid || !_fix.dateValid) return 0;
+        return (uint64_t)nmeaDaysFromCivil(_fix.year, _fix.month, _fix.day) * 86400000ULL + (uint64_t)_fix.timeCs * 10ULL;
+    }
+
+    uint32_t passedChecksum() const { return _passed; }
+    uint32_t failedChecksum() const { return _failed; }
+
+private:
+    enum State : uint8_t { SKIP, FIELDS, CHECKSUM };
+    static const int FIELD_SIZE = 16;
+
+    // Fields of the sentence being received (published by commit())
+    struct Pending {
+        uint8_t present;    // PENDING_* bits
+        char status;        // RMC 'A'/'V'
+        uint8_t fixQuality;
+        uint8_t satellites;
+        uint16_t hdopCenti;
+        int32_t altCm;
+        int64_t lat;
+        int64_t lon;
+        uint32_t speedCms;
+        uint16_t courseCdeg;
+        uint32_t timeCs;
+        uint16_t year;
+        uint8_t month;
+        uint8_t day;
+    };
+    enum : uint8_t {
+        PENDING_TIME = 1 << 0, PENDING_DATE = 1 << 1, PENDING_LAT = 1 << 2, PENDING_LON = 1 << 3,
+        PENDING_SPEED = 1 << 4, PENDING_COURSE = 1 << 5, PENDING_ALT = 1 << 6, PENDING_QUALITY = 1 << 7
+    };
+
+    NmeaFix _fix = {};
+    Pending _p = {};
+    uint8_t _updated = 0;
+    uint32_t _passed = 0;
+    uint32_t _failed = 0;
+
+    State _state = SKIP;
+    NmeaSentence _type = NMEA_NONE;
+    uint8_t _field = 0;
+    uint8_t _fieldLength = 0;
+    uint8_t _length = 0;
+    uint8_t _checksum = 0;
+    uint8_t _received = 0;
+    uint8_t _checksumDigits = 0;
+    char _term[FIELD_SIZE];
+
+    void begin() {
+        _state = FIELDS;
+        _type = NMEA_NONE;
+        _field = 0;
+        _fieldLength = 0;
+        _length = 0;
+        _checksum = 0;
+        _received = 0;
+        _checksumDigits = 0;
+        _p = Pending();
+    }
+
+    static int hexDigit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
+
+    // Parses "[-]int[.frac]" as value * 10^decimals (extra digits truncated). False if empty or malformed.
+    bool decimal(int decimals, int64_t &out) const {
+        int i = 0;
+        bool negative = _fieldLength > 0 && _term[0] == '-';
+        if (negative) i++;
+        if (i >= _fieldLength) return false;
+        int64_t v = 0;
+        int fraction = -1;
+        for (; i < _fieldLength; i++) {
+            char c = _term[i];
+            if (c == '.' && fraction < 0) {
+                fraction = 0;
+            } else if (c >= '0' && c <= '9') {
+                if (fraction >= 0) {
+                    if (fraction == decimals) continue;
+                    fraction++;
+                }
+                v = v * 10 + (c - '0');
+            } else {
+                return false;
+            }
+        }
+        for (int f = fraction < 0 ? 0 : fraction; f < decimals; f++) v *= 10;
+        out = negative ? -v : v;
+        return true;
+    }
+
+    // "(d)ddmm.mmmm" to 1e-7 degrees
+    bool coordinate(int64_t &out) const {
+        int64_t v;
+        if (!decimal(7, v)) return false; // ddmm * 1e7 + minute fraction
+        int64_t degrees = v / 1000000000LL;
+        out = degrees * 10000000LL + (v - degrees * 1000000000LL) / 60;
+        return true;
+    }
+
+    int digits2(int at) const { return (_term[at] - '0') * 10 + (_term[at + 1] - '0'); }
+
+    bool allDigits(int count) const {
+        if (_fieldLength < count) return false;
+        for (int i = 0; i < count; i++) {
+            if (_term[i] < '0' || _term[i] > '9') return false;
+        }
+        return true;
+    }
+
+    // "hhmmss[.ss]"
+    void parseTime() {
+        if (!allDigits(6)) return;
+        int64_t seconds;
+        if (!decimal(2, seconds)) return; // hhmmss * 100 + cs
+        uint32_t cs = (uint32_t)(seconds % 100);
+        _p.timeCs = digits2(0) * 360000UL + digits2(2) * 6000UL + digits2(4) * 100UL + cs;
+        _p.present |= PENDING_TIME;
+    }
+
+    // Sentence type from the address field ("GPRMC", "GNGGA", ...)
+    void parseAddress() {
+        if (_fieldLength != 5) {
+            _state = SKIP;
+            return;
+        }
+        const char* t = _term + 2;
+        if (t[0] == 'R' && t[1] == 'M' && t[2] == 'C') _type = NMEA_RMC;
+        else if (t[0] == 'G' && t[1] == 'G' && t[2] == 'A') _type = NMEA_GGA;
+        else if (t[0] == 'V' && t[1] == 'T' && t[2] == 'G') _type = NMEA_VTG;
+        else if (t[0] == 'Z' && t[1] == 'D' && t[2] == 'A') _type = NMEA_ZDA;
+        else _state = SKIP;
+    }
+
+    void endField() {
+        if (_field == 0) {
+            parseAddress();
+            return;
+        }
+        int64_t v;
+        char first = _fieldLength ? _term[0] : 0;
+        switch (_type) {
+        case NMEA_RMC:
+            switch (_field) {
+            case 1: parseTime(); break;
+            case 2: _p.status = first; break;
+            case 3: if (coordinate(_p.lat)) _p.present |= PENDING_LAT; break;
+            case 4: if (first == 'S') _p.lat = -_p.lat; break;
+            case 5: if (coordinate(_p.lon)) _p.present |= PENDING_LON; break;
+            case 6: if (first == 'W') _p.lon = -_p.lon; break;
+            case 7: if (decimal(3, v) && v >= 0) { _p.speedCms = (uint32_t)(v * 463 / 9000); _p.present |= PENDING_SPEED; } break; // knots
+            case 8: if (decimal(2, v) && v >= 0 && v < 36000) { _p.courseCdeg = (uint16_t)v; _p.present |= PENDING_COURSE; } break;
+            case 9:
+                if (_fieldLength == 6 && allDigits(6)) {
+                    _p.day = digits2(0);
+                    _p.month = digits2(2);
+                    _p.year = 2000 + digits2(4);
+                    _p.present |= PENDING_DATE;
+                }
+                break;
+            }
+            break;
+        case NMEA_GGA:
+            switch (_field) {
+            case 1: parseTime(); break;
+            case 2: if (coordinate(_p.lat)) _p.present |= PENDING_LAT; break;
+            case 3: if (first == 'S') _p.lat = -_p.lat; break;
+            case 4: if (coordinate(_p.lon)) _p.present |= PENDING_LON; break;
+            case 5: if (first == 'W') _p.lon = -_p.lon; break;
+            case 6: if (decimal(0, v) && v >= 0 && v < 10) { _p.fixQuality = (uint8_t)v; _p.present |= PENDING_QUALITY; } break;
+            case 7: if (decimal(0, v) && v >= 0) _p.satellites = v > 255 ? 255 : (uint8_t)v; break;
+            case 8: if (decimal(2, v) && v >= 0) _p.hdopCenti = v > 65535 ? 65535 : (uint16_t)v; break;
+            case 9: if (decimal(2, v)) { _p.altCm = (int32_t)v; _p.present |= PENDING_ALT; } break;
+            }
+            break;
+        case NMEA_VTG:
+            switch (_field) {
+            case 1: if (decimal(2, v) && v >= 0 && v < 36000) { _p.courseCdeg = (uint16_t)v; _p.present |= PENDING_COURSE; } break;
+            case 7: if (decimal(3, v) && v >= 0) { _p.speedCms = (uint32_t)(v / 36); _p.present |= PENDING_SPEED; } break; // km/h
+            }
+            break;
+        case NMEA_ZDA:
+            switch (_field) {
+            case 1: parseTime(); break;
+            case 2: if (decimal(0, v) && v >= 1 && v <= 31) _p.day = (uint8_t)v; break;
+            case 3: if (decimal(0, v) && v >= 1 && v <= 12) _p.month = (uint8_t)v; break;
+            case 4: if (decimal(0, v) && v >= 1970 && v < 2100 && _p.day && _p.month) { _p.year = (uint16_t)v; _p.present |= PENDING_DATE; } break;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Checksum matched: publish the sentence
+    void commit() {
+        uint8_t present = _p.present;
+        if (present & PENDING_TIME) {
+            _fix.timeCs = _p.timeCs;
+            _fix.timeValid = true;
+            _updated |= NMEA_UPDATED_TIME;
+        }
+        if (present & PENDING_DATE) {
+            _fix.year = _p.year;
+            _fix.month = _p.month;
+            _fix.day = _p.day;
+            _fix.dateValid = _p.month >= 1 && _p.month <= 12 && _p.day >= 1;
+            if (_fix.dateValid) _updated |= NMEA_UPDATED_DATE;
+        }
+
+        if (_type == NMEA_RMC || _type == NMEA_GGA) {
+            bool hasFix = _type == NMEA_RMC ? _p.status == 'A' : (present & PENDING_QUALITY) && _p.fixQuality > 0;
+            _fix.locationValid = hasFix && (present & PENDING_LAT) && (present & PENDING_LON);
+            if (_fix.locationValid) {
+                _fix.lat = (int32_t)_p.lat;
+                _fix.lon = (int32_t)_p.lon;
+                _updated |= NMEA_UPDATED_LOCATION;
+            }
+        }
+        if (_type == NMEA_GGA) {
+            _fix.fixQuality = _p.fixQuality;
+            _fix.satellites = _p.satellites;
+            _fix.hdopCenti = _p.hdopCenti;
+            if (present & PENDING_ALT) _fix.altCm = _p.altCm;
+            _updated |= NMEA_UPDATED_QUALITY;
+        }
+        if (present & (PENDING_SPEED | PENDING_COURSE)) {
+            if (present & PENDING_SPEED) _fix.speedCms = _p.speedCms;
+            if (present & PENDING_COURSE) _fix.courseCdeg = _p.courseCdeg;
+            _updated |= NMEA_UPDATED_MOTION;
+        }
+    }
+};
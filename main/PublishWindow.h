@@ -0,0 +1,114 @@
+#pragma once
+#include <Arduino.h>
+#include "SdModule.h"
+
+// Backlog batch published but not yet acknowledged
+struct InFlightBatch {
+    uint32_t ackId;       // Ack marker sent behind the batch
+    PendingCursor next;   // Upload cursor after the batch
+    int count;            // Records in the batch
+    unsigned long sentAt; // millis() at publish
+};
+
+// FIFO of in-flight backlog batches. Batches are acknowledged in publish order, so the
+// upload cursor is only ever moved to the front entry's cursor.
+template <int N>
+class PublishWindow {
+public:
+    bool empty() const { return _count == 0; }
+    bool full() const { return _count == N; }
+    int size() const { return _count; }
+
+    const InFlightBatch &front() const { return _items[_head]; }
+    const InFlightBatch &back() const { return _items[(_head + _count - 1) % N]; }
+
+    void push(const InFlightBatch &batch) {
+        _items[(_head + _count) % N] = batch;
+        _count++;
+    }
+    void pop() {
+        _head = (_head + 1) % N;
+        _count--;
+    }
+    void clear() {
+        _head = 0;
+        _count = 0;
+    }
+
+private:
+    InFlightBatch _items[N];
+    int _head = 0;
+    int _count = 0;
+};
+
+// Live (Ring Buffer) records published but not yet acknowledged. One ack marker covers every record
+// published before it, so markers are requested per group of batches (cover()) instead of per batch.
+// Records stay here until their marker is answered or given up, then go to the SD writer.
+template <int Records, int Markers>
+class LiveAckWindow {
+public:
+    bool empty() const { return _count == 0; }
+    int space() const { return Records - _count; }
+    int uncoveredBatches() const { return _batches; }
+    unsigned long uncoveredSince() const { return _uncoveredAt; } // millis() of the first uncovered batch
+    bool canCover() const { return _batches > 0 && _markers < Markers; }
+
+    bool hasMarker() const { return _markers > 0; }
+    uint32_t frontAckId() const { return _items[0].ackId; }
+    uint32_t backAckId() const { return _items[_markers - 1].ackId; }
+    unsigned long frontSentAt() const { return _items[0].sentAt; }
+    int frontCount() const { return _items[0].end; } // Records covered by the oldest marker
+    bool frontResolved() const { return _items[0].resolved; }
+    bool frontSent() const { return _items[0].sent; }
+    int size() const { return _count; }
+    SensorData* records() { return _records; }        // Oldest first
+
+    // 'count' <= space()
+    void add(const SensorData* records, int count) {
+        if (_batches == 0) _uncoveredAt = millis();
+        memcpy(_records + _count, records, count * sizeof(SensorData));
+        _count += count;
+        _batches++;
+    }
+
+    // Ack marker published behind all records added so far
+    void cover(uint32_t ackId) {
+        _items[_markers++] = {ackId, _count, millis(), false, false};
+        _batches = 0;
+    }
+
+    // Oldest marker answered (sent) or given up: its records can go to SD, possibly in several parts
+    void resolveFront(bool sent) {
+        _items[0].resolved = true;
+        _items[0].sent = sent;
+    }
+
+    // Drops the oldest 'count' records (at most frontCount() while there are markers); a marker is
+    // removed with its last record
+    void drop(int count) {
+        memmove(_records, _records + count, (_count - count) * sizeof(SensorData));
+        _count -= count;
+        for (int i = 0; i < _markers; i++) _items[i].end -= count;
+        if (_markers && _items[0].end == 0) {
+            _markers--;
+            for (int i = 0; i < _markers; i++) _items[i] = _items[i + 1];
+        }
+        if (_count == 0) _batches = 0;
+    }
+
+private:
+    struct Marker {
+        uint32_t ackId;
+        int end;               // Records before the marker
+        unsigned long sentAt;
+        bool resolved;
+        bool sent;             // Answered (valid once resolved)
+    };
+
+    SensorData _records[Records];
+    Marker _items[Markers];
+    int _count = 0;
+    int _markers = 0;
+    int _batches = 0;          // Batches after the newest marker
+    unsigned long _uncoveredAt = 0;
+};
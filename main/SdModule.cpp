@@ -1,4 +1,5 @@
 #include "SdModule.h"
+#include <algorithm>
 
 // Constructor
 SdModule::SdModule(int csPin) : _csPin(csPin) {}
@@ -44,6 +45,7 @@ bool SdModule::ensureReady(bool force) {
     // If we reach here, either force=true OR _initialized=false
     
     // Always clean up first
+    closeHandles();
     SD.end(); 
     _initialized = false;
 
@@ -52,14 +54,14 @@ bool SdModule::ensureReady(bool force) {
         Serial.println("[SD] Mount/Restart successful.");
         _initialized = true;
         
-        // Ensure pending file exists
-        if (!SD.exists(_pendingFilename)) {
-            File p = SD.open(_pendingFilename, FILE_WRITE);
-            if(p) {
-                p.close();
-                Serial.println("[SD] Pending file created.");
-            }
+        // Ensure pending queue exists and restore cursor
+        if (!SD.exists(_queueDir)) {
+            if (SD.mkdir(_queueDir)) Serial.println("[SD] Pending queue created.");
         }
+        _queueLoaded = false;
+        loadQueueState();
+        migrateLegacyPending();
+        _indexCheckPending = true; // Archives copied in or written before indexing existed
     } else {
         Serial.println("[SD] Mount failed.");
     }
@@ -69,166 +71,181 @@ bool SdModule::ensureReady(bool force) {
 }
 
 // -----------------------------------------------------
-// --------------- PENDING FILE (FIFO) -----------------
+// --------------- PENDING QUEUE (FIFO) ----------------
 // -----------------------------------------------------
+// Records are appended once as CRC-framed ThingsBoard JSON into /queue/NNNNNNNN.seg.
+// Upload progress is a persisted cursor, so acknowledging a batch is a 12-byte write
+// instead of copying the rest of the file. Fully consumed segments are deleted.
 
 bool SdModule::logToPending(const SensorData* batch, int count) {
     if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+    uint32_t start = micros();
 
-    // Open in APPEND mode (write to end)
-    File file = SD.open(_pendingFilename, FILE_APPEND);
-    if (!file) {
-        Serial.println("[SD] Failed to open pending file for writing");
+    // Tail segment stays open in APPEND mode (write to end)
+    if (!loadQueueState() || !openPendingHandle()) {
+        Serial.println("[SD] Failed to open pending segment for writing");
         _initialized = false; // Mark SD error to force remount
         if (sdMutex) xSemaphoreGive(sdMutex);
         return false;
     }
 
+    uint8_t payload[LOG_FRAME_MAX_PAYLOAD];
     for (int i = 0; i < count; ++i) {
-        JsonDocument doc;
-        JsonObject obj = doc.to<JsonObject>();
-        sensorDataToTb(batch[i], obj);
-        
+        JsonWriter out((char*)payload, sizeof(payload));
+        sensorDataWriteTb(batch[i], out);
 
-        
-        if (serializeJson(doc, file) == 0) {
+        size_t len = out.length();
+        if (out.overflowed() || !appendFrame(_pendingFile, payload, len)) {
             Serial.println("[SD] Failed to write record to pending");
+            continue;
         }
-        file.println(); // New line = new record
+        _pendingSize += LOG_FRAME_HEADER_SIZE + len;
+        _unflushedBytes += LOG_FRAME_HEADER_SIZE + len;
+    }
+
+    // Start a new segment once the current one is full
+    if (_pendingSize >= QUEUE_SEGMENT_SIZE) {
+        _pendingFile.close();
+        _tailSegment++;
     }
     
     Serial.printf("[SD] Saved %d records to Pending\n", count);
-    file.close();
+    _pendingLatency.record(micros() - start);
     
     if (sdMutex) xSemaphoreGive(sdMutex);
+    flushIfDue();
     return true;
 }
 
-// Reads 'maxItems' lines from the beginning of the file
-int SdModule::readPendingBatch(JsonArray &outArray, int maxItems) {
+// Reads up to 'maxItems' records starting at the cursor and splices their stored JSON
+// (already in ThingsBoard format) into 'out' as "[rec,rec,...]" - only framing and CRC are checked.
+// 'length' receives the payload length, 'next' the position after the last record read -
+// pass it to commitPendingCursor() once sent. 'cap' must exceed LOG_FRAME_MAX_PAYLOAD + 2.
+int SdModule::readPendingBatch(char* out, size_t cap, int maxItems, size_t &length, PendingCursor &next, const PendingCursor* from) {
     if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
 
-    if (!SD.exists(_pendingFilename)) {
+    length = 0;
+    next = _cursor;
+    if (!loadQueueState()) {
         if (sdMutex) xSemaphoreGive(sdMutex);
         return 0;
     }
-
-    File file = SD.open(_pendingFilename, FILE_READ);
-    if (!file) {
-        if (sdMutex) xSemaphoreGive(sdMutex);
-        return 0;
+    // Reading ahead of the upload cursor (batches in flight), never behind it
+    next = _cursor;
+    if (from && (from->segment > _cursor.segment ||
+                 (from->segment == _cursor.segment && from->offset > _cursor.offset))) {
+        next = *from;
     }
 
     int validRecords = 0;
-    int linesRead = 0; // Counter for physically read lines
+    bool full = false;
+    uint8_t header[LOG_FRAME_HEADER_SIZE];
+    out[length++] = '[';
 
-    // Read while data exists and limit not reached
-    while (file.available() && validRecords < maxItems) {
-        
-        String line = file.readStringUntil('\n');
-        line.trim();
-        linesRead++; // Count every line (even empty/invalid)
+    while (!full && validRecords < maxItems && next.segment <= _tailSegment) {
+        File file = openForRead(segmentPath(next.segment));
+        if (!file) {
+            // Missing segment (never written or removed) - move on
+            if (next.segment == _tailSegment) break;
+            next.segment++;
+            next.offset = 0;
+            continue;
+        }
 
-        if (line.length() == 0) continue;
+        size_t size = file.size();
+        file.seek(next.offset);
+        while (validRecords < maxItems && next.offset + LOG_FRAME_HEADER_SIZE <= size) {
+            LogFrameHeader hdr;
+            if (file.read(header, sizeof(header)) != sizeof(header)) break;
 
-        JsonDocument doc;
-        DeserializationError error = deserializeJson(doc, line);
-        
-        if (error) {
-            Serial.print("[SD] JSON parse error in pending (skipping): ");
-            Serial.println(error.c_str());
-            // Invalid line is ignored but will be removed by removeFirstRecords,
-            // because removeFirstRecords removes N lines. 
-            // There is a risk of desynchronization if we only count valid ones.
-            // For simplicity: ignore errors and continue reading.
-            continue;
+            if (!logFrameDecodeHeader(header, hdr) || next.offset + LOG_FRAME_HEADER_SIZE + hdr.length > size) {
+                next.offset++; // Not a frame start - resync on next magic byte
+                file.seek(next.offset);
+                continue;
+            }
+
+            // Payload goes straight into place after the separator; stop when "]" would not fit
+            size_t pos = length + (validRecords ? 1 : 0);
+            if (pos + hdr.length + 1 > cap) {
+                full = true;
+                break;
+            }
+
+            uint8_t* payload = (uint8_t*)out + pos;
+            if (file.read(payload, hdr.length) != hdr.length || !logFrameVerify(hdr, payload)) {
+                // Torn or corrupted record: costs only this frame
+                Serial.printf("[SD] Corrupted pending record at %lu:%lu (skipping)\n",
+                              (unsigned long)next.segment, (unsigned long)next.offset);
+                next.offset++;
+                file.seek(next.offset);
+                continue;
+            }
+
+            next.offset += LOG_FRAME_HEADER_SIZE + hdr.length;
+            if (validRecords) out[length] = ',';
+            length = pos + hdr.length;
+            validRecords++;
         }
 
-        outArray.add(doc);
-        validRecords++;
+        bool segmentDone = next.offset + LOG_FRAME_HEADER_SIZE > size;
+        file.close();
+
+        if (full || !segmentDone || next.segment == _tailSegment) break;
+        next.segment++;
+        next.offset = 0;
     }
-    
-    file.close();
-    
+
+    out[length++] = ']';
+    if (validRecords == 0) length = 0;
+
     if (sdMutex) xSemaphoreGive(sdMutex);
     return validRecords;
 }
 
-// NEW METHOD: Safely removes 'count' lines from the beginning of the file
-bool SdModule::removeFirstRecords(int count) {
-    if (count <= 0) return true;
-    
+// Moves the upload cursor forward. Constant cost: segments behind the cursor are removed,
+// the cursor itself is a fixed-size file.
+bool SdModule::commitPendingCursor(const PendingCursor &next) {
     if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
 
-    const char* tempFilename = "/pending.tmp";
-    
-    // 1. Check source
-    if (!SD.exists(_pendingFilename)) {
-        if (sdMutex) xSemaphoreGive(sdMutex);
-        return true; 
-    }
-
-    File sourceFile = SD.open(_pendingFilename, FILE_READ);
-    if (!sourceFile) {
-        Serial.println("[SD] Failed to open pending for reading (remove ops)");
+    if (!loadQueueState()) {
         if (sdMutex) xSemaphoreGive(sdMutex);
         return false;
     }
 
-    // 2. Prepare temp file
-    if (SD.exists(tempFilename)) SD.remove(tempFilename);
-    
-    File tempFile = SD.open(tempFilename, FILE_WRITE);
-    if (!tempFile) {
-        Serial.println("[SD] Failed to create temp file");
-        sourceFile.close();
+    // Ignore stale or backward cursors
+    if (next.segment < _cursor.segment ||
+        (next.segment == _cursor.segment && next.offset <= _cursor.offset)) {
         if (sdMutex) xSemaphoreGive(sdMutex);
-        return false;
+        return true;
     }
 
-    // 3. Skip first 'count' lines
-    // We must skip exactly as many lines as were "consumed" (validRecords)
-    // NOTE: If there were JSON errors in readPendingBatch, count might be less than physical lines.
-    // In this simple implementation, we assume the file is not corrupted.
-    int skipped = 0;
-    while (sourceFile.available() && skipped < count) {
-        sourceFile.readStringUntil('\n');
-        skipped++;
-    }
-
-    // 4. Copy the rest of the file
-    size_t copiedBytes = 0;
-    uint8_t buf[512]; // 512B Buffer
-    while (sourceFile.available()) {
-        int readLen = sourceFile.read(buf, sizeof(buf));
-        if (readLen > 0) {
-            tempFile.write(buf, readLen);
-            copiedBytes += readLen;
-        }
+    // Drop fully uploaded segments
+    for (uint32_t seg = _cursor.segment; seg < next.segment; ++seg) {
+        SD.remove(segmentPath(seg));
     }
+    _cursor = next;
 
-    sourceFile.close();
-    tempFile.close();
+    // Whole queue uploaded: drop the tail too and start a fresh segment
+    if (_cursor.segment == _tailSegment) {
+        File tail = openForRead(segmentPath(_tailSegment));
+        size_t tailSize = tail ? tail.size() : 0;
+        if (tail) tail.close();
 
-    // 5. Swap files
-    SD.remove(_pendingFilename); // Remove old pending
-    
-    if (copiedBytes > 0) {
-        // If data remains, rename temp -> pending
-        if (!SD.rename(tempFilename, _pendingFilename)) {
-            Serial.println("[SD] CRITICAL: Failed to rename temp file!");
-            // Emergency situation. Data is in .tmp
-            if (sdMutex) xSemaphoreGive(sdMutex);
-            return false;
+        if (_cursor.offset >= tailSize) {
+            if (_pendingFile) _pendingFile.close();
+            SD.remove(segmentPath(_tailSegment));
+            _tailSegment++;
+            _cursor.segment = _tailSegment;
+            _cursor.offset = 0;
+            Serial.println("[SD] Pending queue cleared (empty).");
         }
-    } else {
-        // If temp file is empty (we sent everything), just remove temp.
-        SD.remove(tempFilename);
-        Serial.println("[SD] Pending file cleared (empty).");
     }
 
+    bool ok = saveCursor(_cursor);
+    if (!ok) Serial.println("[SD] Failed to persist pending cursor");
+
     if (sdMutex) xSemaphoreGive(sdMutex);
-    return true;
+    return ok;
 }
 
 // -----------------------------------------------------
@@ -236,6 +253,10 @@ bool SdModule::removeFirstRecords(int count) {
 // -----------------------------------------------------
 
 String SdModule::generateArchiveFilename() {
+    return generateFilename("LOG", archiveExtension());
+}
+
+String SdModule::generateFilename(const char* prefix, const char* extension) {
     if (TimeManager::isSynchronized()) {
         time_t now = TimeManager::getTimestampMs() / 1000;
         setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
@@ -248,9 +269,9 @@ String SdModule::generateArchiveFilename() {
         if (timeinfo.tm_year + 1900 < 2024) return "";
 
         char buf[64];
-        snprintf(buf, sizeof(buf), "/LOG_%04d%02d%02d_%02d%02d%02d.jsonl",
+        snprintf(buf, sizeof(buf), "/%s_%04d%02d%02d_%02d%02d%02d%s", prefix,
                  timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
-                 timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+                 timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec, extension);
         return String(buf);
     }
     return "";
@@ -264,34 +285,55 @@ void SdModule::rotateArchiveFile() {
     }
 }
 
-void SdModule::checkArchiveSizeAndRotate() {
-    if (_currentArchiveFilename.length() == 0) {
-        rotateArchiveFile();
-        return;
+const char* SdModule::archiveExtension() const {
+    switch (_archiveFormat) {
+        case ARCHIVE_BINARY:   return ".bin";
+        case ARCHIVE_JSONL_LZ: return ".lz";
+        default:               return ".jsonl";
     }
+}
 
-    if (!SD.exists(_currentArchiveFilename)) return;
+// Binary archive: schema frame at the start of each file, then one records frame per batch
+// (split when a frame would exceed LOG_FRAME_MAX_PAYLOAD)
+size_t SdModule::writeArchiveBinary(File &file, bool withSchema, const SensorData* batch, int count) {
+    uint8_t header[LOG_FRAME_HEADER_SIZE];
+    uint8_t payload[LOG_FRAME_MAX_PAYLOAD];
+    size_t written = 0;
 
-    File f = SD.open(_currentArchiveFilename, FILE_READ);
-    if (!f) return;
-    
-    size_t size = f.size();
-    f.close();
+    if (withSchema) {
+        size_t len = archiveWriteSchema(payload, sizeof(payload));
+        logFrameEncodeHeader(header, payload, len, ARCHIVE_FRAME_SCHEMA);
+        if (file.write(header, sizeof(header)) != sizeof(header) || file.write(payload, len) != len) return 0;
+        written += sizeof(header) + len;
+    }
 
-    if (size >= MAX_FILE_SIZE) {
-        Serial.println("[SD] Archive file limit reached. Rotating.");
-        rotateArchiveFile();
+    int i = 0;
+    while (i < count) {
+        SensorData prev = {}; // Keyframe: first record of a frame is encoded against zero
+        size_t len = 0;
+
+        while (i < count && len + ARCHIVE_MAX_RECORD_SIZE <= sizeof(payload)) {
+            len += archiveEncodeRecord(batch[i], prev, payload + len);
+            prev = batch[i];
+            i++;
+        }
+
+        logFrameEncodeHeader(header, payload, len, ARCHIVE_FRAME_RECORDS);
+        if (file.write(header, sizeof(header)) != sizeof(header) || file.write(payload, len) != len) return 0;
+        written += sizeof(header) + len;
     }
+    return written;
 }
 
 bool SdModule::logToArchive(const SensorData* batch, int count) {
     if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+    uint32_t start = micros();
 
     // Find or create filename
     if (_currentArchiveFilename.length() == 0) {
         String latest = getLatestArchiveFilename();
         if (latest.length() > 0) {
-             File f = SD.open(latest, FILE_READ);
+             File f = openForRead(latest);
              if (f) {
                  size_t sz = f.size();
                  f.close();
@@ -315,37 +357,543 @@ bool SdModule::logToArchive(const SensorData* batch, int count) {
         return false;
     }
 
-    checkArchiveSizeAndRotate();
+    // Size is tracked in memory while the handle is open
+    bool opened = openArchiveHandle();
+    if (opened && _archiveSize >= MAX_FILE_SIZE) {
+        Serial.println("[SD] Archive file limit reached. Rotating.");
+        writeLzBlock(); // Buffered lines belong to the old file
+        rotateArchiveFile();
+        opened = openArchiveHandle();
+    }
+    if (!opened) {
+        Serial.printf("[SD] Failed to open archive: %s\n", _currentArchiveFilename.c_str());
+        _initialized = false;
+        if (sdMutex) xSemaphoreGive(sdMutex);
+        return false;
+    }
+
+    // Sparse time index entry for where this batch starts, added once it is written
+    // (compressed lines are indexed per block, in writeLzBlock())
+    uint32_t batchOffset = _archiveSize;
+    size_t written = 0;
+    bool ok = true;
+    if (_archiveFormat == ARCHIVE_BINARY) {
+        written = writeArchiveBinary(_archiveFile, _archiveSize == 0, batch, count);
+        ok = written > 0 || count == 0;
+    } else {
+        // JSON lines: written directly, or collected into the compressed block
+        char line[ARCHIVE_MAX_LINE];
+        for (int i = 0; i < count; ++i) {
+            JsonWriter out(line, sizeof(line));
+            sensorDataWriteSd(batch[i], out);
+            out.write("\r\n", 2); // Same line ending as println()
+            if (out.overflowed()) {
+                ok = false;
+                continue;
+            }
+
+            if (_archiveFormat == ARCHIVE_JSONL_LZ) {
+                if (_lzBlockLen + out.length() > ARCHIVE_LZ_BLOCK_SIZE && !writeLzBlock()) ok = false;
+                if (_lzBlockLen == 0) {
+                    _lzBlockStart = millis();
+                    _lzBlockTs = batch[i].ts;
+                }
+                memcpy(_lzBlock + _lzBlockLen, line, out.length());
+                _lzBlockLen += out.length();
+                continue;
+            }
+
+            size_t n = _archiveFile.write((const uint8_t*)line, out.length());
+            if (n != out.length()) ok = false;
+            written += n;
+        }
+    }
+
+    if (!ok) {
+        Serial.println("[SD] Failed to write to archive");
+        closeHandles();
+        _initialized = false;
+    } else if (count > 0 && _archiveFormat != ARCHIVE_JSONL_LZ) {
+        indexArchiveRecord(batch[0].ts, batchOffset);
+    }
+    _archiveSize += written;
+    _unflushedBytes += written;
+    
+    Serial.printf("[SD] Archived %d records to %s\n", count, _currentArchiveFilename.c_str());
+    _archiveLatency.record(micros() - start);
+
+    if (sdMutex) xSemaphoreGive(sdMutex);
+    flushIfDue();
+    return ok;
+}
+
+// -----------------------------------------------------
+// ---------------- WRITE BUFFERING --------------------
+// -----------------------------------------------------
+// Opening/closing a file on FAT updates the directory entry and FAT sectors every time.
+// Handles stay open and data is pushed to the card on a byte or time budget instead.
+
+void SdModule::setFlushPolicy(size_t maxBytes, uint32_t maxMs) {
+    _flushMaxBytes = maxBytes;
+    _flushMaxMs = maxMs;
+}
+
+bool SdModule::flush() {
+    if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+    writeLzBlock();
+    flushHandles();
+    if (sdMutex) xSemaphoreGive(sdMutex);
+    return _initialized;
+}
+
+// A partial compressed block is written once it is as old as the flush interval, so buffered
+// lines reach the card as soon as plain writes would (smaller blocks compress less)
+void SdModule::flushIfDue() {
+    if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+    bool blockDue = _lzBlockLen > 0 && millis() - _lzBlockStart >= _flushMaxMs;
+    bool flushDue = _unflushedBytes > 0 &&
+                    (_unflushedBytes >= _flushMaxBytes || millis() - _lastFlushTime >= _flushMaxMs);
+    if (blockDue) writeLzBlock();
+    if (blockDue || flushDue) flushHandles();
+    if (sdMutex) xSemaphoreGive(sdMutex);
+}
+
+// Every read of a file we may be appending to goes through here. Our write handle of that file is
+// closed first (close = flush + directory entry update), so the reader sees all data written so far
+// instead of a stale length, and the open does not meet our writer (FR_LOCKED with FF_FS_LOCK).
+// The writer reopens the file on its next append; a reader still open then (web streaming) keeps
+// its snapshotted length (the Arduino core builds FatFs with FF_FS_LOCK 0, so both opens succeed).
+File SdModule::openForRead(const String &path) {
+    if (_archiveFile && path == _openArchiveFilename) {
+        writeLzBlock(); // Buffered lines too, the handle is needed for it
+        _archiveFile.close();
+        _openArchiveFilename = "";
+    }
+    if (_pendingFile && path == segmentPath(_openPendingSegment)) {
+        _pendingFile.close();
+    }
+    return SD.open(path, FILE_READ);
+}
+
+void SdModule::printStats() {
+    _archiveLatency.print("SD archive write");
+    _pendingLatency.print("SD pending write");
+    _flushLatency.print("SD flush");
+    _captureLatency.print("SD CAN capture write");
+}
+
+bool SdModule::openArchiveHandle() {
+    if (_archiveFile && _openArchiveFilename == _currentArchiveFilename) return true;
 
-    File file = SD.open(_currentArchiveFilename, FILE_APPEND);
-    if (!file) {
+    if (_archiveFile) _archiveFile.close();
+    _archiveFile = SD.open(_currentArchiveFilename, FILE_APPEND);
+    if (!_archiveFile) {
         rotateArchiveFile();
-        file = SD.open(_currentArchiveFilename, FILE_APPEND);
-        if (!file) {
-            Serial.printf("[SD] Failed to open archive: %s\n", _currentArchiveFilename.c_str());
-            _initialized = false;
+        _archiveFile = SD.open(_currentArchiveFilename, FILE_APPEND);
+        if (!_archiveFile) return false;
+    }
+
+    _openArchiveFilename = _currentArchiveFilename;
+    _archiveSize = _archiveFile.size();
+    return true;
+}
+
+bool SdModule::openPendingHandle() {
+    if (_pendingFile && _openPendingSegment == _tailSegment) return true;
+
+    if (_pendingFile) _pendingFile.close();
+    _pendingFile = SD.open(segmentPath(_tailSegment), FILE_APPEND);
+    if (!_pendingFile) return false;
+
+    _openPendingSegment = _tailSegment;
+    _pendingSize = _pendingFile.size();
+    return true;
+}
+
+void SdModule::flushHandles() {
+    uint32_t start = micros();
+    if (_archiveFile) _archiveFile.flush();
+    if (_pendingFile) _pendingFile.flush();
+    if (_captureFile) _captureFile.flush();
+    if (_trackFile) _trackFile.flush();
+    _unflushedBytes = 0;
+    _lastFlushTime = millis();
+    _flushLatency.record(micros() - start);
+}
+
+void SdModule::closeHandles() {
+    writeLzBlock();
+    stopIndexRebuild(); // Restarted after the next mount
+    if (_archiveFile) _archiveFile.close();
+    if (_pendingFile) _pendingFile.close();
+    if (_captureFile) _captureFile.close(); // The next block opens a new log
+    if (_trackFile) _trackFile.close();
+    _openArchiveFilename = "";
+    _unflushedBytes = 0;
+}
+
+// Compresses the buffered lines into one frame at the end of the open archive
+// (called with sdMutex held). The block is dropped if it cannot be written.
+bool SdModule::writeLzBlock() {
+    if (_lzBlockLen == 0) return true;
+    size_t blockLen = _lzBlockLen;
+    _lzBlockLen = 0;
+    if (!_archiveFile) return false;
+
+    size_t len = archiveLzCompress(_lzBlock, blockLen, _lzOut, _lzTable);
+    uint8_t header[LOG_FRAME_HEADER_SIZE];
+    logFrameEncodeHeader(header, _lzOut, len, ARCHIVE_FRAME_LZ);
+    if (_archiveFile.write(header, sizeof(header)) != sizeof(header) || _archiveFile.write(_lzOut, len) != len) {
+        Serial.println("[SD] Failed to write compressed block");
+        return false;
+    }
+
+    indexArchiveRecord(_lzBlockTs, _archiveSize); // Only blocks that made it to the file
+    _archiveSize += sizeof(header) + len;
+    _unflushedBytes += sizeof(header) + len;
+    return true;
+}
+
+bool SdModule::allocLzBuffers() {
+    if (!_lzBlock) _lzBlock = (uint8_t*)malloc(ARCHIVE_LZ_BLOCK_SIZE);
+    if (!_lzOut) _lzOut = (uint8_t*)malloc(ARCHIVE_LZ_MAX_OUTPUT);
+    if (!_lzTable) _lzTable = (uint16_t*)malloc(sizeof(uint16_t) << ARCHIVE_LZ_HASH_BITS);
+    if (_lzBlock && _lzOut && _lzTable) return true;
+    freeLzBuffers();
+    return false;
+}
+
+void SdModule::freeLzBuffers() {
+    free(_lzBlock);
+    free(_lzOut);
+    free(_lzTable);
+    _lzBlock = nullptr;
+    _lzOut = nullptr;
+    _lzTable = nullptr;
+    _lzBlockLen = 0;
+}
+
+// -----------------------------------------------------
+// ------------- PENDING QUEUE HELPERS -----------------
+// -----------------------------------------------------
+
+String SdModule::segmentPath(uint32_t segment) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%s/%08lu.seg", _queueDir, (unsigned long)segment);
+    return String(buf);
+}
+
+// Restores head/tail segments and cursor after mount (called with sdMutex held)
+bool SdModule::loadQueueState() {
+    if (!_initialized) return false;
+    if (_queueLoaded) return true;
+
+    uint32_t minSeg = 0;
+    uint32_t maxSeg = 0;
+
+    File dir = SD.open(_queueDir);
+    if (!dir || !dir.isDirectory()) {
+        if (dir) dir.close();
+        return false;
+    }
+
+    File file = dir.openNextFile();
+    while (file) {
+        String name = file.name();
+        if (!file.isDirectory() && name.endsWith(".seg")) {
+            int slash = name.lastIndexOf('/');
+            uint32_t seg = strtoul(name.c_str() + slash + 1, nullptr, 10);
+            if (seg > 0) {
+                if (minSeg == 0 || seg < minSeg) minSeg = seg;
+                if (seg > maxSeg) maxSeg = seg;
+            }
+        }
+        file.close();
+        file = dir.openNextFile();
+    }
+    dir.close();
+
+    // Cursor file: segment, offset, crc32
+    PendingCursor saved = {0, 0};
+    File c = SD.open(_cursorFilename, FILE_READ);
+    if (c) {
+        uint32_t raw[3];
+        if (c.read((uint8_t*)raw, sizeof(raw)) == sizeof(raw) &&
+            logCrc32((const uint8_t*)raw, 2 * sizeof(uint32_t)) == raw[2]) {
+            saved.segment = raw[0];
+            saved.offset = raw[1];
+        } else {
+            Serial.println("[SD] Pending cursor invalid, replaying from oldest segment");
+        }
+        c.close();
+    }
+
+    if (maxSeg == 0) {
+        // Empty queue - continue numbering after the saved cursor
+        _tailSegment = saved.segment > 0 ? saved.segment : 1;
+        _cursor = {_tailSegment, 0};
+    } else {
+        _tailSegment = maxSeg;
+        if (saved.segment >= minSeg && saved.segment <= maxSeg) {
+            _cursor = saved;
+        } else {
+            _cursor = {minSeg, 0};
+        }
+    }
+
+    _queueLoaded = true;
+    Serial.printf("[SD] Pending queue: cursor %lu:%lu, tail segment %lu\n",
+                  (unsigned long)_cursor.segment, (unsigned long)_cursor.offset, (unsigned long)_tailSegment);
+    return true;
+}
+
+bool SdModule::saveCursor(const PendingCursor &cursor) {
+    uint32_t raw[3] = {cursor.segment, cursor.offset, 0};
+    raw[2] = logCrc32((const uint8_t*)raw, 2 * sizeof(uint32_t));
+
+    File c = SD.open(_cursorFilename, FILE_WRITE);
+    if (!c) return false;
+    size_t written = c.write((const uint8_t*)raw, sizeof(raw));
+    c.close();
+    return written == sizeof(raw);
+}
+
+bool SdModule::appendFrame(File &file, const uint8_t* payload, size_t length) {
+    if (length == 0 || length > LOG_FRAME_MAX_PAYLOAD) return false;
+
+    uint8_t header[LOG_FRAME_HEADER_SIZE];
+    logFrameEncodeHeader(header, payload, (uint16_t)length);
+    if (file.write(header, sizeof(header)) != sizeof(header)) return false;
+    return file.write(payload, length) == length;
+}
+
+// One-time import of the old line-based pending file (called with sdMutex held)
+void SdModule::migrateLegacyPending() {
+    if (!SD.exists(_legacyPendingFilename) || !loadQueueState()) return;
+
+    File src = SD.open(_legacyPendingFilename, FILE_READ);
+    if (!src) return;
+
+    File dst = SD.open(segmentPath(_tailSegment), FILE_APPEND);
+    if (!dst) {
+        src.close();
+        return;
+    }
+
+    int migrated = 0;
+    while (src.available()) {
+        String line = src.readStringUntil('\n');
+        line.trim();
+        if (line.length() == 0) continue;
+
+        // Records are replayed without parsing, so only valid JSON enters the queue
+        JsonDocument doc;
+        if (deserializeJson(doc, line)) {
+            Serial.println("[SD] JSON parse error in legacy pending (skipping)");
+            continue;
+        }
+        if (appendFrame(dst, (const uint8_t*)line.c_str(), line.length())) migrated++;
+    }
+
+    bool full = dst.size() >= QUEUE_SEGMENT_SIZE;
+    dst.close();
+    src.close();
+    if (full) _tailSegment++;
+
+    SD.remove(_legacyPendingFilename);
+    Serial.printf("[SD] Migrated %d legacy pending records\n", migrated);
+}
+
+// -----------------------------------------------------
+// ----------------- CAN CAPTURE -----------------------
+// -----------------------------------------------------
+// One LogFrame per capture block (CanCapture.h). The handle stays open for the whole capture
+// and is flushed with the other handles.
+
+bool SdModule::logCanCapture(const uint8_t* block, size_t length) {
+    if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+    uint32_t start = micros();
+
+    if (!_captureFile) {
+        _captureFilename = generateFilename("CAN", ".can");
+        if (_captureFilename.length() == 0) {
+            _captureFilename = "/CAN_BOOT_" + String(millis()) + ".can"; // Time not synchronized yet
+        }
+        _captureFile = SD.open(_captureFilename, FILE_APPEND);
+        _captureSize = 0;
+        if (!_captureFile) {
+            Serial.printf("[SD] Cannot create %s\n", _captureFilename.c_str());
             if (sdMutex) xSemaphoreGive(sdMutex);
             return false;
         }
+        Serial.printf("[SD] CAN capture to %s\n", _captureFilename.c_str());
     }
 
-    for (int i = 0; i < count; ++i) {
-        JsonDocument doc;
-        JsonObject obj = doc.to<JsonObject>();
-        sensorDataToSd(batch[i], obj);
-        
-        if (serializeJson(doc, file) == 0) {
-            Serial.println("[SD] Failed to write to archive");
-            _initialized = false;
+    uint8_t header[LOG_FRAME_HEADER_SIZE];
+    logFrameEncodeHeader(header, block, (uint16_t)length, CAN_CAPTURE_FRAME_BLOCK);
+    bool ok = _captureFile.write(header, sizeof(header)) == sizeof(header) &&
+              _captureFile.write(block, length) == length;
+    if (ok) {
+        _captureSize += sizeof(header) + length;
+        _unflushedBytes += sizeof(header) + length;
+    } else {
+        Serial.println("[SD] Failed to write CAN capture");
+        closeHandles();
+        _initialized = false;
+    }
+    _captureLatency.record(micros() - start);
+
+    if (sdMutex) xSemaphoreGive(sdMutex);
+    flushIfDue();
+    return ok;
+}
+
+void SdModule::closeCanCapture() {
+    if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+    if (_captureFile) {
+        _captureFile.close();
+        Serial.printf("[SD] CAN capture closed: %s (%u bytes)\n", _captureFilename.c_str(), (unsigned)_captureSize);
+    }
+    if (sdMutex) xSemaphoreGive(sdMutex);
+}
+
+// -----------------------------------------------------
+// ------------------- GPS TRACK -----------------------
+// -----------------------------------------------------
+// One LogFrame per track block (GpsTrack.h). The handle stays open while track mode is on
+// and is flushed with the other handles.
+
+bool SdModule::logGpsTrack(const uint8_t* block, size_t length) {
+    if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+
+    if (!_trackFile) {
+        _trackFilename = generateFilename("TRK", ".trk");
+        if (_trackFilename.length() == 0) {
+            _trackFilename = "/TRK_BOOT_" + String(millis()) + ".trk"; // Time not synchronized yet
+        }
+        _trackFile = SD.open(_trackFilename, FILE_APPEND);
+        _trackSize = 0;
+        if (!_trackFile) {
+            Serial.printf("[SD] Cannot create %s\n", _trackFilename.c_str());
+            if (sdMutex) xSemaphoreGive(sdMutex);
+            return false;
         }
-        file.println(); 
+        Serial.printf("[SD] GPS track to %s\n", _trackFilename.c_str());
+    }
+
+    uint8_t header[LOG_FRAME_HEADER_SIZE];
+    logFrameEncodeHeader(header, block, (uint16_t)length, GPS_TRACK_FRAME_BLOCK);
+    bool ok = _trackFile.write(header, sizeof(header)) == sizeof(header) &&
+              _trackFile.write(block, length) == length;
+    if (ok) {
+        _trackSize += sizeof(header) + length;
+        _unflushedBytes += sizeof(header) + length;
+    } else {
+        Serial.println("[SD] Failed to write GPS track");
+        closeHandles();
+        _initialized = false;
     }
-    
-    Serial.printf("[SD] Archived %d records to %s\n", count, _currentArchiveFilename.c_str());
 
-    file.close();
     if (sdMutex) xSemaphoreGive(sdMutex);
-    return true;
+    flushIfDue();
+    return ok;
+}
+
+void SdModule::closeGpsTrack() {
+    if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+    if (_trackFile) {
+        _trackFile.close();
+        Serial.printf("[SD] GPS track closed: %s (%u bytes)\n", _trackFilename.c_str(), (unsigned)_trackSize);
+    }
+    if (sdMutex) xSemaphoreGive(sdMutex);
+}
+
+// -----------------------------------------------------
+// ---------------- CHUNK READER -----------------------
+// -----------------------------------------------------
+
+bool SdChunkReader::open(const String &path) {
+    close();
+    if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+    _file = _sd.openForRead(path);
+    _size = _file ? _file.size() : 0;
+    if (sdMutex) xSemaphoreGive(sdMutex);
+
+    setRange(0, _size);
+    return (bool)_file;
+}
+
+void SdChunkReader::close() {
+    if (!_file) return;
+    if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+    _file.close();
+    if (sdMutex) xSemaphoreGive(sdMutex);
+}
+
+bool SdChunkReader::isOpen() const {
+    return (bool)_file;
+}
+
+uint32_t SdChunkReader::size() const {
+    return _size;
+}
+
+void SdChunkReader::setRange(uint32_t start, uint32_t end) {
+    _end = end < _size ? end : _size;
+    _pos = start < _end ? start : _end;
+    _bufLen = 0;
+    _bufPos = 0;
+}
+
+size_t SdChunkReader::readAt(uint32_t offset, uint8_t* buf, size_t len) {
+    if (!_file || offset >= _size) return 0;
+    if (len > _size - offset) len = _size - offset;
+
+    if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+    size_t n = _file.seek(offset) ? _file.read(buf, len) : 0;
+    if (sdMutex) xSemaphoreGive(sdMutex);
+    return n;
+}
+
+size_t SdChunkReader::read(uint8_t* buf, size_t len) {
+    // Serve leftovers of the line buffer first
+    if (_bufPos < _bufLen) {
+        size_t n = _bufLen - _bufPos < len ? _bufLen - _bufPos : len;
+        memcpy(buf, _buf + _bufPos, n);
+        _bufPos += n;
+        return n;
+    }
+    if (_pos >= _end) return 0;
+    if (len > _end - _pos) len = _end - _pos;
+
+    size_t n = readAt(_pos, buf, len);
+    _pos += n;
+    return n;
+}
+
+int SdChunkReader::readLine(char* line, size_t cap) {
+    size_t len = 0;
+    bool any = false;
+
+    for (;;) {
+        if (_bufPos >= _bufLen) {
+            _bufPos = 0;
+            _bufLen = 0;
+            if (_pos >= _end) break;
+            size_t want = _end - _pos < sizeof(_buf) ? _end - _pos : sizeof(_buf);
+            _bufLen = readAt(_pos, _buf, want);
+            _pos += _bufLen;
+            if (_bufLen == 0) break;
+        }
+
+        any = true;
+        char c = (char)_buf[_bufPos++];
+        if (c == '\n') break;
+        if (len + 1 < cap) line[len++] = c;
+    }
+
+    line[len] = 0;
+    return any ? (int)len : -1;
 }
 
 // -----------------------------------------------------
@@ -353,30 +901,399 @@ bool SdModule::logToArchive(const SensorData* batch, int count) {
 // -----------------------------------------------------
 
 String SdModule::getLatestArchiveFilename() {
+    std::vector<String> names;
+    listArchiveFiles(names);
+    return names.empty() ? "" : names.back();
+}
+
+void SdModule::listArchiveFiles(std::vector<String> &names) {
+    names.clear();
     File root = SD.open("/");
-    if (!root || !root.isDirectory()) return "";
+    if (!root || !root.isDirectory()) return;
 
-    String latestFile = "";
     File file = root.openNextFile();
     
     while (file) {
         if (!file.isDirectory()) {
             String name = file.name();
             // Check if it's a log file (LOG_... format)
-            if (name.indexOf("LOG_") != -1 && name.endsWith(".jsonl")) {
+            if (name.indexOf("LOG_") != -1 && name.endsWith(archiveExtension())) {
                 String cleanName = name;
                 if (!cleanName.startsWith("/")) cleanName = "/" + cleanName;
-                
-                // Lexicographical comparison works for YYYYMMDD format
-                if (latestFile == "" || cleanName > latestFile) {
-                    latestFile = cleanName;
-                }
+                names.push_back(cleanName);
             }
         }
         file = root.openNextFile();
     }
     root.close();
-    return latestFile;
+
+    // Lexicographical order works for YYYYMMDD format
+    std::sort(names.begin(), names.end(), [](const String &a, const String &b) { return a < b; });
+}
+
+// Resolves [fromMs, toMs] to byte ranges in the archive files. Only the .idx sidecars are read
+// (binary search), so the cost does not depend on the archive size.
+int SdModule::findArchiveSpans(uint64_t fromMs, uint64_t toMs, std::vector<ArchiveSpan> &spans) {
+    spans.clear();
+    if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+
+    std::vector<String> names;
+    listArchiveFiles(names);
+
+    // First timestamp of each file (files are written in time order): first index entry, or the
+    // head of a file whose .idx is not rebuilt yet
+    std::vector<uint64_t> startTs(names.size(), 0);
+    for (size_t k = 0; k < names.size(); ++k) {
+        File idx = SD.open(indexFilename(names[k]), FILE_READ);
+        uint32_t offset;
+        if (idx) {
+            if (!readIndexEntry(idx, 0, startTs[k], offset)) startTs[k] = UINT64_MAX; // Empty file
+            idx.close();
+        } else if (!scanRecordStart(names[k], 0, INDEX_FALLBACK_WINDOW, offset, startTs[k])) {
+            startTs[k] = UINT64_MAX;
+        }
+    }
+
+    for (size_t k = 0; k < names.size(); ++k) {
+        if (startTs[k] == UINT64_MAX) continue;
+        if (startTs[k] > toMs) break;
+
+        uint64_t nextStart = UINT64_MAX;
+        for (size_t j = k + 1; j < names.size(); ++j) {
+            if (startTs[j] != UINT64_MAX) { nextStart = startTs[j]; break; }
+        }
+        if (nextStart <= fromMs) continue; // Whole file before the range
+
+        File data = openForRead(names[k]);
+        if (!data) continue;
+        ArchiveSpan span = {names[k], 0, (uint32_t)data.size()};
+        data.close();
+
+        File idx = SD.open(indexFilename(names[k]), FILE_READ);
+        if (!idx) {
+            // Not indexed yet: the whole file (records outside the range are filtered while sending)
+            if (span.end > 0) spans.push_back(span);
+            continue;
+        }
+
+        uint32_t n = idx.size() / 12;
+        uint64_t ts;
+        uint32_t offset;
+
+        // Start: last entry with ts <= fromMs
+        uint32_t lo = 0, hi = n;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (readIndexEntry(idx, mid, ts, offset) && ts <= fromMs) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo > 0 && readIndexEntry(idx, lo - 1, ts, offset)) span.start = offset;
+
+        // End: first entry with ts > toMs
+        lo = 0; hi = n;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (readIndexEntry(idx, mid, ts, offset) && ts <= toMs) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo < n && readIndexEntry(idx, lo, ts, offset)) span.end = offset;
+        idx.close();
+
+        if (span.end > span.start) spans.push_back(span);
+    }
+
+    if (sdMutex) xSemaphoreGive(sdMutex);
+    return spans.size();
+}
+
+// -----------------------------------------------------
+// ---------------- TIME INDEX -------------------------
+// -----------------------------------------------------
+
+// Steps backwards through an archive: offsets in the index grow with the file,
+// so a binary search finds the block just before 'before'. Without an entry there (no .idx yet,
+// or data written before indexing) the step is the first record boundary in the
+// INDEX_FALLBACK_WINDOW bytes before 'before', so one call never scans more than that.
+bool SdModule::previousIndexOffset(const String &archive, uint32_t before, uint32_t &offset) {
+    if (before == 0) return false;
+
+    File idx = SD.open(indexFilename(archive), FILE_READ);
+    if (idx) {
+        uint32_t n = idx.size() / 12;
+        uint32_t lo = 0, hi = n;
+        uint64_t ts;
+        uint32_t at;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (readIndexEntry(idx, mid, ts, at) && at < before) lo = mid + 1;
+            else hi = mid;
+        }
+
+        bool found = lo > 0 && readIndexEntry(idx, lo - 1, ts, offset);
+        idx.close();
+        if (found && before - offset <= INDEX_FALLBACK_WINDOW * 8) return true; // Dense enough
+    }
+
+    uint64_t ts;
+    uint32_t from = before > INDEX_FALLBACK_WINDOW ? before - INDEX_FALLBACK_WINDOW : 0;
+    if (scanRecordStart(archive, from, before, offset, ts)) return true;
+    offset = from; // No boundary found (corrupted window): step over it
+    return true;
+}
+
+String SdModule::indexFilename(const String &archive) {
+    int dot = archive.lastIndexOf('.');
+    return (dot > 0 ? archive.substring(0, dot) : archive) + ".idx";
+}
+
+// Adds an entry for data already written at 'offset' when the interval has passed
+void SdModule::indexArchiveRecord(uint64_t ts, uint32_t offset) {
+    if (_indexedArchive != _currentArchiveFilename) {
+        _indexedArchive = _currentArchiveFilename;
+        _lastIndexTs = 0;
+    }
+    if (_lastIndexTs == 0 || ts >= _lastIndexTs + ARCHIVE_INDEX_INTERVAL_MS || ts < _lastIndexTs) {
+        appendIndexEntry(ts, offset);
+        _lastIndexTs = ts;
+    }
+}
+
+void SdModule::appendIndexEntry(uint64_t ts, uint32_t offset) {
+    File idx = SD.open(indexFilename(_currentArchiveFilename), FILE_APPEND);
+    if (!idx) return;
+    uint8_t entry[12];
+    memcpy(entry, &ts, 8);
+    memcpy(entry + 8, &offset, 4);
+    idx.write(entry, sizeof(entry));
+    idx.close();
+}
+
+bool SdModule::readIndexEntry(File &idx, uint32_t i, uint64_t &ts, uint32_t &offset) {
+    uint8_t entry[12];
+    if (!idx.seek(i * sizeof(entry)) || idx.read(entry, sizeof(entry)) != sizeof(entry)) return false;
+    memcpy(&ts, entry, 8);
+    memcpy(&offset, entry + 8, 4);
+    return true;
+}
+
+// Builds missing .idx sidecars (archives written before indexing existed, or copied in) a slice
+// per call, so no request and no write waits for a whole-file scan. TaskSdWriter only: it is the
+// only task that remounts the card, so the handles stay valid between calls. Entries go to a .idt
+// file renamed at the end, so an interrupted scan starts over instead of leaving a partial index.
+void SdModule::rebuildIndexStep() {
+    if (!_indexCheckPending) return;
+    if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+
+    if (!_rebuildData) {
+        // The latest archive is skipped: it is (or will be) appended to and indexed by the writer
+        std::vector<String> names;
+        listArchiveFiles(names);
+        if (!names.empty()) names.pop_back();
+        _rebuildArchive = "";
+        for (const String &name : names) {
+            if (!SD.exists(indexFilename(name))) {
+                _rebuildArchive = name;
+                break;
+            }
+        }
+        if (_rebuildArchive.length() == 0) {
+            _indexCheckPending = false;
+            if (sdMutex) xSemaphoreGive(sdMutex);
+            return;
+        }
+
+        String indexName = indexFilename(_rebuildArchive);
+        String tmpName = indexName.substring(0, indexName.length() - 4) + ".idt";
+        _rebuildData = openForRead(_rebuildArchive);
+        _rebuildIdx = SD.open(tmpName, FILE_WRITE);
+        if (!_rebuildData || !_rebuildIdx) {
+            Serial.printf("[SD] Cannot build time index for %s\n", _rebuildArchive.c_str());
+            stopIndexRebuild();
+            _indexCheckPending = false; // Retried after the next mount
+            if (sdMutex) xSemaphoreGive(sdMutex);
+            return;
+        }
+        _rebuildOffset = 0;
+        _rebuildLastTs = 0;
+        Serial.printf("[SD] Building time index for %s\n", _rebuildArchive.c_str());
+    }
+
+    if (rebuildIndexSlice()) {
+        stopIndexRebuild();
+        String indexName = indexFilename(_rebuildArchive);
+        String tmpName = indexName.substring(0, indexName.length() - 4) + ".idt";
+        SD.remove(indexName);
+        if (SD.rename(tmpName, indexName)) {
+            Serial.printf("[SD] Time index built for %s\n", _rebuildArchive.c_str());
+        } else {
+            _indexCheckPending = false; // Do not loop on a card that refuses the rename
+        }
+    }
+
+    if (sdMutex) xSemaphoreGive(sdMutex);
+}
+
+void SdModule::stopIndexRebuild() {
+    if (_rebuildData) _rebuildData.close();
+    if (_rebuildIdx) _rebuildIdx.close();
+}
+
+// Scans the next INDEX_REBUILD_SLICE bytes of _rebuildArchive (called with sdMutex held).
+// Returns true when the end of the file is reached.
+bool SdModule::rebuildIndexSlice() {
+    size_t size = _rebuildData.size();
+    uint32_t sliceEnd = _rebuildOffset + INDEX_REBUILD_SLICE;
+
+    auto addEntry = [&](uint64_t ts, uint32_t at) {
+        if (ts == 0) return;
+        if (_rebuildLastTs == 0 || ts >= _rebuildLastTs + ARCHIVE_INDEX_INTERVAL_MS || ts < _rebuildLastTs) {
+            uint8_t entry[12];
+            memcpy(entry, &ts, 8);
+            memcpy(entry + 8, &at, 4);
+            _rebuildIdx.write(entry, sizeof(entry));
+            _rebuildLastTs = ts;
+        }
+    };
+
+    if (_rebuildArchive.endsWith(".bin") || _rebuildArchive.endsWith(".lz")) {
+        // Framed formats: first record of each frame
+        bool lz = _rebuildArchive.endsWith(".lz");
+        uint16_t maxLength = lz ? ARCHIVE_LZ_MAX_OUTPUT : LOG_FRAME_MAX_PAYLOAD;
+        uint8_t header[LOG_FRAME_HEADER_SIZE];
+        std::vector<uint8_t> payload(maxLength);
+        std::vector<uint8_t> block(lz ? ARCHIVE_LZ_BLOCK_SIZE + 1 : 0);
+
+        while (_rebuildOffset + LOG_FRAME_HEADER_SIZE <= size && _rebuildOffset < sliceEnd) {
+            uint32_t offset = _rebuildOffset;
+            _rebuildData.seek(offset);
+            LogFrameHeader hdr;
+            if (_rebuildData.read(header, sizeof(header)) != sizeof(header)) return true;
+            if (!logFrameDecodeHeader(header, hdr, maxLength) || offset + LOG_FRAME_HEADER_SIZE + hdr.length > size ||
+                _rebuildData.read(payload.data(), hdr.length) != hdr.length || !logFrameVerify(hdr, payload.data())) {
+                _rebuildOffset++;
+                continue;
+            }
+            if (hdr.flags == ARCHIVE_FRAME_RECORDS) {
+                SensorData zero = {};
+                SensorData rec;
+                size_t pos = 0;
+                if (archiveDecodeRecord(payload.data(), hdr.length, pos, zero, rec)) addEntry(rec.ts, offset);
+            } else if (hdr.flags == ARCHIVE_FRAME_LZ) {
+                int n = archiveLzDecompress(payload.data(), hdr.length, block.data(), ARCHIVE_LZ_BLOCK_SIZE);
+                if (n > 0) {
+                    block[n] = 0;
+                    const char* p = strstr((const char*)block.data(), "\"ts\":");
+                    if (p) addEntry(strtoull(p + 5, nullptr, 10), offset);
+                }
+            }
+            _rebuildOffset += LOG_FRAME_HEADER_SIZE + hdr.length;
+        }
+        return _rebuildOffset + LOG_FRAME_HEADER_SIZE > size;
+    }
+
+    char line[64];
+    _rebuildData.seek(_rebuildOffset);
+    while (_rebuildData.available() && _rebuildOffset < sliceEnd) {
+        // Lines start with {"ts":<ms>, only the head is needed
+        size_t len = _rebuildData.readBytesUntil('\n', line, sizeof(line) - 1);
+        line[len] = 0;
+        const char* p = strstr(line, "\"ts\":");
+        if (p) addEntry(strtoull(p + 5, nullptr, 10), _rebuildOffset);
+        if (len == sizeof(line) - 1) {
+            while (_rebuildData.available() && _rebuildData.read() != '\n'); // Skip rest of the line
+        }
+        _rebuildOffset = _rebuildData.position();
+    }
+    return !_rebuildData.available();
+}
+
+// Finds the first record boundary in [from, to) of an archive and its timestamp, reading only that
+// window: a line start (after the first newline unless from == 0) or a valid record/LZ frame.
+// Fallback for files without .idx (called with sdMutex held).
+bool SdModule::scanRecordStart(const String &archive, uint32_t from, uint32_t to, uint32_t &offset, uint64_t &ts) {
+    File data = openForRead(archive);
+    if (!data) return false;
+    if (to > data.size()) to = data.size();
+    if (from >= to) {
+        data.close();
+        return false;
+    }
+
+    std::vector<uint8_t> window(to - from + 1);
+    size_t len = data.seek(from) ? data.read(window.data(), to - from) : 0;
+    data.close();
+    window[len] = 0;
+
+    if (!archive.endsWith(".bin") && !archive.endsWith(".lz")) {
+        size_t p = 0;
+        if (from > 0) {
+            const uint8_t* nl = (const uint8_t*)memchr(window.data(), '\n', len);
+            if (!nl) return false;
+            p = nl - window.data() + 1;
+        }
+        const char* eol = (const char*)memchr(window.data() + p, '\n', len - p);
+        const char* tsKey = strstr((const char*)window.data() + p, "\"ts\":");
+        if (p >= len || !tsKey || (eol && tsKey > eol)) return false;
+        offset = from + p;
+        ts = strtoull(tsKey + 5, nullptr, 10);
+        return true;
+    }
+
+    bool lz = archive.endsWith(".lz");
+    uint16_t maxLength = lz ? ARCHIVE_LZ_MAX_OUTPUT : LOG_FRAME_MAX_PAYLOAD;
+    std::vector<uint8_t> block(lz ? ARCHIVE_LZ_BLOCK_SIZE + 1 : 0);
+    size_t p = 0;
+    while (p + LOG_FRAME_HEADER_SIZE <= len) {
+        LogFrameHeader hdr;
+        const uint8_t* payload = window.data() + p + LOG_FRAME_HEADER_SIZE;
+        if (!logFrameDecodeHeader(window.data() + p, hdr, maxLength) || p + LOG_FRAME_HEADER_SIZE + hdr.length > len ||
+            !logFrameVerify(hdr, payload)) {
+            p++;
+            continue;
+        }
+        if (hdr.flags == ARCHIVE_FRAME_RECORDS) {
+            SensorData zero = {};
+            SensorData rec;
+            size_t pos = 0;
+            if (archiveDecodeRecord(payload, hdr.length, pos, zero, rec)) {
+                offset = from + p;
+                ts = rec.ts;
+                return true;
+            }
+        } else if (hdr.flags == ARCHIVE_FRAME_LZ) {
+            int n = archiveLzDecompress(payload, hdr.length, block.data(), ARCHIVE_LZ_BLOCK_SIZE);
+            if (n > 0) {
+                block[n] = 0;
+                const char* tsKey = strstr((const char*)block.data(), "\"ts\":");
+                if (tsKey) {
+                    offset = from + p;
+                    ts = strtoull(tsKey + 5, nullptr, 10);
+                    return true;
+                }
+            }
+        }
+        p += LOG_FRAME_HEADER_SIZE + hdr.length; // Schema frame (or undecodable): next one
+    }
+    return false;
+}
+
+void SdModule::setArchiveFormat(ArchiveFormat format) {
+    if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+    if (format != _archiveFormat) {
+        writeLzBlock(); // Buffered lines belong to the current file
+        if (format == ARCHIVE_JSONL_LZ && !allocLzBuffers()) {
+            Serial.println("[SD] No memory for compressed archive, format unchanged");
+        } else {
+            if (_archiveFormat == ARCHIVE_JSONL_LZ) freeLzBuffers();
+            _archiveFormat = format;
+            _currentArchiveFilename = ""; // Next write picks/creates a file of the new format
+        }
+    }
+    if (sdMutex) xSemaphoreGive(sdMutex);
+}
+
+ArchiveFormat SdModule::getArchiveFormat() const {
+    return _archiveFormat;
 }
 
 bool SdModule::isReady() const {
@@ -1,12 +1,60 @@
 #pragma once
 #include <SD.h>
+#include <vector>
 #include <ArduinoJson.h>
 #include <freertos/semphr.h>
 #include "SensorData.h"
 #include "TimeManager.h"
+#include "LogFrame.h"
+#include "ArchiveCodec.h"
+#include "LatencyStats.h"
+#include "CanCapture.h"
+#include "GpsTrack.h"
 
 extern SemaphoreHandle_t sdMutex; // Global variable from main.ino
 
+// Position in the pending queue log (segment number + byte offset)
+struct PendingCursor {
+    uint32_t segment;
+    uint32_t offset;
+};
+
+// Byte range of one archive file covering a time query
+struct ArchiveSpan {
+    String filename;
+    uint32_t start;
+    uint32_t end;
+};
+
+class SdModule;
+
+// Reads a file in blocks for slow consumers (HTTP). sdMutex is held only while a block is read,
+// never while the caller sends it. The length is snapshotted on open, so data appended later is ignored.
+class SdChunkReader {
+public:
+    explicit SdChunkReader(SdModule &sd) : _sd(sd) {}
+    bool open(const String &path); // Opens (through SdModule::openForRead) and snapshots the length
+    void close();
+    bool isOpen() const;
+    uint32_t size() const; // Snapshotted length
+
+    void setRange(uint32_t start, uint32_t end); // Restricts sequential reads to [start, end)
+    size_t read(uint8_t* buf, size_t len); // Next bytes of the range (0 at end)
+    size_t readAt(uint32_t offset, uint8_t* buf, size_t len); // Positional read (within snapshot)
+    int readLine(char* line, size_t cap); // Next line without '\n' (truncated to cap-1), -1 at end
+
+private:
+    SdModule &_sd;
+    File _file;
+    uint32_t _size = 0;
+    uint32_t _pos = 0;
+    uint32_t _end = 0;
+
+    uint8_t _buf[512];
+    size_t _bufLen = 0;
+    size_t _bufPos = 0;
+};
+
 // SD Card Module for logging data
 class SdModule {
 public:
@@ -19,13 +67,34 @@ public:
     bool isReady() const;
 
     // Archiving
+    void setArchiveFormat(ArchiveFormat format); // JSONL (default) or binary records
+    ArchiveFormat getArchiveFormat() const;
     bool logToArchive(const SensorData* batch, int count);
-    String getLatestArchiveFilename();
+    String getLatestArchiveFilename(); // Latest archive of the current format
+    int findArchiveSpans(uint64_t fromMs, uint64_t toMs, std::vector<ArchiveSpan> &spans); // Time range -> byte ranges (uses .idx sidecars)
+    bool previousIndexOffset(const String &archive, uint32_t before, uint32_t &offset); // Last indexed offset < 'before' (call with sdMutex held)
+    void rebuildIndexStep(); // Scans the next slice of an archive without .idx (TaskSdWriter only)
+
+    // Write buffering: archive and pending handles stay open, data is flushed on a byte/time budget
+    void setFlushPolicy(size_t maxBytes, uint32_t maxMs);
+    bool flush(); // Pushes buffered data to the card (deep sleep)
+    void flushIfDue(); // Flushes when the byte or time budget is exceeded
+    File openForRead(const String &path); // Read handle; closes our write handle of that file first (call with sdMutex held)
+    void printStats(); // Write/flush latency histograms
 
-    // Pending (Offline buffer)
+    // Pending (Offline buffer) - append-only segmented log + persisted upload cursor
     bool logToPending(const SensorData* batch, int count);
-    int readPendingBatch(JsonArray &outArray, int maxItems); // Reads pending data (FIFO)
-    bool removeFirstRecords(int count); // Removes 'count' first lines from the pending file
+    int readPendingBatch(char* out, size_t cap, int maxItems, size_t &length, PendingCursor &next,
+                         const PendingCursor* from = nullptr); // Splices pending records (FIFO, from the upload cursor or 'from') into a "[...]" payload without parsing
+    bool commitPendingCursor(const PendingCursor &next); // Acknowledges records up to 'next' (O(1), no file rewrite)
+
+    // Raw CAN capture log (CAN_*.can, see CanCapture.h)
+    bool logCanCapture(const uint8_t* block, size_t length); // Appends one block (opens a new log on the first one)
+    void closeCanCapture();
+
+    // GPS track log (TRK_*.trk, see GpsTrack.h)
+    bool logGpsTrack(const uint8_t* block, size_t length); // Appends one block (opens a new log on the first one)
+    void closeGpsTrack();
 
 private:
     int _csPin;
@@ -33,10 +102,92 @@ private:
     unsigned long _lastRetryTime = 0;
     
     String _currentArchiveFilename = "";
-    const char* _pendingFilename = "/pending.jsonl";
+    ArchiveFormat _archiveFormat = ARCHIVE_JSONL;
+
+    // Persistent handles (group commit)
+    File _archiveFile;
+    String _openArchiveFilename = "";
+    size_t _archiveSize = 0;        // Tracked in memory, no reopen to check rotation
+    File _pendingFile;
+    uint32_t _openPendingSegment = 0;
+    size_t _pendingSize = 0;
+    File _captureFile;
+    String _captureFilename = "";
+    size_t _captureSize = 0;
+    File _trackFile;
+    String _trackFilename = "";
+    size_t _trackSize = 0;
+    size_t _unflushedBytes = 0;
+    unsigned long _lastFlushTime = 0;
+    size_t _flushMaxBytes = 16384;
+    uint32_t _flushMaxMs = 5000;
+
+    // Compressed archive (ARCHIVE_JSONL_LZ): lines collect here until a block is full or as old as
+    // the flush interval. The buffers (~10.7 KB) are allocated only while that format is selected.
+    uint8_t* _lzBlock = nullptr;    // ARCHIVE_LZ_BLOCK_SIZE
+    size_t _lzBlockLen = 0;
+    unsigned long _lzBlockStart = 0;
+    uint64_t _lzBlockTs = 0;        // First record of the block (indexed once the block is written)
+    uint8_t* _lzOut = nullptr;      // ARCHIVE_LZ_MAX_OUTPUT
+    uint16_t* _lzTable = nullptr;   // 1 << ARCHIVE_LZ_HASH_BITS entries
+
+    LatencyHistogram _archiveLatency;
+    LatencyHistogram _pendingLatency;
+    LatencyHistogram _flushLatency;
+    LatencyHistogram _captureLatency;
+
+    // Time index sidecar (LOG_*.idx): [ts:8][offset:4] every ARCHIVE_INDEX_INTERVAL_MS
+    const uint64_t ARCHIVE_INDEX_INTERVAL_MS = 60000;
+    String _indexedArchive = "";
+    uint64_t _lastIndexTs = 0;
+
+    // Missing sidecars are rebuilt by TaskSdWriter a slice per wakeup (rebuildIndexStep);
+    // web requests meanwhile scan a bounded window instead
+    bool _indexCheckPending = false; // Set on mount, cleared when no archive lacks its .idx
+    String _rebuildArchive = "";
+    File _rebuildData;
+    File _rebuildIdx;               // LOG_*.idt, renamed to .idx when complete
+    uint32_t _rebuildOffset = 0;
+    uint64_t _rebuildLastTs = 0;
+    const uint32_t INDEX_REBUILD_SLICE = 16 * 1024; // Archive bytes scanned per step (sdMutex held)
+    const uint32_t INDEX_FALLBACK_WINDOW = 8192;   // Bytes a web request scans for a file without .idx
     const size_t MAX_FILE_SIZE = 5 * 1024 * 1024; // 5MB limit
+    static const size_t ARCHIVE_MAX_LINE = 512; // JSONL record formatting buffer
+
+    // Pending queue log
+    const char* _legacyPendingFilename = "/pending.jsonl"; // Old line-based format (migrated on mount)
+    const char* _queueDir = "/queue";
+    const char* _cursorFilename = "/queue/cursor.bin";
+    const size_t QUEUE_SEGMENT_SIZE = 256 * 1024; // 256KB per segment
+    bool _queueLoaded = false;
+    PendingCursor _cursor = {1, 0}; // First record not yet uploaded
+    uint32_t _tailSegment = 1;      // Segment currently appended to
 
     String generateArchiveFilename(); // Generates archive filename based on date
+    String generateFilename(const char* prefix, const char* extension); // "/<prefix>_YYYYMMDD_HHMMSS<extension>" (local time), "" if time is not valid
     void rotateArchiveFile(); // Rotates (creates new) archive file
-    void checkArchiveSizeAndRotate(); // Checks if rotation is needed
+    bool openArchiveHandle(); // Opens the current archive for appending (rotates if it cannot be opened)
+    bool openPendingHandle(); // Opens the tail segment for appending
+    void flushHandles(); // Flushes open handles (called with sdMutex held)
+    void closeHandles(); // Closes open handles (called with sdMutex held)
+    const char* archiveExtension() const; // ".jsonl" or ".bin"
+    size_t writeArchiveBinary(File &file, bool withSchema, const SensorData* batch, int count); // Writes framed binary records, returns bytes (0 = error)
+    bool writeLzBlock(); // Compresses and writes the buffered block (called with sdMutex held)
+    bool allocLzBuffers();
+    void freeLzBuffers();
+    void listArchiveFiles(std::vector<String> &names); // Archives of the current format, oldest first
+
+    String indexFilename(const String &archive); // LOG_x.jsonl -> LOG_x.idx
+    void indexArchiveRecord(uint64_t ts, uint32_t offset); // Sparse entry for data written at 'offset'
+    void appendIndexEntry(uint64_t ts, uint32_t offset); // Adds an entry for the current archive
+    bool readIndexEntry(File &idx, uint32_t i, uint64_t &ts, uint32_t &offset);
+    bool rebuildIndexSlice(); // Next INDEX_REBUILD_SLICE bytes of _rebuildArchive, true when done
+    void stopIndexRebuild();
+    bool scanRecordStart(const String &archive, uint32_t from, uint32_t to, uint32_t &offset, uint64_t &ts); // First record boundary in [from, to) (bounded fallback)
+
+    String segmentPath(uint32_t segment); // Path of a queue segment
+    bool loadQueueState(); // Scans segments and restores the cursor
+    bool saveCursor(const PendingCursor &cursor); // Persists the cursor (12 bytes)
+    bool appendFrame(File &file, const uint8_t* payload, size_t length); // Writes one framed record
+    void migrateLegacyPending(); // Moves /pending.jsonl into the queue log
 };
\ No newline at end of file
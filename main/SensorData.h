@@ -1,6 +1,7 @@
 #pragma once
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include "JsonWriter.h"
 
 // Error codes
 #define ERR_GPS_NO_FIX   (1 << 0)
@@ -19,12 +20,31 @@
     XX(double,   vel,                      "vel",                      true,  true) \
     XX(float,    temp,                     "temp",                     true,  true) \
     XX(float,    can_vel,                  "can_vel",                  true,  true) \
+    XX(float,    can_vel_min,              "can_vel_min",              true,  true) \
+    XX(float,    can_vel_max,              "can_vel_max",              true,  true) \
+    XX(float,    can_vel_avg,              "can_vel_avg",              true,  true) \
+    XX(int,      can_vel_n,                "can_vel_n",                true,  true) \
     XX(uint64_t, lgr_ts,                   "lgr_ts",                   false, true) \
     XX(uint64_t, ltr_ts,                   "ltr_ts",                   false, true) \
     XX(uint64_t, lcr_ts,                   "lcr_ts",                   false, true) \
     XX(uint8_t,  ec,                       "ec",                       true,  true) \
     XX(bool,     tb_sent,                  "tb_sent",                  false, true) \
-    XX(int,      rssi,                     "rssi",                     true,  true)
+    XX(int,      rssi,                     "rssi",                     true,  true) \
+    XX(int,      drain_batch,              "drain_batch",              true,  false) \
+    XX(int,      drain_gap,                "drain_gap",                true,  false) \
+    XX(int,      can_drop,                 "can_drop",                 true,  false) \
+    XX(int,      can_ovr,                  "can_ovr",                  true,  false) \
+    XX(int,      gps_age,                  "gps_age",                  true,  false) \
+    XX(int,      temp_age,                 "temp_age",                 true,  false) \
+    XX(int,      can_age,                  "can_age",                  true,  false) \
+    XX(int,      gps_sats,                 "gps_sats",                 true,  false) \
+    XX(float,    gps_hdop,                 "gps_hdop",                 true,  false) \
+    XX(int,      gps_fixq,                 "gps_fixq",                 true,  false) \
+    XX(int,      buf_depth,                "buf_depth",                true,  false) \
+    XX(int,      buf_hwm,                  "buf_hwm",                  true,  false) \
+    XX(int,      buf_cap,                  "buf_cap",                  true,  false) \
+    XX(int,      buf_spill,                "buf_spill",                true,  false) \
+    XX(int,      buf_lost,                 "buf_lost",                 true,  false)
 
     //X-Macro fields
     //Timestamp
@@ -34,13 +54,32 @@
     //Altitude
     //Velocity
     //Temperature
-    //CAN velocity
+    //CAN velocity (last value)
+    //CAN velocity minimum over the interval (null without frames)
+    //CAN velocity maximum over the interval
+    //CAN velocity mean over the interval
+    //CAN velocity values decoded in the interval
     //Last GPS fix timestamp
     //Last temperature read timestamp
     //Last CAN message received timestamp
     //Error codes
     //ThingsBoard data flag
     //RSSI (Signal Strength)
+    //Backlog drain batch size (records)
+    //Backlog drain gap between batches (ms)
+    //CAN frames lost at a full RX queue (since boot)
+    //CAN frames lost at a full hardware RX FIFO (since boot)
+    //Age of the GPS fix at snapshot time (ms, -1 = none)
+    //Age of the temperature reading at snapshot time (ms, -1 = none)
+    //Age of the last CAN frame at snapshot time (ms, -1 = none)
+    //Satellites used in the last GGA
+    //HDOP of the last GGA
+    //Fix quality of the last GGA (0 none, 1 GPS, 2 DGPS, 4 RTK fixed, 5 RTK float, 6 dead reckoning)
+    //Snapshots waiting in the RAM buffer
+    //Largest buffer depth since the previous snapshot
+    //Buffer capacity (records)
+    //Snapshots spilled to SD at a full buffer (since boot)
+    //Snapshots lost with the SD writer queue full as well (since boot)
 
 // SensorData structure definition
 struct SensorData {
@@ -72,4 +111,52 @@ inline void sensorDataToSd(const SensorData &data, JsonObject &root) {
     }
     SENSOR_DATA_MAP(XX_TO_SD)
 #undef XX_TO_SD
-}
\ No newline at end of file
+}
+
+// 3. Writers for the same formats without a JsonDocument (no heap use)
+// Output is byte-identical to serializeJson() of sensorDataToTb / sensorDataToSd
+inline void sensorDataWriteTb(const SensorData &data, JsonWriter &out) {
+    bool first = true;
+    out.write("{\"ts\":", 6);
+    out.value(data.ts);
+    out.write(",\"values\":{", 11);
+
+#define XX_WRITE_TB(Type, Name, Key, IsTel, IsSd) \
+    if (IsTel) { \
+        if (!first) out.write(','); \
+        first = false; \
+        out.key(Key); \
+        out.value(data.Name); \
+    }
+    SENSOR_DATA_MAP(XX_WRITE_TB)
+#undef XX_WRITE_TB
+
+    out.write("}}", 2);
+}
+
+inline void sensorDataWriteSd(const SensorData &data, JsonWriter &out) {
+    bool first = true;
+    out.write('{');
+
+#define XX_WRITE_SD(Type, Name, Key, IsTel, IsSd) \
+    if (IsSd) { \
+        if (!first) out.write(','); \
+        first = false; \
+        out.key(Key); \
+        out.value(data.Name); \
+    }
+    SENSOR_DATA_MAP(XX_WRITE_SD)
+#undef XX_WRITE_SD
+
+    out.write('}');
+}
+
+// ThingsBoard batch: [record,record,...]
+inline void sensorDataWriteTbBatch(const SensorData* batch, int count, JsonWriter &out) {
+    out.write('[');
+    for (int i = 0; i < count; ++i) {
+        if (i) out.write(',');
+        sensorDataWriteTb(batch[i], out);
+    }
+    out.write(']');
+}
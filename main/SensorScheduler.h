@@ -0,0 +1,99 @@
+#pragma once
+#include <Arduino.h>
+
+#define SCHED_MAX_SENSORS 4
+
+// Multi-rate sensor scheduler (times in ms, millis() clock, wrap-safe)
+// Each sensor has its own period and deadline. A sensor is triggered when its period has passed
+// and its previous read finished; a read still running after its deadline is reported once as missed.
+// A sensor that falls behind by more than a period is re-aligned instead of triggered in a burst.
+class SensorScheduler {
+public:
+    // Registers a sensor, returns its slot (-1 if full)
+    int add(const char* name, uint32_t periodMs, uint32_t deadlineMs) {
+        if (_count >= SCHED_MAX_SENSORS) return -1;
+        Slot &s = _slots[_count];
+        s.name = name;
+        s.periodMs = periodMs;
+        s.deadlineMs = deadlineMs;
+        return _count++;
+    }
+
+    void setTiming(int slot, uint32_t periodMs, uint32_t deadlineMs) {
+        Slot &s = _slots[slot];
+        if (periodMs < MIN_PERIOD_MS) periodMs = MIN_PERIOD_MS;
+        if (s.periodMs != periodMs && s.started) s.nextDueMs = s.lastStartMs + periodMs; // Apply now, not after the old period
+        s.periodMs = periodMs;
+        s.deadlineMs = deadlineMs;
+    }
+
+    // True if the sensor should be triggered now (marks it busy)
+    bool due(int slot, uint32_t nowMs) {
+        Slot &s = _slots[slot];
+        if (s.busy || (s.started && (int32_t)(nowMs - s.nextDueMs) < 0)) return false;
+        s.nextDueMs = s.started && (int32_t)(nowMs - s.nextDueMs) < (int32_t)s.periodMs ? s.nextDueMs + s.periodMs
+                                                                                        : nowMs + s.periodMs;
+        s.started = true;
+        s.busy = true;
+        s.reportedMiss = false;
+        s.lastStartMs = nowMs;
+        s.triggers++;
+        return true;
+    }
+
+    // Read finished (result written by the sensor task)
+    void done(int slot) { _slots[slot].busy = false; }
+
+    // True once per read that runs past its deadline
+    bool missedDeadline(int slot, uint32_t nowMs) {
+        Slot &s = _slots[slot];
+        if (!s.busy || s.reportedMiss || nowMs - s.lastStartMs <= s.deadlineMs) return false;
+        s.reportedMiss = true;
+        s.misses++;
+        return true;
+    }
+
+    // Time until the next trigger or deadline of the given slots (bit per slot), capped at 'maxMs'
+    uint32_t nextEventMs(uint32_t slotMask, uint32_t nowMs, uint32_t maxMs) const {
+        uint32_t wait = maxMs;
+        for (int i = 0; i < _count; i++) {
+            if (!(slotMask & (1u << i))) continue;
+            const Slot &s = _slots[i];
+            int32_t left;
+            if (s.busy) {
+                if (s.reportedMiss) continue; // Waits for done()
+                left = (int32_t)(s.lastStartMs + s.deadlineMs + 1 - nowMs);
+            } else {
+                left = s.started ? (int32_t)(s.nextDueMs - nowMs) : 0;
+            }
+            if (left <= 0) return 0;
+            if ((uint32_t)left < wait) wait = left;
+        }
+        return wait;
+    }
+
+    int count() const { return _count; }
+    const char* name(int slot) const { return _slots[slot].name; }
+    uint32_t periodMs(int slot) const { return _slots[slot].periodMs; }
+    uint32_t triggers(int slot) const { return _slots[slot].triggers; }
+    uint32_t misses(int slot) const { return _slots[slot].misses; }
+
+private:
+    static const uint32_t MIN_PERIOD_MS = 50;
+
+    struct Slot {
+        const char* name = "";
+        uint32_t periodMs = 1000;
+        uint32_t deadlineMs = 1000;
+        uint32_t nextDueMs = 0;
+        uint32_t lastStartMs = 0;
+        uint32_t triggers = 0;
+        uint32_t misses = 0;
+        bool started = false;
+        bool busy = false;
+        bool reportedMiss = false;
+    };
+
+    Slot _slots[SCHED_MAX_SENSORS];
+    int _count = 0;
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// Latest sample of one sensor, published by its task and read by the coordinator without a lock (seqlock).
+// One writer per slot: publish() never waits for a reader. read() copies the sample and retries only if
+// a publish() ran during the copy. publish() is a critical section (a copy of a few dozen bytes), so a
+// higher-priority reader cannot preempt it halfway and spin on the odd sequence.
+template <typename T>
+class SensorSlot {
+public:
+    // --- Producer (the sensor task) ---
+    void publish(const T &sample) {
+        portENTER_CRITICAL(&_mux); // Only the writer takes it (no preemption mid-copy)
+        uint32_t seq = _seq.load(std::memory_order_relaxed);
+        _seq.store(seq + 1, std::memory_order_relaxed); // Odd: update in progress
+        std::atomic_thread_fence(std::memory_order_release);
+        _sample = sample;
+        _seq.store(seq + 2, std::memory_order_release);
+        portEXIT_CRITICAL(&_mux);
+    }
+
+    // --- Consumer (coordinator) ---
+
+    // Copies the latest sample. False if nothing was published yet.
+    bool read(T &out) const {
+        uint32_t seq;
+        do {
+            seq = _seq.load(std::memory_order_acquire);
+            out = _sample;
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((seq & 1) || seq != _seq.load(std::memory_order_relaxed));
+        return seq != 0;
+    }
+
+private:
+    T _sample = {};
+    std::atomic<uint32_t> _seq{0}; // Even: stable, odd: publish() in progress
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+// Per-sensor samples (each task keeps its own copy and publishes all of it, so values survive failed reads)
+struct GpsSample {
+    double lat;
+    double lon;
+    double alt;
+    double vel;
+    uint64_t fixTs;      // When the fix was parsed (ms, lgr_ts)
+    int satellites;
+    float hdop;
+    int fixQuality;
+    bool fix;            // Clears ERR_GPS_NO_FIX
+};
+
+struct TempSample {
+    float temp;
+    uint64_t readTs;     // Last good reading (ms, ltr_ts)
+    bool ok;             // Clears ERR_TEMP_FAIL
+};
+
+struct CanSample {
+    uint64_t frameTs;    // Last frame with decoded signals (ms, lcr_ts)
+};
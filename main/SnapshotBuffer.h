@@ -0,0 +1,173 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include "SensorData.h"
+
+#define SNAPSHOT_BUFFER_MAX_INTERNAL 240   // Largest capacity without PSRAM (records, ~50 KB)
+#define SNAPSHOT_BUFFER_MAX_PSRAM    20000 // Largest capacity in PSRAM (records, ~4 MB)
+#define SNAPSHOT_SPILL_SLACK         8     // Slots past the capacity, holding records until the SD writer moves them
+
+// Snapshot ring between the Coordinator (push), TaskDataSync (pop) and TaskSdWriter (overflow).
+// Storage is in PSRAM when the board has it and can be resized at runtime (BUFFER_CAPACITY). Records past
+// the capacity wait in SNAPSHOT_SPILL_SLACK extra slots until TaskSdWriter moves them to the SD log
+// (takeOverflow), so push() never waits for the card. A record is lost only when the slack is full as well
+// (SD stall, counted). A new capacity is applied by TaskSdWriter once the records above it are on SD.
+class SnapshotBuffer {
+public:
+    bool begin(int capacity) {
+        if (!_mutex) _mutex = xSemaphoreCreateMutex();
+        _requested = clampCapacity(capacity);
+        return applyCapacity();
+    }
+
+    static int maxCapacity() { return psramFound() ? SNAPSHOT_BUFFER_MAX_PSRAM : SNAPSHOT_BUFFER_MAX_INTERNAL; }
+    static int clampCapacity(int capacity) { return capacity < 1 ? 1 : (capacity > maxCapacity() ? maxCapacity() : capacity); }
+
+    // New capacity (clamped to 1..maxCapacity()), applied later by TaskSdWriter (applyCapacity)
+    void requestCapacity(int capacity) {
+        lock();
+        _requested = clampCapacity(capacity);
+        unlock();
+    }
+    bool capacityPending() const { return _requested != _capacity; }
+
+    // --- Producer (Coordinator) ---
+
+    // False if the ring is over its capacity: the oldest records wait for the SD writer (wake it),
+    // or one was lost because the slack was full too
+    bool push(const SensorData &record) {
+        lock();
+        if (_count == _slots) {
+            _head = (_head + 1) % _slots;
+            _count--;
+            _lost++;
+        }
+        _records[(_head + _count) % _slots] = record;
+        _count++;
+        if (_count > _highWater) _highWater = _count;
+        bool over = _count > limit();
+        unlock();
+        return !over;
+    }
+
+    // --- Consumer (TaskDataSync) ---
+
+    // Oldest records first
+    int pop(SensorData* out, int max) {
+        lock();
+        int count = _count < max ? _count : max;
+        for (int i = 0; i < count; i++) out[i] = _records[(_head + i) % _slots];
+        _head = _slots ? (_head + count) % _slots : 0;
+        _count -= count;
+        unlock();
+        return count;
+    }
+
+    // --- Spill (TaskSdWriter) ---
+
+    // Records above the capacity (or above a smaller requested one)
+    int overflow() const {
+        int count = _count - limit();
+        return count > 0 ? count : 0;
+    }
+
+    // Takes up to 'max' of the oldest records above the capacity
+    int takeOverflow(SensorData* out, int max) {
+        lock();
+        int count = _count - limit();
+        if (count > max) count = max;
+        if (count < 0) count = 0;
+        for (int i = 0; i < count; i++) out[i] = _records[(_head + i) % _slots];
+        _head = (_head + count) % _slots;
+        _count -= count;
+        unlock();
+        return count;
+    }
+
+    // Result of takeOverflow(): 'taken' of 'count' records are on SD, the rest go back to the front
+    // (lost only if pushes filled the ring meanwhile)
+    void spillDone(const SensorData* records, int count, int taken) {
+        lock();
+        _spilled += taken;
+        for (int i = count - 1; i >= taken; i--) {
+            if (_count == _slots) {
+                _lost += i - taken + 1;
+                break;
+            }
+            _head = (_head + _slots - 1) % _slots;
+            _records[_head] = records[i];
+            _count++;
+        }
+        unlock();
+    }
+
+    // Moves the records to storage for the requested capacity once they fit in it (call after the
+    // overflow is on SD). False if still pending, or if the storage could not be allocated: then the
+    // request is dropped and the old storage stays (capacityPending() is false).
+    bool applyCapacity() {
+        lock();
+        int capacity = _requested;
+        bool fits = _count <= capacity;
+        unlock();
+        if (capacity == _capacity || !fits) return false;
+
+        int slots = capacity + SNAPSHOT_SPILL_SLACK;
+        SensorData* records = (SensorData*)heap_caps_malloc((size_t)slots * sizeof(SensorData),
+                                                            psramFound() ? MALLOC_CAP_SPIRAM : MALLOC_CAP_8BIT);
+        lock();
+        if (!records) {
+            _requested = _capacity;
+            unlock();
+            return false;
+        }
+        if (_count > slots || _requested != capacity) {
+            // Pushes or a new request meanwhile: next time
+            unlock();
+            heap_caps_free(records);
+            return false;
+        }
+        for (int i = 0; i < _count; i++) records[i] = _records[(_head + i) % _slots];
+        SensorData* old = _records;
+        _records = records;
+        _capacity = capacity;
+        _slots = slots;
+        _head = 0;
+        unlock();
+
+        if (old) heap_caps_free(old);
+        return true;
+    }
+
+    // --- Metrics ---
+    int size() const { return _count; }
+    int capacity() const { return _capacity; }
+    uint32_t spilled() const { return _spilled; }
+    uint32_t lost() const { return _lost; }
+
+    // Largest depth since the previous call
+    int takeHighWater() {
+        lock();
+        int highWater = _highWater;
+        _highWater = _count;
+        unlock();
+        return highWater;
+    }
+
+private:
+    SemaphoreHandle_t _mutex = NULL;
+    SensorData* _records = NULL; // Guarded by _mutex
+    int _capacity = 0;
+    int _slots = 0;              // _capacity + SNAPSHOT_SPILL_SLACK
+    volatile int _requested = 0;
+    int _head = 0;
+    volatile int _count = 0;
+    int _highWater = 0;
+    volatile uint32_t _spilled = 0; // Since boot
+    volatile uint32_t _lost = 0;
+
+    // Records kept for TaskDataSync: a shrink spills down to the new size before it is applied
+    int limit() const { return _requested < _capacity ? _requested : _capacity; }
+
+    void lock() { if (_mutex) xSemaphoreTake(_mutex, portMAX_DELAY); }
+    void unlock() { if (_mutex) xSemaphoreGive(_mutex); }
+};
@@ -23,7 +23,7 @@ ThingsBoardClient::ThingsBoardClient(const char* server, int port,
 
 bool ThingsBoardClient::connect() {
     _mqttClient.setServer(_server, _port);
-    _mqttClient.setBufferSize(4096);
+    _mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
 
     if (WiFi.status() != WL_CONNECTED) {
         Serial.println("[TB] WiFi not connected!");
@@ -39,6 +39,9 @@ bool ThingsBoardClient::connect() {
             _mqttClient.setCallback(onMqttMessage);
             _mqttClient.subscribe("v1/devices/me/attributes");
             _mqttClient.subscribe("v1/devices/me/attributes/response/+");
+
+            // Markers of an older connection will never be answered
+            _sessionAckId = _nextAckId;
             
             return true;
         } else {
@@ -62,7 +65,7 @@ void ThingsBoardClient::loop() {
 void ThingsBoardClient::requestSharedAttributes() {
     if (!_mqttClient.connected()) return;
     // Request specific shared keys
-    const char* payload = "{\"sharedKeys\":\"SEND_BATCH_SIZE,Delay_MAIN,Delay_WIFI,BUFFER_SEND_THRESHOLD,REQUIRE_VALID_TIME,BUFFER_CAPACITY\"}";
+    const char* payload = "{\"sharedKeys\":\"SEND_BATCH_SIZE,Delay_MAIN,Delay_WIFI,Period_GPS,Period_TEMP,Deadline_GPS,Deadline_TEMP,BUFFER_SEND_THRESHOLD,REQUIRE_VALID_TIME,BUFFER_CAPACITY,SD_FLUSH_BYTES,SD_FLUSH_INTERVAL,PENDING_BATCH_SIZE,GPS_TRACK,GPS_TRACK_RATE_HZ,CAN_CAPTURE,CAN_CAPTURE_SECONDS,CAN_CAPTURE_MAX_KB,CAN_CAPTURE_ID,CAN_CAPTURE_MASK\"}";
     _mqttClient.publish("v1/devices/me/attributes/request/1", payload);
     Serial.println("[TB] Requested shared attributes");
 }
@@ -71,36 +74,31 @@ void ThingsBoardClient::setAttributesCallback(void (*callback)(const JsonObject
     _attributesCallback = callback;
 }
 
-int ThingsBoardClient::sendBatchDirect(JsonArray &batch) {
-    if (batch.size() == 0) return 0;
+// Telemetry is streamed: the length is measured first, then the JSON is written
+// straight into the MQTT connection through JsonWriter's small staging buffer.
+// Payload size is not limited by the MQTT buffer and no copy of it is kept in RAM.
 
-    String payload;
-    // Serialization to String (required by PubSubClient)
-    if (serializeJson(batch, payload) == 0) {
-        Serial.println("[TB][ERR] Serialization failed (Out of memory?)");
-        return 0;
-    }
+int ThingsBoardClient::sendBatch(const SensorData* batch, int count) {
+    if (count <= 0) return 0;
 
-    // Automatic reconnection if lost
-    if (!_mqttClient.connected()) {
-        if (!connect()) {
-            // Serial.println("[TB][ERR] Cannot send - MQTT disconnected");
-            return 0;
-        }
-    }
+    JsonWriter measure;
+    sensorDataWriteTbBatch(batch, count, measure);
 
-    // Increase MQTT buffer if payload is large
-    if (payload.length() > _mqttClient.getBufferSize()) {
-        _mqttClient.setBufferSize(payload.length() + 100);
-    }
+    if (!beginTelemetry(measure.length())) return 0;
 
-    // Publish to telemetry topic
-    if (_mqttClient.publish("v1/devices/me/telemetry", payload.c_str())) {
-        return batch.size();
-    } else {
-        Serial.println("[TB][ERR] Publish failed!");
-        return 0;
-    }
+    JsonWriter out(_mqttClient);
+    sensorDataWriteTbBatch(batch, count, out);
+    return endTelemetry(out, measure.length()) ? count : 0;
+}
+
+int ThingsBoardClient::sendRawBatch(const char* payload, size_t length, int count) {
+    if (count <= 0 || length == 0) return 0;
+
+    if (!beginTelemetry(length)) return 0;
+
+    JsonWriter out(_mqttClient);
+    out.write(payload, length);
+    return endTelemetry(out, length) ? count : 0;
 }
 
 void ThingsBoardClient::sendClientAttribute(const char* key, const char* value) {
@@ -122,6 +120,43 @@ void ThingsBoardClient::sendClientAttribute(const char* key, const char* value)
     }
 }
 
+// Messages of one connection are handled in order by the server, so the response to a
+// marker acknowledges all telemetry published before it (at-least-once, like QoS 1 PUBACK).
+// Re-sent records are harmless: ThingsBoard stores telemetry by ts and overwrites duplicates.
+
+uint32_t ThingsBoardClient::requestAck() {
+    if (!_mqttClient.connected()) return 0;
+
+    uint32_t id = _nextAckId;
+    char topic[48];
+    snprintf(topic, sizeof(topic), "v1/devices/me/attributes/request/%lu", (unsigned long)id);
+    if (!_mqttClient.publish(topic, "{\"clientKeys\":\"ip\"}")) {
+        Serial.println("[TB][ERR] Ack request failed!");
+        return 0;
+    }
+    _nextAckId++;
+    return id;
+}
+
+AckState ThingsBoardClient::ackState(uint32_t id) {
+    if (id < _sessionAckId || !_mqttClient.connected()) return ACK_LOST;
+    return _ackedId >= id ? ACK_DONE : ACK_WAITING;
+}
+
+bool ThingsBoardClient::waitForAck(uint32_t id, uint32_t timeoutMs) {
+    unsigned long start = millis();
+    for (;;) {
+        _mqttClient.loop();
+        AckState state = ackState(id);
+        if (state != ACK_WAITING) return state == ACK_DONE;
+        if (millis() - start >= timeoutMs) {
+            Serial.printf("[TB][ERR] No ack for marker %lu\n", (unsigned long)id);
+            return false;
+        }
+        delay(10);
+    }
+}
+
 // -----------------------------------------------------
 // --------------- Private Methods ---------------------
 // -----------------------------------------------------
@@ -135,8 +170,18 @@ void ThingsBoardClient::onMqttMessage(char* topic, byte* payload, unsigned int l
 }
 
 void ThingsBoardClient::processMessage(char* topic, byte* payload, unsigned int length) {
+    // Ack marker responses: only the id matters
+    static const char responsePrefix[] = "v1/devices/me/attributes/response/";
+    if (strncmp(topic, responsePrefix, sizeof(responsePrefix) - 1) == 0) {
+        uint32_t id = strtoul(topic + sizeof(responsePrefix) - 1, nullptr, 10);
+        if (id >= ACK_FIRST_ID) {
+            if (id > _ackedId) _ackedId = id;
+            return;
+        }
+    }
+
     // Basic check to avoid buffer overflow
-    if (length > 4096) return;
+    if (length > MQTT_BUFFER_SIZE) return;
 
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, payload, length);
@@ -167,6 +212,36 @@ void ThingsBoardClient::processMessage(char* topic, byte* payload, unsigned int
     }
 }
 
+bool ThingsBoardClient::beginTelemetry(size_t length) {
+    // Automatic reconnection if lost
+    if (!_mqttClient.connected()) {
+        if (!connect()) {
+            return false;
+        }
+    }
+
+    if (!_mqttClient.beginPublish("v1/devices/me/telemetry", length, false)) {
+        Serial.println("[TB][ERR] Publish failed!");
+        return false;
+    }
+    return true;
+}
+
+bool ThingsBoardClient::endTelemetry(JsonWriter &out, size_t length) {
+    out.flush();
+    // A short write leaves the broker waiting for the rest of the packet - drop the connection
+    if (out.overflowed() || out.length() != length) {
+        Serial.printf("[TB][ERR] Publish failed after %u of %u bytes\n", (unsigned)out.length(), (unsigned)length);
+        _mqttClient.disconnect();
+        return false;
+    }
+    if (!_mqttClient.endPublish()) {
+        Serial.println("[TB][ERR] Publish failed!");
+        return false;
+    }
+    return true;
+}
+
 const char* ThingsBoardClient::getMqttStateDescription(int state) {
     switch (state) {
         case -4: return "MQTT_CONNECTION_TIMEOUT";
@@ -5,6 +5,13 @@
 #include "SdModule.h"
 #include <ArduinoJson.h>
 
+// Delivery state of an ack marker (see requestAck)
+enum AckState : uint8_t {
+    ACK_WAITING = 0,
+    ACK_DONE,
+    ACK_LOST // Connection dropped after the marker was sent
+};
+
 // ThingsBoard client (MQTT)
 class ThingsBoardClient {
 public:
@@ -18,9 +25,17 @@ public:
     void loop(); // Keeps MQTT connection alive
     void requestSharedAttributes(); // Request shared attributes from ThingsBoard
     void setAttributesCallback(void (*callback)(const JsonObject &data)); // Register callback for attributes updates
-    int  sendBatchDirect(JsonArray &batch); // Sends data directly from JsonArray (from ringBuffer) to ThingsBoard
+    int  sendBatch(const SensorData* batch, int count); // Sends records (from ringBuffer) to ThingsBoard
+    int  sendRawBatch(const char* payload, size_t length, int count); // Sends a ready "[...]" payload (from Pending) as is
     void sendClientAttribute(const char* key, const char* value); // Sends a client attribute (static info)
 
+    // Delivery acknowledgement: PubSubClient publishes at QoS 0 only, so an attribute request is
+    // sent behind the telemetry. Its response shows the server received everything before it on this
+    // connection, not that the telemetry was stored (ThingsBoard persists it asynchronously).
+    uint32_t requestAck(); // Publishes an ack marker, returns its id (0 = not sent)
+    AckState ackState(uint32_t id); // Polled after loop()
+    bool waitForAck(uint32_t id, uint32_t timeoutMs); // Blocks (running loop()) until acked, lost or timed out
+
 private:
     const char* _server;
     int _port;
@@ -31,10 +46,19 @@ private:
     WiFiClient _wifiClient;
     PubSubClient _mqttClient;
 
+    static const uint16_t MQTT_BUFFER_SIZE = 1024; // Incoming messages and publish headers (payloads are streamed)
+    static const uint32_t ACK_FIRST_ID = 2; // Request id 1 is the shared attributes request
+
+    uint32_t _nextAckId = ACK_FIRST_ID;
+    uint32_t _sessionAckId = ACK_FIRST_ID; // First marker of the current connection
+    uint32_t _ackedId = 0; // Latest marker answered (responses come back in order)
+
     static ThingsBoardClient* _instance; // Instance for static callback
     
     void (*_attributesCallback)(const JsonObject &data) = nullptr; // Attributes callback
     static void onMqttMessage(char* topic, byte* payload, unsigned int length); // Internal MQTT callback
     void processMessage(char* topic, byte* payload, unsigned int length); // Process MQTT message
     static const char* getMqttStateDescription(int state); // Get MQTT state description
+    bool beginTelemetry(size_t length); // Starts a streamed telemetry publish of 'length' bytes
+    bool endTelemetry(JsonWriter &out, size_t length); // Completes it, checks that 'length' bytes were written
 };
\ No newline at end of file
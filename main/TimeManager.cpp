@@ -4,10 +4,14 @@
 #include <WiFi.h>
 
 // --- static variables ---
-volatile uint64_t TimeManager::baseUnixMs = 0;
-volatile uint32_t TimeManager::baseMillis = 0;
-volatile bool TimeManager::timeValid = false;
-volatile uint32_t TimeManager::lastPpsMillis = 0;
+portMUX_TYPE TimeManager::clockMux = portMUX_INITIALIZER_UNLOCKED;
+std::atomic<uint32_t> TimeManager::clockSeq{0};
+TimeManager::ClockBase TimeManager::clockBase = {};
+int64_t TimeManager::lastPpsUs = 0;
+uint32_t TimeManager::ppsCount = 0;
+bool TimeManager::freqValid = false;
+bool TimeManager::ppsLabelled = false;
+int32_t TimeManager::lastOffsetUs = 0;
 TimeSource TimeManager::currentSource = TIME_LOCAL;
 
 const char* ntpServer1 = "pool.ntp.org";
@@ -35,82 +39,147 @@ void TimeManager::begin(int PPS_PIN) {
     ntpEnabled = true;
 }
 
+// Integer math only (no FPU in ISRs)
 void IRAM_ATTR TimeManager::handlePPS() {
-    uint32_t now = millis();
-    lastPpsMillis = now;
-
-    // Optional: If we are already valid/synced, we can increment the second counter here
-    // for smoother transitions between GPS updates.
-    if (timeValid && baseUnixMs >= MIN_VALID_UNIX_MS) {
-        // If we are roughly 1 second from last baseMillis, increment
-        uint32_t delta = now - baseMillis;
-        if (delta > 900 && delta < 1100) {
-             baseUnixMs += 1000;
-             baseMillis = now;
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&clockMux);
+    int64_t periodUs = now - lastPpsUs;
+    lastPpsUs = now;
+    ppsCount++;
+
+    ClockBase base = clockBase;
+    int64_t unixUs = unixAt(base, now);
+    bool changed = false;
+
+    // Oscillator error from the PPS period (µs per second = ppm)
+    int64_t errorUs = periodUs - 1000000LL;
+    if (errorUs > -TIME_MAX_FREQ_ERROR_PPM && errorUs < TIME_MAX_FREQ_ERROR_PPM) {
+        int32_t measuredPpb = (int32_t)(errorUs * 1000);
+        base.freqPpb = freqValid ? base.freqPpb + (measuredPpb - base.freqPpb) / TIME_FREQ_FILTER : measuredPpb;
+        freqValid = true;
+        changed = true;
+    }
+
+    // Phase: the edge is a whole UTC second (the nearest one, once GPS time labelled an edge)
+    base.slewUs = 0;
+    if (base.valid && ppsLabelled) {
+        int64_t second = (unixUs + 500000LL) / 1000000LL * 1000000LL;
+        int64_t offset = unixUs - second;
+        lastOffsetUs = (int32_t)offset;
+        if (offset >= -TIME_SLEW_MAX_US && offset <= TIME_SLEW_MAX_US) {
+            base.slewUs = (int32_t)offset; // Removed over the next second, the clock stays monotonic
+        } else {
+            unixUs = second;
         }
+        changed = true;
+    }
+
+    if (changed) {
+        base.unixUs = unixUs;
+        base.timerUs = now;
+        writeBase(base);
     }
+    portEXIT_CRITICAL_ISR(&clockMux);
 }
+
 // --- Update from GPS ---
-void TimeManager::updateFromGps(uint64_t gpsUnixMs) {
+void TimeManager::updateFromGps(uint64_t gpsUnixMs, int64_t parsedUs) {
     if (gpsUnixMs == 0) return;
     if (gpsUnixMs < MIN_VALID_UNIX_MS) {
         Serial.println("[TimeManager] updateFromGps: gps time below MIN_VALID_UNIX_MS, ignoring");
         return;
     }
-
-    // If PPS was received recently (within last 900ms), align to it
-    // Usually GPS data comes 100-500ms after PPS.
-    if (millis() - lastPpsMillis < 900) {
-         baseUnixMs = gpsUnixMs;
-         baseMillis = lastPpsMillis; 
+    int64_t now = esp_timer_get_time();
+    if (parsedUs < 0 || parsedUs > now) parsedUs = now;
+    int64_t gpsUs = (int64_t)gpsUnixMs * 1000LL;
+
+    static const char* lastState = NULL; // Logged on change (only called from the coordinator)
+
+    portENTER_CRITICAL(&clockMux);
+    bool wasLocked = ppsLabelled && now - lastPpsUs < TIME_PPS_TIMEOUT_US;
+    bool wasHoldover = ppsLabelled && !wasLocked;
+    ClockBase base = clockBase;
+    const char* state;
+
+    if (lastPpsUs && now - lastPpsUs < TIME_PPS_TIMEOUT_US && now - parsedUs < 2000000LL) {
+        // The sentence time came 0..1 s after its epoch's edge, so the last edge is the next whole
+        // second at or after the sentence time carried forward to the edge
+        int64_t atEdge = gpsUs + (lastPpsUs - parsedUs);
+        int64_t second = (atEdge + 999999LL) / 1000000LL * 1000000LL;
+        if (!ppsLabelled || !base.valid || llabs(unixAt(base, lastPpsUs) - second) > TIME_SLEW_MAX_US) {
+            base.unixUs = second;
+            base.timerUs = lastPpsUs;
+            base.slewUs = 0;
+            base.valid = true;
+            writeBase(base);
+        }
+        ppsLabelled = true;
+        state = "PPS locked";
+    } else if (wasHoldover && base.valid && now - lastPpsUs < TIME_HOLDOVER_MAX_US &&
+               llabs(unixAt(base, parsedUs) - gpsUs) < 1000000LL) {
+        // Holdover: the free-running clock beats NMEA (sentence latency up to ~1 s)
+        state = "PPS lost, holdover";
     } else {
-         baseUnixMs = gpsUnixMs;
-         baseMillis = millis();
+        // NMEA only: the epoch time at parse time (off by the sentence latency)
+        state = "NMEA time (no PPS)";
+        base.unixUs = gpsUs;
+        base.timerUs = parsedUs;
+        base.slewUs = 0;
+        base.valid = true;
+        writeBase(base);
+        ppsLabelled = false;
     }
-    
-    timeValid = true;
+    int32_t freqPpb = clockBase.freqPpb;
+    portEXIT_CRITICAL(&clockMux);
+
     currentSource = TIME_GPS;
+    if (state != lastState) Serial.printf("[TimeManager] %s (oscillator %+ld ppb)\n", state, (long)freqPpb);
+    lastState = state;
 }
 
 // --- Synchronization ---
 void TimeManager::syncTime(uint64_t unixMs) {
     if (unixMs >= MIN_VALID_UNIX_MS) {
-        baseUnixMs = unixMs;
-        baseMillis = millis();
-        timeValid = true;
+        portENTER_CRITICAL(&clockMux);
+        ClockBase base = clockBase;
+        base.unixUs = (int64_t)unixMs * 1000LL;
+        base.timerUs = esp_timer_get_time();
+        base.slewUs = 0;
+        base.valid = true;
+        writeBase(base);
+        ppsLabelled = false;
+        portEXIT_CRITICAL(&clockMux);
         currentSource = TIME_WIFI;
     } else {
         Serial.println("[TimeManager] syncTime: rejected too-small unixMs");
     }
 }
 
-
-
-
-
-
-// --- getTimestampMs ---
-uint64_t TimeManager::getTimestampMs() {
+// --- getTimestampUs ---
+uint64_t TimeManager::getTimestampUs() {
     // 1. GPS or previously synchronized time
-    if (timeValid && baseUnixMs >= MIN_VALID_UNIX_MS) {
-        uint32_t delta = millis() - baseMillis;
-        return baseUnixMs + delta;
+    ClockBase base = readBase();
+    if (base.valid) {
+        return (uint64_t)unixAt(base, esp_timer_get_time());
     }
 
     // 2. NTP if available
     uint64_t ntpMs = getNtpTimeMs();
     if (ntpMs > 0) {
         // If it's the first time, save as base
-        if (!timeValid) {
-            syncTime(ntpMs);
-        }
+        syncTime(ntpMs);
         currentSource = TIME_WIFI;
-        return ntpMs;
+        return ntpMs * 1000ULL;
     }
 
     // 3. No source -> local time
     currentSource = TIME_LOCAL;
-    return millis();
+    return (uint64_t)esp_timer_get_time();
+}
+
+// --- getTimestampMs ---
+uint64_t TimeManager::getTimestampMs() {
+    return getTimestampUs() / 1000ULL;
 }
 
 // --- getTimeSource ---
@@ -118,12 +187,24 @@ TimeSource TimeManager::getTimeSource() {
     return currentSource;
 }
 
-
-
+// --- getStatus ---
+TimeStatus TimeManager::getStatus() {
+    int64_t now = esp_timer_get_time();
+    TimeStatus status;
+    portENTER_CRITICAL(&clockMux);
+    status.valid = clockBase.valid;
+    status.ppsLocked = ppsLabelled && now - lastPpsUs < TIME_PPS_TIMEOUT_US;
+    status.holdover = ppsLabelled && !status.ppsLocked;
+    status.freqErrorPpb = clockBase.freqPpb;
+    status.lastOffsetUs = lastOffsetUs;
+    status.ppsCount = ppsCount;
+    portEXIT_CRITICAL(&clockMux);
+    return status;
+}
 
 // --- isSynchronized ---
 bool TimeManager::isSynchronized() {
-    if (timeValid && baseUnixMs >= MIN_VALID_UNIX_MS) return true;
+    if (readBase().valid) return true;
     return (time(nullptr) > 100000);
 }
 
@@ -131,6 +212,36 @@ bool TimeManager::isSynchronized() {
 // --------------- Private Methods ---------------------
 // -----------------------------------------------------
 
+// Torn-read-free copy of the base: retried while a writer (PPS ISR, other core) is updating it
+TimeManager::ClockBase TimeManager::readBase() {
+    ClockBase base;
+    uint32_t seq;
+    do {
+        seq = clockSeq.load(std::memory_order_acquire);
+        base = clockBase;
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || seq != clockSeq.load(std::memory_order_relaxed));
+    return base;
+}
+
+void IRAM_ATTR TimeManager::writeBase(const ClockBase &base) {
+    uint32_t seq = clockSeq.load(std::memory_order_relaxed);
+    clockSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    clockBase = base;
+    clockSeq.store(seq + 2, std::memory_order_release);
+}
+
+// Unix µs at an esp_timer time: oscillator error removed, phase slewed over the first second
+int64_t IRAM_ATTR TimeManager::unixAt(const ClockBase &base, int64_t timerUs) {
+    int64_t elapsed = timerUs - base.timerUs;
+    int64_t unixUs = base.unixUs + elapsed - elapsed * base.freqPpb / 1000000000LL;
+    if (base.slewUs && elapsed > 0) {
+        unixUs -= elapsed >= TIME_SLEW_US ? base.slewUs : base.slewUs * elapsed / TIME_SLEW_US;
+    }
+    return unixUs;
+}
+
 // --- getNtpTimeMs ---
 uint64_t TimeManager::getNtpTimeMs() {
     if (!ntpEnabled) return 0;
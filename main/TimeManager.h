@@ -1,6 +1,16 @@
 #pragma once
 #include <Arduino.h>
 #include <time.h>
+#include <atomic>
+#include "esp_timer.h"
+
+// PPS discipline
+#define TIME_PPS_TIMEOUT_US     1500000LL    // No PPS for this long: holdover on the measured frequency
+#define TIME_HOLDOVER_MAX_US    3600000000LL // Holdover longer than this: NMEA time sets the clock again
+#define TIME_MAX_FREQ_ERROR_PPM 500          // PPS periods further off 1 s are not used for the frequency estimate
+#define TIME_FREQ_FILTER        8            // Each PPS period moves the frequency estimate by 1/8 of its error
+#define TIME_SLEW_MAX_US        500          // Phase errors up to this are slewed out over one second, larger ones stepped
+#define TIME_SLEW_US            1000000LL
 
 // Time source
 enum TimeSource {
@@ -9,27 +19,57 @@ enum TimeSource {
     TIME_GPS   = 2
 };
 
+// Clock state (getStatus())
+struct TimeStatus {
+    bool valid;            // Clock set from GPS or NTP
+    bool ppsLocked;        // PPS labelled by GPS time and seen within TIME_PPS_TIMEOUT_US
+    bool holdover;         // PPS lost, running on the measured frequency
+    int32_t freqErrorPpb;  // Local oscillator error (+ = esp_timer runs fast)
+    int32_t lastOffsetUs;  // Clock minus PPS edge at the last pulse
+    uint32_t ppsCount;
+};
+
 // Time Manager (Static Class)
+// Unix time = base + esp_timer µs since the base, corrected by the oscillator error measured between
+// PPS pulses. Each pulse also corrects the phase. Readers take the base without locking (seqlock);
+// the PPS ISR and the tasks that set the clock serialize on a spinlock.
 class TimeManager {
 public:
     static void begin(int PPS_PIN = -1); // Initialize time manager
-    
+
     // Interrupt Service Routine for PPS signal
-    static void IRAM_ATTR handlePPS(); 
+    static void IRAM_ATTR handlePPS();
 
     static void syncTime(uint64_t unixMs); // Sync time manually
+    static uint64_t getTimestampUs(); // Get current timestamp in µs
     static uint64_t getTimestampMs(); // Get current timestamp in ms
     static bool isSynchronized(); // Check if time is synchronized
 
-    static void updateFromGps(uint64_t gpsUnixMs); // Update time from GPS
+    static void updateFromGps(uint64_t gpsUnixMs, int64_t parsedUs = -1); // Update time from GPS (parsedUs: esp_timer time the sentence was parsed)
 
     static TimeSource getTimeSource(); // Get current time source
+    static TimeStatus getStatus();
 
 private:
-    static volatile uint64_t baseUnixMs;
-    static volatile uint32_t baseMillis;
-    static volatile bool timeValid;
-    static volatile uint32_t lastPpsMillis;
+    // Published by the seqlock
+    struct ClockBase {
+        int64_t unixUs;  // Unix time at timerUs
+        int64_t timerUs; // esp_timer µs
+        int32_t freqPpb; // Oscillator error
+        int32_t slewUs;  // Phase error removed during the first TIME_SLEW_US after the base
+        bool valid;
+    };
+
+    static portMUX_TYPE clockMux;
+    static std::atomic<uint32_t> clockSeq; // Odd while a writer updates clockBase
+    static ClockBase clockBase;
+
+    // Guarded by clockMux
+    static int64_t lastPpsUs;
+    static uint32_t ppsCount;
+    static bool freqValid;
+    static bool ppsLabelled; // The base came from a PPS edge labelled with GPS time
+    static int32_t lastOffsetUs;
 
     static TimeSource currentSource;
 
@@ -38,5 +78,8 @@ private:
 
     static const uint64_t MIN_VALID_UNIX_MS;
 
+    static ClockBase readBase();
+    static void IRAM_ATTR writeBase(const ClockBase &base); // Caller holds clockMux
+    static int64_t IRAM_ATTR unixAt(const ClockBase &base, int64_t timerUs);
     static uint64_t getNtpTimeMs(); // Get time from NTP
 };
@@ -40,28 +40,11 @@ void handleRoot() {
             var coordsGlobal = []; // stores current points
 
             function updateMap() {
-                fetch('/gpsdata')
-                .then(response => response.text())
-                .then(data => {
-                    var lines = data.split('\n');
-                    var coords = [];
-                    lines.forEach(line => {
-                        if(line && line.trim().length > 0){
-                            try {
-                                var obj = JSON.parse(line);
-                                var lat = parseFloat(obj.lat);
-                                var lon = parseFloat(obj.lon);
-                                if(!isNaN(lat) && !isNaN(lon)){
-                                    coords.push([lat, lon]);
-                                }
-                            } catch(e) {
-                                // Ignore parse errors
-                            }
-                        }
-                    });
-
-                    var pointLimit = parseInt(document.getElementById('pointCount').value) || coords.length;
-                    coords = coords.slice(-pointLimit);
+                // Device returns only the last N points as [[lat,lon],...]
+                var pointLimit = parseInt(document.getElementById('pointCount').value) || 50;
+                fetch('/gpsdata?last=' + pointLimit + '&tol=1')
+                .then(response => response.json())
+                .then(coords => {
                     coordsGlobal = coords; // save globally for reset button
 
                     if(coords.length > 0){
@@ -100,31 +83,337 @@ void handleRoot() {
     server.send(200, "text/html", html);
 }
 
-void handleGPSData() {
-    // Support both /data_log.txt (JSON lines) and /data.csv (legacy)
-    String targetFile = "";
-    
+// Calls fn(line) for each JSON line in the reader's range
+template <typename F>
+void forEachJsonlLine(SdChunkReader &reader, F fn) {
+    char line[512];
+    while (reader.readLine(line, sizeof(line)) >= 0) {
+        fn(line);
+    }
+}
+
+// Calls fn(record) for each record of the binary archive frames in [start, end)
+template <typename F>
+void forEachBinaryRecord(SdChunkReader &reader, uint32_t start, uint32_t end, F fn) {
+    uint8_t header[LOG_FRAME_HEADER_SIZE];
+    uint8_t payload[LOG_FRAME_MAX_PAYLOAD];
+    uint32_t offset = start;
+
+    while (offset + LOG_FRAME_HEADER_SIZE <= end) {
+        LogFrameHeader hdr;
+        if (reader.readAt(offset, header, sizeof(header)) != sizeof(header)) break;
+
+        if (!logFrameDecodeHeader(header, hdr) || offset + LOG_FRAME_HEADER_SIZE + hdr.length > end ||
+            reader.readAt(offset + LOG_FRAME_HEADER_SIZE, payload, hdr.length) != hdr.length ||
+            !logFrameVerify(hdr, payload)) {
+            offset++; // Resync on next frame
+            continue;
+        }
+        offset += LOG_FRAME_HEADER_SIZE + hdr.length;
+        if (hdr.flags != ARCHIVE_FRAME_RECORDS) continue;
+
+        SensorData prev = {};
+        SensorData rec;
+        size_t pos = 0;
+        while (pos < hdr.length && archiveDecodeRecord(payload, hdr.length, pos, prev, rec)) {
+            fn(rec);
+            prev = rec;
+        }
+    }
+}
+
+// Calls fn(line) for each JSON line of the compressed blocks in [start, end)
+template <typename F>
+void forEachLzLine(SdChunkReader &reader, uint32_t start, uint32_t end, F fn) {
+    uint8_t header[LOG_FRAME_HEADER_SIZE];
+    std::vector<uint8_t> payload(ARCHIVE_LZ_MAX_OUTPUT);
+    std::vector<uint8_t> block(ARCHIVE_LZ_BLOCK_SIZE + 1);
+    uint32_t offset = start;
+
+    while (offset + LOG_FRAME_HEADER_SIZE <= end) {
+        LogFrameHeader hdr;
+        if (reader.readAt(offset, header, sizeof(header)) != sizeof(header)) break;
+
+        if (!logFrameDecodeHeader(header, hdr, ARCHIVE_LZ_MAX_OUTPUT) || offset + LOG_FRAME_HEADER_SIZE + hdr.length > end ||
+            reader.readAt(offset + LOG_FRAME_HEADER_SIZE, payload.data(), hdr.length) != hdr.length ||
+            !logFrameVerify(hdr, payload.data())) {
+            offset++; // Resync on next frame
+            continue;
+        }
+        offset += LOG_FRAME_HEADER_SIZE + hdr.length;
+        if (hdr.flags != ARCHIVE_FRAME_LZ) continue;
+
+        int n = archiveLzDecompress(payload.data(), hdr.length, block.data(), ARCHIVE_LZ_BLOCK_SIZE);
+        if (n <= 0) continue;
+
+        // Blocks hold whole lines: split in place
+        char* line = (char*)block.data();
+        char* blockEnd = line + n;
+        while (line < blockEnd) {
+            char* eol = (char*)memchr(line, '\n', blockEnd - line);
+            if (!eol) eol = blockEnd;
+            *eol = 0;
+            fn((const char*)line);
+            line = eol + 1;
+        }
+    }
+}
+
+// Sends records of [start, end) with ts in [fromMs, toMs] as JSON lines (binary archives are decoded)
+void sendArchiveRecords(SdChunkReader &reader, const String &name, uint32_t start, uint32_t end, uint64_t fromMs, uint64_t toMs) {
+    if (name.endsWith(".bin")) {
+        char line[512];
+        forEachBinaryRecord(reader, start, end, [&](const SensorData &rec) {
+            if (rec.ts < fromMs || rec.ts > toMs) return;
+
+            JsonWriter out(line, sizeof(line));
+            sensorDataWriteSd(rec, out);
+            out.write('\n');
+            if (!out.overflowed()) server.sendContent(line, out.length());
+        });
+        return;
+    }
+
+    String chunk;
+    auto sendLine = [&](const char* line) {
+        // Lines start with {"ts":<ms>
+        const char* p = strstr(line, "\"ts\":");
+        uint64_t ts = p ? strtoull(p + 5, nullptr, 10) : 0;
+        if (ts < fromMs || ts > toMs) return;
+
+        chunk = line;
+        chunk += '\n';
+        server.sendContent(chunk);
+    };
+
+    if (name.endsWith(".lz")) {
+        forEachLzLine(reader, start, end, sendLine);
+        return;
+    }
+
+    reader.setRange(start, end);
+    forEachJsonlLine(reader, sendLine);
+}
+
+// Track point for the map
+struct GeoPoint {
+    double lat;
+    double lon;
+};
+
+const int MAX_TAIL_POINTS = 1000; // Upper bound for /gpsdata?last=N
+
+// Collects lat/lon of the last 'maxPoints' records in [start, end) of an archive file.
+// Older points are dropped while reading, so a long range never holds more than 2 * maxPoints.
+void collectPoints(SdChunkReader &reader, const String &name, uint32_t start, uint32_t end, size_t maxPoints,
+                   std::vector<GeoPoint> &out) {
+    if (maxPoints == 0) return;
+    auto keep = [&](double lat, double lon) {
+        if (out.size() >= 2 * maxPoints) out.erase(out.begin(), out.begin() + maxPoints);
+        out.push_back({lat, lon});
+    };
+
+    auto addPoint = [&](const char* line) {
+        const char* lat = strstr(line, "\"lat\":");
+        const char* lon = strstr(line, "\"lon\":");
+        if (lat && lon) keep(strtod(lat + 6, nullptr), strtod(lon + 6, nullptr));
+    };
+
+    if (name.endsWith(".bin")) {
+        forEachBinaryRecord(reader, start, end, [&](const SensorData &rec) { keep(rec.lat, rec.lon); });
+    } else if (name.endsWith(".lz")) {
+        forEachLzLine(reader, start, end, addPoint);
+    } else {
+        reader.setRange(start, end);
+        forEachJsonlLine(reader, addPoint);
+    }
+
+    if (out.size() > maxPoints) out.erase(out.begin(), out.end() - maxPoints);
+}
+
+// Douglas-Peucker simplification, tolerance in meters (local equirectangular projection).
+// Iterative to keep the small HttpServer stack safe.
+void simplifyTrack(std::vector<GeoPoint> &pts, double toleranceM) {
+    if (pts.size() < 3 || toleranceM <= 0) return;
+
+    const double mPerDegLat = 110540.0;
+    const double mPerDegLon = 111320.0 * cos(pts[0].lat * DEG_TO_RAD);
+    std::vector<uint8_t> keep(pts.size(), 0);
+    std::vector<std::pair<size_t, size_t>> stack;
+
+    keep[0] = keep[pts.size() - 1] = 1;
+    stack.push_back({0, pts.size() - 1});
+
+    while (!stack.empty()) {
+        size_t first = stack.back().first;
+        size_t last = stack.back().second;
+        stack.pop_back();
+
+        double ax = pts[first].lon * mPerDegLon, ay = pts[first].lat * mPerDegLat;
+        double dx = pts[last].lon * mPerDegLon - ax, dy = pts[last].lat * mPerDegLat - ay;
+        double segLen2 = dx * dx + dy * dy;
+
+        double maxDist2 = 0;
+        size_t index = first;
+        for (size_t i = first + 1; i < last; ++i) {
+            double px = pts[i].lon * mPerDegLon - ax, py = pts[i].lat * mPerDegLat - ay;
+            double dist2;
+            if (segLen2 > 0) {
+                double cross = px * dy - py * dx;
+                dist2 = cross * cross / segLen2;
+            } else {
+                dist2 = px * px + py * py;
+            }
+            if (dist2 > maxDist2) {
+                maxDist2 = dist2;
+                index = i;
+            }
+        }
+
+        if (maxDist2 > toleranceM * toleranceM) {
+            keep[index] = 1;
+            if (index - first > 1) stack.push_back({first, index});
+            if (last - index > 1) stack.push_back({index, last});
+        }
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < pts.size(); ++i) {
+        if (keep[i]) pts[n++] = pts[i];
+    }
+    pts.resize(n);
+}
+
+// /gpsdata?last=N[&tol=<m>] - last N points of the latest archive as [[lat,lon],...].
+// The file is read backwards one index block at a time, so the cost depends on N only.
+void handleGPSTail() {
+    int count = server.arg("last").toInt();
+    if (count <= 0) count = 1;
+    if (count > MAX_TAIL_POINTS) count = MAX_TAIL_POINTS;
+    double toleranceM = server.hasArg("tol") ? server.arg("tol").toDouble() : 0;
+
     if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+    String targetFile = sdModule.getLatestArchiveFilename();
+    if (sdMutex) xSemaphoreGive(sdMutex);
 
-    targetFile = sdModule.getLatestArchiveFilename();
+    SdChunkReader reader(sdModule);
+    if (targetFile.length() == 0 || !reader.open(targetFile)) {
+        server.send(404, "text/plain", "No GPS data (File not found)");
+        return;
+    }
 
-    if (targetFile == "") {
+    std::vector<GeoPoint> points;
+    std::vector<GeoPoint> block;
+    uint32_t end = reader.size();
+
+    while ((int)points.size() < count && end > 0) {
+        uint32_t start = 0;
+        if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+        if (!sdModule.previousIndexOffset(targetFile, end, start)) start = 0;
         if (sdMutex) xSemaphoreGive(sdMutex);
+
+        block.clear();
+        collectPoints(reader, targetFile, start, end, count - points.size(), block);
+        points.insert(points.begin(), block.begin(), block.end());
+        end = start;
+    }
+    reader.close();
+
+    if ((int)points.size() > count) points.erase(points.begin(), points.end() - count);
+    simplifyTrack(points, toleranceM);
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+
+    String chunk = "[";
+    char buf[48];
+    for (size_t i = 0; i < points.size(); ++i) {
+        snprintf(buf, sizeof(buf), "%s[%.7f,%.7f]", i ? "," : "", points[i].lat, points[i].lon);
+        chunk += buf;
+        if (chunk.length() > 1024) {
+            server.sendContent(chunk);
+            chunk = "";
+        }
+    }
+    chunk += "]";
+    server.sendContent(chunk);
+    server.sendContent("");
+}
+
+// /gpsdata?from=<ms>&to=<ms> - records in a time range, possibly spanning rotated files.
+// The .idx sidecars map the range to byte offsets, so only the matching part of each file is read.
+void handleGPSRange() {
+    uint64_t fromMs = server.hasArg("from") ? strtoull(server.arg("from").c_str(), nullptr, 10) : 0;
+    uint64_t toMs = server.hasArg("to") ? strtoull(server.arg("to").c_str(), nullptr, 10) : UINT64_MAX;
+    if (toMs < fromMs) {
+        server.send(400, "text/plain", "Invalid range (to < from)");
+        return;
+    }
+
+    std::vector<ArchiveSpan> spans;
+    if (sdModule.findArchiveSpans(fromMs, toMs, spans) == 0) {
+        server.send(404, "text/plain", "No GPS data in range");
+        return;
+    }
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+
+    for (const ArchiveSpan &span : spans) {
+        SdChunkReader reader(sdModule);
+        if (!reader.open(span.filename)) continue;
+        sendArchiveRecords(reader, span.filename, span.start, span.end, fromMs, toMs);
+        reader.close();
+    }
+
+    server.sendContent("");
+}
+
+void handleGPSData() {
+    if (server.hasArg("last")) {
+        handleGPSTail();
+        return;
+    }
+    if (server.hasArg("from") || server.hasArg("to")) {
+        handleGPSRange();
+        return;
+    }
+
+    // Whole latest archive file
+    if (sdMutex) xSemaphoreTake(sdMutex, portMAX_DELAY);
+    String targetFile = sdModule.getLatestArchiveFilename();
+    if (sdMutex) xSemaphoreGive(sdMutex);
+
+    if (targetFile == "") {
         server.send(404, "text/plain", "No GPS data (File not found)");
         return;
     }
 
-    File file = SD.open(targetFile);
-    if(!file){
-        if (sdMutex) xSemaphoreGive(sdMutex);
+    // sdMutex is taken per block inside the reader, never across a network write,
+    // so a slow client cannot stall TaskDataSync
+    SdChunkReader reader(sdModule);
+    if (!reader.open(targetFile)) {
         server.send(500, "text/plain", "Cannot open file");
         return;
     }
 
-    server.streamFile(file, "application/json");
-    file.close();
-    
-    if (sdMutex) xSemaphoreGive(sdMutex);
+    if (targetFile.endsWith(".bin") || targetFile.endsWith(".lz")) {
+        // Decoded back to JSON lines
+        server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+        server.send(200, "application/json", "");
+        sendArchiveRecords(reader, targetFile, 0, reader.size(), 0, UINT64_MAX);
+        server.sendContent("");
+    } else {
+        server.setContentLength(reader.size());
+        server.send(200, "application/json", "");
+
+        uint8_t buf[1024];
+        size_t n;
+        while ((n = reader.read(buf, sizeof(buf))) > 0) {
+            server.sendContent((const char*)buf, n);
+        }
+    }
+    reader.close();
 }
 
 // -----------------------------------------------------
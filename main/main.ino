@@ -9,6 +9,7 @@
 #include <esp_task_wdt.h>
 #include "SensorData.h"
 #include "esp_sleep.h"
+#include "esp_timer.h"
 
 // --- Modules ---
 #include "ThingsBoardClient.h"
@@ -18,6 +19,13 @@
 #include "TimeManager.h"
 #include "GpsModule.h"
 #include "CanModule.h"
+#include "CanCapture.h"
+#include "CanAggregator.h"
+#include "PublishWindow.h"
+#include "DrainController.h"
+#include "SensorScheduler.h"
+#include "SensorSlot.h"
+#include "SnapshotBuffer.h"
 
 SET_TIME_BEFORE_STARTING_SKETCH_MS(5000); // Set time before starting sketch (ms)
 
@@ -77,25 +85,69 @@ const char* MQTT_PASSWORD  = "8erz5sxd48lm797nr4ch";    // Password for ThingsBo
 #define WDT_TIMEOUT 60                      // Time before WDT reset (seconds)
 
 // Delays (volatile for dynamic update)
-volatile int Delay_MAIN = 15000;            // Main loop delay (ms) (can be changed via ThingsBoard)
+volatile int Delay_MAIN = 15000;            // Snapshot period (ms) (can be changed via ThingsBoard)
 volatile int Delay_WIFI = 30000;            // WiFi loop delay (ms) (can be changed via ThingsBoard)
 volatile int ATTR_REQUEST_INTERVAL = 300000;// Attributes request interval (ms) (can be changed via ThingsBoard)
 volatile int MQTT_KEEPALIVE_TIMEOUT = 2000; // MQTT keep-alive timeout (ms) (can be changed via ThingsBoard)
 
+// Sensor scheduling: each sensor is read at its own period, snapshots take the latest values (volatile for dynamic update)
+volatile int Period_GPS = 1000;             // GPS read period (ms) (can be changed via ThingsBoard)
+volatile int Period_TEMP = 15000;           // Temperature read period (ms) (can be changed via ThingsBoard)
+volatile int Deadline_GPS = 200;            // Longest GPS read (copy of the parsed fix) (ms) (can be changed via ThingsBoard)
+volatile int Deadline_TEMP = 1500;          // Longest temperature read, 750 ms conversion included (ms) (can be changed via ThingsBoard)
+
 // Buffer settings (volatile for dynamic update)
-volatile int BUFFER_CAPACITY = 60;          // Buffer capacity (can be changed via ThingsBoard)
+volatile int BUFFER_CAPACITY = 60;          // Snapshot buffer capacity (records, up to 240 / 20000 with PSRAM) (can be changed via ThingsBoard)
 volatile int SEND_BATCH_SIZE = 2;       // Batch size (how many records to send at once)
 volatile int BUFFER_SEND_THRESHOLD = 2; // Threshold to trigger sending (or stop background tasks)
 #define MAX_SEND_BATCH_SIZE 20          // Maximum batch size (hard limit)
+volatile int PENDING_BATCH_SIZE = 50;   // Largest batch when draining the Pending queue (can be changed via ThingsBoard)
+#define MAX_PENDING_BATCH_SIZE 300      // Maximum backlog batch (ThingsBoard accepts MQTT payloads up to 64 KB)
+#define PENDING_PAYLOAD_SIZE 16384      // Backlog upload buffer (bytes) - a batch ends at the drain batch size or this size
+#define DRAIN_MIN_GAP 100               // Shortest pause between backlog batches (ms)
+#define DRAIN_MAX_GAP 10000             // Longest pause between backlog batches (ms)
+#define PUBLISH_WINDOW 4                // Backlog batches in flight before waiting for their acks
+#define PUBLISH_ACK_TIMEOUT 10000       // Time to wait for an ack before records are re-sent (ms)
+#define ACK_POLL_INTERVAL 20            // Pause while only waiting for acks (ms)
+#define LIVE_ACK_BATCHES 8              // Live batches published per ack marker
+#define LIVE_ACK_MAX_AGE 60000          // Longest a live batch waits for its ack marker to be requested (ms)
+#define LIVE_WINDOW_RECORDS 64          // Live records held until acknowledged (about 10 KB)
+#define LIVE_ACK_MARKERS 4              // Live ack markers in flight
+#define SLEEP_ACK_WAIT 2000             // Wait for the live ack markers before deep sleep (ms)
 
 // Time sync setting (volatile for dynamic update)
 volatile bool REQUIRE_VALID_TIME = true;    // Time sync setting (can be changed via ThingsBoard)
 
+// SD write buffering (volatile for dynamic update)
+volatile int SD_FLUSH_BYTES = 16384;        // Flush SD files after this many buffered bytes (can be changed via ThingsBoard)
+volatile int SD_FLUSH_INTERVAL = 5000;      // Flush SD files at least this often (ms) (can be changed via ThingsBoard)
+#define SD_WRITE_QUEUE_LENGTH 64            // Records waiting for the SD writer task
+#define SD_STATS_INTERVAL 600000            // Print SD latency histograms (ms)
+
+// Archive format on SD (ARCHIVE_JSONL, ARCHIVE_BINARY or ARCHIVE_JSONL_LZ - decode .bin/.lz files with tools/sdlog_decode)
+ArchiveFormat ARCHIVE_FORMAT = ARCHIVE_JSONL;
+
 // Sensor Enable Flags
 bool ENABLE_GPS = true;
 bool ENABLE_TEMP = true;
 bool ENABLE_CAN = false;    
 
+// GPS track mode: every fix at the receiver rate to TRK_*.trk (export with tools/track_export) (volatile for dynamic update)
+volatile int GPS_TRACK = 0;                 // 1 = track mode on (can be changed via ThingsBoard)
+volatile int GPS_TRACK_RATE_HZ = 10;        // Receiver fix rate in track mode (1-10 Hz) (can be changed via ThingsBoard)
+
+// CAN receive
+#define CAN_RX_QUEUE_LEN 64                 // TWAI driver RX queue (frames)
+#define CAN_WAIT_MS 1000                    // Longest sleep of TaskCAN without frames (ms)
+
+// Raw CAN capture to SD (CAN_*.can, export with tools/canlog_export) (volatile for dynamic update)
+volatile int CAN_CAPTURE = 0;               // 1 = capture every frame; a capture that hit a limit restarts only after 0 (can be changed via ThingsBoard)
+volatile int CAN_CAPTURE_SECONDS = 60;      // Capture duration limit (s, 0 = none) (can be changed via ThingsBoard)
+volatile int CAN_CAPTURE_MAX_KB = 8192;     // Capture size limit (KB, 0 = none) (can be changed via ThingsBoard)
+volatile int CAN_CAPTURE_ID = 0;            // Capture filter: frames with (id & MASK) == (ID & MASK) (can be changed via ThingsBoard)
+volatile int CAN_CAPTURE_MASK = 0;          // Capture filter mask (0 = all frames) (can be changed via ThingsBoard)
+#define CAN_CAPTURE_BLOCK_MAX_MS 2000       // Partial capture blocks are written after this long (ms)
+
 
 
 // -----------------------------------------------------
@@ -111,24 +163,54 @@ bool ENABLE_CAN = false;
 // Event Bits
 #define EVENT_GPS_READY  (1 << 0)
 #define EVENT_TEMP_READY (1 << 1)
-#define EVENT_CAN_READY  (1 << 2)
 // Flags for button debouncing
 const unsigned long BUTTON_DEBOUNCE_MS = 300;
 // Sleep request flag
 volatile bool sleepRequestActive = false;
-// Delay
-const unsigned int TIMEOUT = Delay_MAIN - 3000;
-// Data structure
+// Data structure (composed by the Coordinator only)
 SensorData data;
-QueueHandle_t dataQueue;
+// Latest sample of each sensor (one writer per slot, read by the Coordinator without a lock)
+SensorSlot<GpsSample> gpsLatest;
+SensorSlot<TempSample> tempLatest;
+SensorSlot<CanSample> canLatest;
+// Snapshots waiting for TaskDataSync (PSRAM when present, overflow spills to SD)
+SnapshotBuffer snapshotBuffer;
+// Backlog drain rate (owned by TaskDataSync, reported in telemetry)
+DrainController drainController;
+// SD writer queue
+#define SD_WRITE_ARCHIVE (1 << 0)
+#define SD_WRITE_PENDING (1 << 1)
+#define SD_WRITE_FLUSH   (1 << 2) // Marker: flush files and signal sdFlushDone
+#define SD_WRITE_CAN_CAPTURE (1 << 3) // Marker: raw CAN capture blocks are ready
+#define SD_WRITE_GPS_TRACK   (1 << 4) // Marker: GPS track fixes are waiting
+#define SD_WRITE_SPILL       (1 << 5) // Marker: Snapshot Buffer over its capacity (or resize requested)
+struct SdWriteRequest {
+    SensorData data;
+    uint8_t flags;
+};
+QueueHandle_t sdWriteQueue;
+
+// Wakes the SD writer for CAN capture blocks, GPS track fixes or Snapshot Buffer overflow (marker without a record)
+void wakeSdWriter(uint8_t flags) {
+    SdWriteRequest req = {};
+    req.flags = flags;
+    xQueueSend(sdWriteQueue, &req, 0); // Queue full: the writer is awake and checks the buffers anyway
+}
+
+// Raw CAN capture blocks (filled by TaskCAN, written by TaskSdWriter)
+CanCaptureBuffer canCapture;
+// GPS track fixes (filled by the GPS parser, written by TaskSdWriter)
+GpsTrackRing gpsTrack;
+// Decoded CAN signals between coordinator ticks (filled by TaskCAN, taken by the Coordinator)
+CanAggregator canAggregator;
 
 // -----------------------------------------------------
 // -------------------- Semaphores ---------------------
 // -----------------------------------------------------
 // Used to synchronize access to shared resources
 
-SemaphoreHandle_t dataSem = NULL;
 SemaphoreHandle_t sdMutex = NULL;
+SemaphoreHandle_t sdFlushDone = NULL;
 EventGroupHandle_t sensorEventGroup = NULL;
 
 // -----------------------------------------------------
@@ -144,6 +226,7 @@ TaskHandle_t dataSyncTaskHandle = NULL;
 TaskHandle_t wifiTaskHandle = NULL;
 TaskHandle_t canModuleTaskHandle = NULL;
 TaskHandle_t webServerTaskHandle = NULL;
+TaskHandle_t sdWriterTaskHandle = NULL;
 
 // -----------------------------------------------------
 // -------------------- Modules ------------------------
@@ -196,107 +279,246 @@ void attributesCallback(const JsonObject &data) {
         Delay_WIFI = data["Delay_WIFI"];
         Serial.printf("Updated Delay_WIFI: %d\n", Delay_WIFI);
     }
+    if (data.containsKey("Period_GPS")) {
+        Period_GPS = data["Period_GPS"];
+        Serial.printf("Updated Period_GPS: %d\n", Period_GPS);
+    }
+    if (data.containsKey("Period_TEMP")) {
+        Period_TEMP = data["Period_TEMP"];
+        Serial.printf("Updated Period_TEMP: %d\n", Period_TEMP);
+    }
+    if (data.containsKey("Deadline_GPS")) {
+        Deadline_GPS = data["Deadline_GPS"];
+        Serial.printf("Updated Deadline_GPS: %d\n", Deadline_GPS);
+    }
+    if (data.containsKey("Deadline_TEMP")) {
+        Deadline_TEMP = data["Deadline_TEMP"];
+        Serial.printf("Updated Deadline_TEMP: %d\n", Deadline_TEMP);
+    }
     if (data.containsKey("SEND_BATCH_SIZE")) {
         int val = data["SEND_BATCH_SIZE"];
         if (val > MAX_SEND_BATCH_SIZE) val = MAX_SEND_BATCH_SIZE;
         SEND_BATCH_SIZE = val;
         Serial.printf("Updated SEND_BATCH_SIZE: %d\n", SEND_BATCH_SIZE);
     }
+    if (data.containsKey("PENDING_BATCH_SIZE")) {
+        int val = data["PENDING_BATCH_SIZE"];
+        if (val > MAX_PENDING_BATCH_SIZE) val = MAX_PENDING_BATCH_SIZE;
+        if (val < 1) val = 1;
+        PENDING_BATCH_SIZE = val;
+        drainController.setMaxBatch(val);
+        Serial.printf("Updated PENDING_BATCH_SIZE: %d\n", PENDING_BATCH_SIZE);
+    }
     if (data.containsKey("BUFFER_SEND_THRESHOLD")) {
         BUFFER_SEND_THRESHOLD = data["BUFFER_SEND_THRESHOLD"];
         Serial.printf("Updated BUFFER_SEND_THRESHOLD: %d\n", BUFFER_SEND_THRESHOLD);
     }
     if (data.containsKey("BUFFER_CAPACITY")) {
-        BUFFER_CAPACITY = data["BUFFER_CAPACITY"];
-        Serial.printf("Updated BUFFER_CAPACITY (needs restart): %d\n", BUFFER_CAPACITY);
+        // Applied by TaskSdWriter once the records that do not fit are on SD (spillSnapshots)
+        BUFFER_CAPACITY = SnapshotBuffer::clampCapacity(data["BUFFER_CAPACITY"]);
+        snapshotBuffer.requestCapacity(BUFFER_CAPACITY);
+        wakeSdWriter(SD_WRITE_SPILL);
+        Serial.printf("Updated BUFFER_CAPACITY: %d (requested)\n", BUFFER_CAPACITY);
+    }
+    if (data.containsKey("SD_FLUSH_BYTES")) {
+        SD_FLUSH_BYTES = data["SD_FLUSH_BYTES"];
+        sdModule.setFlushPolicy(SD_FLUSH_BYTES, SD_FLUSH_INTERVAL);
+        Serial.printf("Updated SD_FLUSH_BYTES: %d\n", SD_FLUSH_BYTES);
+    }
+    if (data.containsKey("SD_FLUSH_INTERVAL")) {
+        SD_FLUSH_INTERVAL = data["SD_FLUSH_INTERVAL"];
+        sdModule.setFlushPolicy(SD_FLUSH_BYTES, SD_FLUSH_INTERVAL);
+        Serial.printf("Updated SD_FLUSH_INTERVAL: %d\n", SD_FLUSH_INTERVAL);
     }
     if (data.containsKey("REQUIRE_VALID_TIME")) {
         REQUIRE_VALID_TIME = data["REQUIRE_VALID_TIME"];
         Serial.printf("Updated REQUIRE_VALID_TIME: %d\n", (int)REQUIRE_VALID_TIME);
     }
+    if (data.containsKey("GPS_TRACK")) {
+        GPS_TRACK = data["GPS_TRACK"];
+        Serial.printf("Updated GPS_TRACK: %d\n", GPS_TRACK);
+    }
+    if (data.containsKey("GPS_TRACK_RATE_HZ")) {
+        int val = data["GPS_TRACK_RATE_HZ"];
+        if (val < 1) val = 1;
+        if (val > 10) val = 10;
+        GPS_TRACK_RATE_HZ = val;
+        Serial.printf("Updated GPS_TRACK_RATE_HZ: %d\n", GPS_TRACK_RATE_HZ);
+    }
+    if (data.containsKey("CAN_CAPTURE")) {
+        CAN_CAPTURE = data["CAN_CAPTURE"];
+        Serial.printf("Updated CAN_CAPTURE: %d\n", CAN_CAPTURE);
+    }
+    if (data.containsKey("CAN_CAPTURE_SECONDS")) {
+        CAN_CAPTURE_SECONDS = data["CAN_CAPTURE_SECONDS"];
+        Serial.printf("Updated CAN_CAPTURE_SECONDS: %d\n", CAN_CAPTURE_SECONDS);
+    }
+    if (data.containsKey("CAN_CAPTURE_MAX_KB")) {
+        CAN_CAPTURE_MAX_KB = data["CAN_CAPTURE_MAX_KB"];
+        Serial.printf("Updated CAN_CAPTURE_MAX_KB: %d\n", CAN_CAPTURE_MAX_KB);
+    }
+    if (data.containsKey("CAN_CAPTURE_ID")) {
+        CAN_CAPTURE_ID = data["CAN_CAPTURE_ID"];
+        Serial.printf("Updated CAN_CAPTURE_ID: 0x%X\n", CAN_CAPTURE_ID);
+    }
+    if (data.containsKey("CAN_CAPTURE_MASK")) {
+        CAN_CAPTURE_MASK = data["CAN_CAPTURE_MASK"];
+        Serial.printf("Updated CAN_CAPTURE_MASK: 0x%X\n", CAN_CAPTURE_MASK);
+    }
 }
 
 // -----------------------------------------------------
 // ----------------------- TASKS -----------------------
 // -----------------------------------------------------
 
-// Coordinator: prepares timestamp, triggers sensor reads, waits for completion and pushes snapshot to buffer
+// Age of a sensor value at snapshot time (ms, -1 = never read)
+int sensorAge(uint64_t snapshotTs, uint64_t readTs) {
+    if (readTs == 0 || readTs > snapshotTs || snapshotTs - readTs > INT32_MAX) return -1; // Also read before time sync
+    return (int)(snapshotTs - readTs);
+}
+
+// Composes a snapshot from the latest sensor values and pushes it to the buffer
+void publishSnapshot() {
+    Serial.println("[COORD] Snapshot");
+
+    // Get the latest sensor samples (lock-free, producers never wait for the snapshot)
+    GpsSample gps;
+    if (gpsLatest.read(gps)) {
+        data.lat = gps.lat;
+        data.lon = gps.lon;
+        data.alt = gps.alt;
+        data.vel = gps.vel;
+        data.lgr_ts = gps.fixTs;
+        data.gps_sats = gps.satellites;
+        data.gps_hdop = gps.hdop;
+        data.gps_fixq = gps.fixQuality;
+        if (gps.fix) data.ec &= ~ERR_GPS_NO_FIX;
+        else data.ec |= ERR_GPS_NO_FIX;
+    }
+    TempSample temp;
+    if (tempLatest.read(temp)) {
+        data.temp = temp.temp;
+        data.ltr_ts = temp.readTs;
+        if (temp.ok) data.ec &= ~ERR_TEMP_FAIL;
+        else data.ec |= ERR_TEMP_FAIL;
+    }
+    CanSample lastFrame;
+    if (canLatest.read(lastFrame)) data.lcr_ts = lastFrame.frameTs;
+
+    // Get timestamp
+    data.ts = TimeManager::getTimestampMs();
+    data.ts_source = TimeManager::getTimeSource();
+    // Get sensor value ages
+    data.gps_age = sensorAge(data.ts, data.lgr_ts);
+    data.temp_age = sensorAge(data.ts, data.ltr_ts);
+    data.can_age = sensorAge(data.ts, data.lcr_ts);
+    // Get SSI (Signal Strength)
+    data.rssi = WiFi.RSSI();
+    // Get backlog drain state
+    data.drain_batch = drainController.batchSize();
+    data.drain_gap = drainController.gapMs();
+    // Get snapshot buffer state (before this snapshot)
+    data.buf_depth = snapshotBuffer.size();
+    data.buf_hwm = snapshotBuffer.takeHighWater();
+    data.buf_cap = snapshotBuffer.capacity();
+    data.buf_spill = snapshotBuffer.spilled();
+    data.buf_lost = snapshotBuffer.lost();
+    // Get CAN signal statistics of the interval and receive losses
+    if (ENABLE_CAN) {
+        CanSignalSummary can[CAN_SIGNAL_COUNT];
+        canAggregator.take(can);
+        const CanSignalSummary &vel = can[CAN_SIG_vehicle_speed];
+        if (vel.count) data.can_vel = vel.last;
+        data.can_vel_min = vel.min;
+        data.can_vel_max = vel.max;
+        data.can_vel_avg = vel.mean;
+        data.can_vel_n = vel.count;
+
+        CanStats canStats = canModule.getStats();
+        data.can_drop = canStats.rxMissed;
+        data.can_ovr = canStats.rxOverrun;
+    } else {
+        // No CAN: no frame arrived (null, not 0 km/h)
+        data.can_vel_min = NAN;
+        data.can_vel_max = NAN;
+        data.can_vel_avg = NAN;
+        data.can_vel_n = 0;
+    }
+
+    // Make a snapshot
+    SensorData snapshot = data;
+
+    int64_t gpsParsedUs;
+    uint64_t gpsUnixMs = gpsModule.getUnixTime(&gpsParsedUs);
+    TimeManager::updateFromGps(gpsUnixMs, gpsParsedUs);
+
+    // Check if time is synchronized before storing data
+    if (!TimeManager::isSynchronized() && REQUIRE_VALID_TIME) {
+        Serial.println("[COORD] Waiting for time sync...");
+        if (wifiTaskHandle) xTaskNotifyGive(wifiTaskHandle);
+    } else {
+        if (!snapshotBuffer.push(snapshot)) {
+            Serial.println("[COORD] Buffer full, oldest snapshots go to SD");
+            wakeSdWriter(SD_WRITE_SPILL);
+        }
+        // Notify TB task to process data
+        if (dataSyncTaskHandle) xTaskNotifyGive(dataSyncTaskHandle);
+    }
+}
+
+// Coordinator: triggers each sensor at its own period (SensorScheduler), reports reads past their deadline
+// and publishes a snapshot every Delay_MAIN without waiting for slow sensors. TaskCAN receives continuously.
 void CoordinatorTask(void* pvParameters) {
     // Add to WDT
     esp_task_wdt_add(NULL);
 
-    // Get last wake time
-    TickType_t xLastWakeTime = xTaskGetTickCount();
-    
+    SensorScheduler scheduler;
+    const int gpsSlot = scheduler.add("GPS", Period_GPS, Deadline_GPS);
+    const int tempSlot = scheduler.add("TEMP", Period_TEMP, Deadline_TEMP);
+    uint32_t activeSlots = 0;
+    if (ENABLE_GPS && gpsModuleTaskHandle) activeSlots |= 1u << gpsSlot;
+    if (ENABLE_TEMP && tempModuleTaskHandle) activeSlots |= 1u << tempSlot;
+
+    uint32_t nextSnapshot = millis() + Delay_MAIN;
+
     for (;;) {
-        // Wait for next wake
-        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(Delay_MAIN));
         esp_task_wdt_reset();
+        uint32_t now = millis();
 
-        // Print alive for debug
-        Serial.println("[COORD] Wakeup");
-
-        // Trigger tasks via notifications (only enabled ones)
-        if (ENABLE_GPS && gpsModuleTaskHandle) xTaskNotifyGive(gpsModuleTaskHandle);
-        if (ENABLE_TEMP && tempModuleTaskHandle) xTaskNotifyGive(tempModuleTaskHandle);
-        if (ENABLE_CAN && canModuleTaskHandle) xTaskNotifyGive(canModuleTaskHandle);
-
-        // Determine which events to wait for
-        EventBits_t expectedBits = 0;
-        if (ENABLE_GPS) expectedBits |= EVENT_GPS_READY;
-        if (ENABLE_TEMP) expectedBits |= EVENT_TEMP_READY;
-        if (ENABLE_CAN) expectedBits |= EVENT_CAN_READY;
-
-        // Wait for all enabled sensors (flags) with timeout
-        EventBits_t uxBits = 0;
-        if (expectedBits > 0) {
-            uxBits = xEventGroupWaitBits(
-                sensorEventGroup,
-                expectedBits,
-                pdTRUE,        // Clear bits on exit
-                pdTRUE,        // Wait for ALL bits (AND)
-                pdMS_TO_TICKS(TIMEOUT)
-            );
-        }
-
-        // Check which ones responded (only if enabled)
-        bool gpsDone  = !ENABLE_GPS || (uxBits & EVENT_GPS_READY);
-        bool tempDone = !ENABLE_TEMP || (uxBits & EVENT_TEMP_READY);
-        bool canDone  = !ENABLE_CAN || (uxBits & EVENT_CAN_READY);
-
-        // Output missing sensors
-        if (!gpsDone || !tempDone || !canDone) {
-             Serial.printf("[COORD] Timeout! Missing: %s%s%s\n", 
-                gpsDone ? "" : "GPS ", 
-                tempDone ? "" : "TEMP ",
-                canDone ? "" : "CAN");
-        }
-
-        xSemaphoreTake(dataSem, portMAX_DELAY);
-        // Get timestamp
-        data.ts = TimeManager::getTimestampMs();
-        data.ts_source = TimeManager::getTimeSource();
-        // Get SSI (Signal Strength)
-        data.rssi = WiFi.RSSI();
-
-        // Make a snapshot
-        SensorData snapshot = data;
-        xSemaphoreGive(dataSem);
-
-        TimeManager::updateFromGps(gpsModule.getUnixTime());
-
-        // Check if time is synchronized before storing data
-        if (!TimeManager::isSynchronized() && REQUIRE_VALID_TIME) {
-            Serial.println("[COORD] Waiting for time sync...");
-            if (wifiTaskHandle) xTaskNotifyGive(wifiTaskHandle);
-            continue;
-        } else {
-            if (xQueueSend(dataQueue, &snapshot, 0) != pdTRUE) {
-                Serial.println("[COORD] Queue full, dropping snapshot");
+        // Apply period/deadline updates
+        scheduler.setTiming(gpsSlot, Period_GPS, Deadline_GPS);
+        scheduler.setTiming(tempSlot, Period_TEMP, Deadline_TEMP);
+
+        // Trigger due sensors via notifications (only enabled ones)
+        if ((activeSlots & (1u << gpsSlot)) && scheduler.due(gpsSlot, now)) xTaskNotifyGive(gpsModuleTaskHandle);
+        if ((activeSlots & (1u << tempSlot)) && scheduler.due(tempSlot, now)) xTaskNotifyGive(tempModuleTaskHandle);
+
+        // Output sensors past their deadline (the snapshot keeps their previous value and its age)
+        for (int slot = 0; slot < scheduler.count(); slot++) {
+            if ((activeSlots & (1u << slot)) && scheduler.missedDeadline(slot, now)) {
+                Serial.printf("[COORD] %s missed its deadline (%lu missed)\n", scheduler.name(slot), (unsigned long)scheduler.misses(slot));
             }
-            // Notify TB task to process data
-            if (dataSyncTaskHandle) xTaskNotifyGive(dataSyncTaskHandle);
         }
+
+        // Snapshot every Delay_MAIN (re-aligned after a long stall)
+        if ((int32_t)(now - nextSnapshot) >= 0) {
+            nextSnapshot = now - nextSnapshot < (uint32_t)Delay_MAIN ? nextSnapshot + Delay_MAIN : now + Delay_MAIN;
+            publishSnapshot();
+            now = millis();
+        }
+
+        // Sleep until the next trigger, deadline or snapshot; finished reads wake it earlier
+        uint32_t wait = (int32_t)(nextSnapshot - now) > 0 ? nextSnapshot - now : 0;
+        wait = scheduler.nextEventMs(activeSlots, now, wait);
+        EventBits_t uxBits = xEventGroupWaitBits(
+            sensorEventGroup,
+            EVENT_GPS_READY | EVENT_TEMP_READY,
+            pdTRUE,        // Clear bits on exit
+            pdFALSE,       // Any sensor
+            pdMS_TO_TICKS(wait)
+        );
+        if (uxBits & EVENT_GPS_READY) scheduler.done(gpsSlot);
+        if (uxBits & EVENT_TEMP_READY) scheduler.done(tempSlot);
     }
 }
 
@@ -374,7 +596,8 @@ void TaskWebServer(void* pvParameters) {
         // Add to WDT
         esp_task_wdt_add(NULL);
 
-        // Loop while connected
+        // Loop while connected. Still polled: the bundled WebServer has no event hooks. A request only
+        // holds sdMutex per block read, so the 100 ms poll adds response latency, not logging latency.
         while (WiFi.status() == WL_CONNECTED) {
             esp_task_wdt_reset(); // Reset WDT
             server.handleClient(); // Handle client
@@ -392,55 +615,67 @@ void TaskWebServer(void* pvParameters) {
 void TaskGPS(void* pvParameters){
 
     esp_task_wdt_add(NULL); // Add to WDT
+
+    int lastFix = -1; // Fix state of the previous read, -1 = none yet (log changes only)
+    uint32_t lastOverflows = 0;
+    int trackRate = 0; // Receiver rate set for track mode (0 = off)
+    uint32_t trackWakeSize = 0;
+    GpsSample sample = {}; // Keeps the last fix while there is none
     
     for(;;) {
         // Wait for notification
         ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-        
-        unsigned long start = millis();
-        bool hasFix = false;
-
-        // Read GPS data for max TIMEOUT
-        do {
-            esp_task_wdt_reset(); // Feed the watchdog
-
-            // Process all available GPS data
-            while (gpsModule.available()) gpsModule.process(); 
+        esp_task_wdt_reset();
 
-            // If fix is acquired, break early
-            if (gpsModule.hasFix()) {
-                hasFix = true;
-                break; 
+        // Track mode: receiver rate and fix capture follow GPS_TRACK / GPS_TRACK_RATE_HZ
+        int wantedRate = GPS_TRACK ? GPS_TRACK_RATE_HZ : 0;
+        if (wantedRate != trackRate) {
+            if (trackRate) {
+                gpsModule.setTrackMode(0, NULL);
+                Serial.printf("[GPS] Track: %lu fixes dropped since boot (RAM ring full)\n", (unsigned long)gpsTrack.dropped());
             }
-            
-            // Short processor breath
-            vTaskDelay(pdMS_TO_TICKS(10));
+            if (wantedRate) gpsModule.setTrackMode(wantedRate, &gpsTrack);
+            trackRate = wantedRate;
+            wakeSdWriter(SD_WRITE_GPS_TRACK); // Writes the rest / closes the log when stopped
+        }
+        // Hand a full block to the SD writer (it also drains the ring on every wakeup)
+        if (gpsTrack.size() >= GPS_TRACK_BLOCK_FIXES && gpsTrack.size() != trackWakeSize) {
+            wakeSdWriter(SD_WRITE_GPS_TRACK);
+        }
+        trackWakeSize = gpsTrack.size();
 
-        } while (millis() - start < TIMEOUT);
+        // Latest fix (NMEA is parsed continuously on UART events, nothing to wait for)
+        GpsDataPacket packet = gpsModule.getData();
 
         // Write results
-        xSemaphoreTake(dataSem, portMAX_DELAY);
-        
-        if (hasFix) {
+        sample.satellites = packet.satellites;
+        sample.hdop = packet.hdop;
+        sample.fixQuality = packet.fixQuality;
+        sample.fix = packet.valid;
+        if (packet.valid) {
             // Copy data
-            GpsDataPacket packet = gpsModule.getData();
-            data.lat = packet.lat;
-            data.lon = packet.lon;
-            data.alt = packet.alt;
-            data.alt = packet.alt;
-            data.vel = packet.vel;
-            data.lgr_ts = TimeManager::getTimestampMs();
-            
-            data.ec &= ~ERR_GPS_NO_FIX;
-            Serial.printf("[GPS] Fix acquired! Lat: %f, Lon: %f\n", data.lat, data.lon);
+            sample.lat = packet.lat;
+            sample.lon = packet.lon;
+            sample.alt = packet.alt;
+            sample.vel = packet.vel;
+            sample.fixTs = TimeManager::getTimestampMs() - packet.ageMs; // When the fix was parsed
+
+            if (lastFix != 1) Serial.printf("[GPS] Fix acquired! Lat: %f, Lon: %f\n", sample.lat, sample.lon);
             digitalWrite(LED_GPS, HIGH);
         } else {
-            data.ec |= ERR_GPS_NO_FIX;
-            Serial.printf("[GPS] Timeout: No fix within %lu ms.\n", TIMEOUT);
+            if (lastFix != 0) Serial.println("[GPS] No fix");
             digitalWrite(LED_GPS, LOW);
         }
-        
-        xSemaphoreGive(dataSem);
+        gpsLatest.publish(sample);
+        lastFix = packet.valid;
+
+        // Report lost NMEA bytes
+        GpsStats stats = gpsModule.getStats();
+        if (stats.rxOverflows != lastOverflows) {
+            Serial.printf("[GPS] UART RX overflow (%lu events, %lu sentences, %lu checksum errors)\n", (unsigned long)stats.rxOverflows,
+                          (unsigned long)stats.sentences, (unsigned long)stats.checksumErrors);
+            lastOverflows = stats.rxOverflows;
+        }
 
         // Notify coordinator that GPS finished
         xEventGroupSetBits(sensorEventGroup, EVENT_GPS_READY);
@@ -453,6 +688,7 @@ void TaskTemp(void* pvParameters) {
     esp_task_wdt_add(NULL);  // Add to WDT
     
     const TickType_t CONVERSION_DELAY = pdMS_TO_TICKS(750); // Conversion delay for 12-bit resolution is max 750ms
+    TempSample sample = {}; // Keeps the last good reading after a failed one
 
     for (;;) {
         // Wait for signal from Coordinator
@@ -470,21 +706,17 @@ void TaskTemp(void* pvParameters) {
         float tempC = tempSensor.getTempCByIndex(0);
         
         // Write data
-        xSemaphoreTake(dataSem, portMAX_DELAY);
-        
         // DEVICE_DISCONNECTED_C is constant (-127.0)
-        if (tempC != DEVICE_DISCONNECTED_C && tempC > -55 && tempC < 125) {
-            data.temp = tempC; 
-            data.ltr_ts = TimeManager::getTimestampMs();
-            data.ec &= ~ERR_TEMP_FAIL;
+        sample.ok = tempC != DEVICE_DISCONNECTED_C && tempC > -55 && tempC < 125;
+        if (sample.ok) {
+            sample.temp = tempC;
+            sample.readTs = TimeManager::getTimestampMs();
             
             Serial.printf("[TEMP] Temp: %.2f C\n", tempC);
         } else {
-            data.ec |= ERR_TEMP_FAIL;
             Serial.println("[TEMP] Error: Read failed");
         }
-        
-        xSemaphoreGive(dataSem);
+        tempLatest.publish(sample);
 
         // Notify Coordinator that temperature is ready
         xEventGroupSetBits(sensorEventGroup, EVENT_TEMP_READY);
@@ -497,46 +729,276 @@ void TaskCAN(void* pvParameters) {
     esp_task_wdt_add(NULL);
 
     twai_message_t msg;
+    CanSignalValues values;
+
+    // Raw capture state
+    bool captureArmed = true;      // Cleared when a capture hits a limit, set again by CAN_CAPTURE = 0
+    unsigned long captureStart = 0;
+    size_t captureBytes = 0;
+    uint32_t captureFrames = 0;
 
     for (;;) {
         // Reset WDT
         esp_task_wdt_reset();
 
-        // Get message
-        if (canModule.getMessage(msg)) {
-            
-            // Read vehicle speed (msg, id, startBit, length, isBigEndian, factor)
-            float vehicle_speed = canModule.readSignal(msg, 0x123, 0, 2, true, 0.1f);
-            
-            // Read engine speed (msg, id, startBit, length, isBigEndian, factor)
-            //float engine_speed = canModule.readSignal(msg, 0x123, 2, 2, true, 0.1f);
-            
-            // If valid speed
-            if (vehicle_speed >= 0) {
-                
-                // Write data
-                xSemaphoreTake(dataSem, portMAX_DELAY);
-                data.can_vel = vehicle_speed;
-                data.lcr_ts = TimeManager::getTimestampMs();
-                xSemaphoreGive(dataSem);
-
-                // Signal to Coordinator
-                xEventGroupSetBits(sensorEventGroup, EVENT_CAN_READY);
+        // Raw capture control: starts on CAN_CAPTURE, ends at a limit or when CAN_CAPTURE is cleared
+        if (canCapture.active()) {
+            const char* reason = NULL;
+            if (!CAN_CAPTURE) reason = "stopped";
+            else if (CAN_CAPTURE_SECONDS > 0 && millis() - captureStart >= (unsigned long)CAN_CAPTURE_SECONDS * 1000UL) reason = "duration limit";
+            else if (CAN_CAPTURE_MAX_KB > 0 && captureBytes >= (size_t)CAN_CAPTURE_MAX_KB * 1024) reason = "size limit";
+
+            if (reason) {
+                captureBytes += canCapture.finish();
+                wakeSdWriter(SD_WRITE_CAN_CAPTURE);
+                canModule.setAcceptAll(false);
+                captureArmed = false;
+                Serial.printf("[CAN] Capture ended (%s): %lu frames, %lu bytes, %lu dropped\n", reason,
+                              (unsigned long)captureFrames, (unsigned long)captureBytes, (unsigned long)canCapture.dropped());
+            } else if (canCapture.pending() &&
+                       TimeManager::getTimestampUs() - canCapture.pendingSinceUs() >= CAN_CAPTURE_BLOCK_MAX_MS * 1000ULL) {
+                // Quiet bus: partial blocks still reach the card
+                captureBytes += canCapture.seal();
+                wakeSdWriter(SD_WRITE_CAN_CAPTURE);
             }
-        } 
-        else {
-            // No message - short pause
-            vTaskDelay(pdMS_TO_TICKS(10));
+        } else if (CAN_CAPTURE && captureArmed && canCapture.start()) {
+            captureStart = millis();
+            captureBytes = 0;
+            captureFrames = 0;
+            canModule.setAcceptAll(true);
+            Serial.printf("[CAN] Capture started (id 0x%X mask 0x%X, limits %d s / %d KB)\n",
+                          CAN_CAPTURE_ID, CAN_CAPTURE_MASK, CAN_CAPTURE_SECONDS, CAN_CAPTURE_MAX_KB);
+        }
+        if (!CAN_CAPTURE) captureArmed = true;
+
+        // Sleep until the driver has queued frames (RX alert)
+        if (!canModule.waitForFrames(pdMS_TO_TICKS(CAN_WAIT_MS))) continue;
+
+        // Drain the RX queue, decoding all signals of a frame at once (CAN_SIGNAL_MAP in CanSignals.h)
+        bool decoded = false;
+        while (canModule.getMessage(msg)) {
+            if (canCapture.active() && ((msg.identifier ^ (uint32_t)CAN_CAPTURE_ID) & (uint32_t)CAN_CAPTURE_MASK) == 0) {
+                uint64_t timeUs = TimeManager::getTimestampUs(); // PPS-disciplined, same clock as GPS time
+                size_t sealed = canCapture.add(timeUs, msg.identifier, msg.extd, msg.rtr, msg.data_length_code, msg.data);
+                captureFrames++;
+                if (sealed) {
+                    captureBytes += sealed;
+                    wakeSdWriter(SD_WRITE_CAN_CAPTURE);
+                }
+            }
+
+            values.updated = 0;
+            if (canModule.decode(msg, values) == 0) continue; // Frame without mapped signals
+
+            // Accumulate (min/max/mean/count/last, taken by the Coordinator)
+            canAggregator.add(values);
+            decoded = true;
+        }
+
+        if (decoded) {
+            // Write data (lock-free, a busy bus never delays the snapshot)
+            CanSample sample;
+            sample.frameTs = TimeManager::getTimestampMs();
+            canLatest.publish(sample);
+        }
+    }
+}
+
+// Hands records to the SD writer task (never blocks on the card)
+void enqueueSdWrite(const SensorData* batch, int count, uint8_t flags) {
+    SdWriteRequest req;
+    req.flags = flags;
+    for (int i = 0; i < count; ++i) {
+        req.data = batch[i];
+        if (xQueueSend(sdWriteQueue, &req, pdMS_TO_TICKS(100)) != pdTRUE) {
+            Serial.println("[SD] Write queue full, dropping record");
         }
     }
 }
 
+// Snapshot Buffer records above its capacity go to the SD log as unsent (archive + pending, uploaded from
+// there later), then a requested BUFFER_CAPACITY is applied. Runs on TaskSdWriter, so the Coordinator never
+// waits for the card; during an SD stall the records stay in RAM and a shrink waits.
+void spillSnapshots() {
+    static SensorData spill[SNAPSHOT_SPILL_SLACK];
+    while (snapshotBuffer.overflow() > 0 && sdModule.ensureReady()) {
+        int count = snapshotBuffer.takeOverflow(spill, SNAPSHOT_SPILL_SLACK);
+        if (count == 0) break;
+        for (int i = 0; i < count; ++i) spill[i].tb_sent = false;
+        // Pending decides: it is what gets the records uploaded. The archive is written only after it,
+        // so a retry never archives records twice, and a missing archive (no time yet) does not block spills.
+        bool ok = sdModule.logToPending(spill, count);
+        snapshotBuffer.spillDone(spill, count, ok ? count : 0);
+        if (!ok) {
+            Serial.printf("[SD] %d snapshots not spilled, kept in RAM\n", count);
+            break;
+        }
+        if (!sdModule.logToArchive(spill, count)) Serial.printf("[SD] %d spilled snapshots not archived\n", count);
+    }
+
+    if (snapshotBuffer.capacityPending()) {
+        if (snapshotBuffer.applyCapacity()) {
+            Serial.printf("[SD] Snapshot buffer resized to %d records\n", snapshotBuffer.capacity());
+        } else if (!snapshotBuffer.capacityPending()) {
+            BUFFER_CAPACITY = snapshotBuffer.capacity();
+            Serial.printf("[SD] BUFFER_CAPACITY: allocation failed, keeping %d\n", BUFFER_CAPACITY);
+        }
+    }
+}
+
+// Waits until the SD writer has written and flushed everything queued before this call
+bool flushSdWriter(uint32_t timeoutMs) {
+    SdWriteRequest req = {};
+    req.flags = SD_WRITE_FLUSH;
+    xSemaphoreTake(sdFlushDone, 0); // Clear a stale signal
+    if (xQueueSend(sdWriteQueue, &req, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) return false;
+    return xSemaphoreTake(sdFlushDone, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+}
+
+// --- TASK: SD Writer ---
+// Single owner of SD writes. Drains the queue into one group per wakeup so the
+// archive/pending handles stay open and flushes follow the SD_FLUSH_* budget.
+void TaskSdWriter(void* pvParameters) {
+    static SdWriteRequest req;
+    static SensorData archiveBatch[SD_WRITE_QUEUE_LENGTH];
+    static SensorData pendingBatch[SD_WRITE_QUEUE_LENGTH];
+    static GpsTrackFix trackFixes[GPS_TRACK_BLOCK_FIXES];
+    static uint8_t trackBlock[GPS_TRACK_BLOCK_SIZE];
+    unsigned long lastStats = millis();
+
+    for (;;) {
+        int archiveCount = 0;
+        int pendingCount = 0;
+        bool flushRequested = false;
+
+        // Wait for the first record, then take whatever else is already queued
+        if (xQueueReceive(sdWriteQueue, &req, pdMS_TO_TICKS(SD_FLUSH_INTERVAL)) == pdTRUE) {
+            do {
+                if (req.flags & SD_WRITE_FLUSH) {
+                    flushRequested = true;
+                    break; // Records behind the marker belong to the next group
+                }
+                if (req.flags & SD_WRITE_ARCHIVE) archiveBatch[archiveCount++] = req.data;
+                if (req.flags & SD_WRITE_PENDING) pendingBatch[pendingCount++] = req.data;
+            } while (archiveCount < SD_WRITE_QUEUE_LENGTH && pendingCount < SD_WRITE_QUEUE_LENGTH &&
+                     xQueueReceive(sdWriteQueue, &req, 0) == pdTRUE);
+        }
+
+        if (archiveCount > 0 || pendingCount > 0) {
+            if (sdModule.ensureReady()) {
+                digitalWrite(LED_SD, HIGH);
+                if (archiveCount > 0) sdModule.logToArchive(archiveBatch, archiveCount);
+                if (pendingCount > 0) sdModule.logToPending(pendingBatch, pendingCount);
+            } else {
+                digitalWrite(LED_SD, LOW);
+                Serial.println("[SD] SD Error: Cannot save data.");
+            }
+        }
+
+        // Snapshot Buffer overflow and resize (woken by SD_WRITE_SPILL, checked every wakeup)
+        spillSnapshots();
+
+        // Raw CAN capture blocks (woken by SD_WRITE_CAN_CAPTURE)
+        size_t blockLength = 0;
+        while (const uint8_t* block = canCapture.full(blockLength)) {
+            if (!sdModule.ensureReady() || !sdModule.logCanCapture(block, blockLength)) {
+                Serial.println("[SD] CAN capture block lost");
+            }
+            canCapture.release();
+        }
+        if (canCapture.finished()) {
+            sdModule.closeCanCapture();
+            canCapture.close();
+        }
+
+        // GPS track fixes (every wakeup, at least each SD_FLUSH_INTERVAL)
+        int fixCount;
+        while ((fixCount = gpsTrack.pop(trackFixes, GPS_TRACK_BLOCK_FIXES)) > 0) {
+            size_t length = gpsTrackEncodeBlock(trackFixes, fixCount, trackBlock);
+            if (!sdModule.ensureReady() || !sdModule.logGpsTrack(trackBlock, length)) {
+                Serial.printf("[SD] GPS track block lost (%d fixes)\n", fixCount);
+            }
+        }
+        if (!gpsTrack.active()) sdModule.closeGpsTrack();
+
+        if (flushRequested) {
+            sdModule.flush();
+            xSemaphoreGive(sdFlushDone);
+        } else {
+            sdModule.flushIfDue();
+        }
+        sdModule.rebuildIndexStep(); // Archives without .idx, a slice per wakeup
+
+        if (millis() - lastStats > SD_STATS_INTERVAL) {
+            lastStats = millis();
+            sdModule.printStats();
+        }
+    }
+}
+
+// Live records published to ThingsBoard, waiting for their ack marker (TaskDataSync only)
+LiveAckWindow<LIVE_WINDOW_RECORDS, LIVE_ACK_MARKERS> liveWindow;
+
+// Hands the oldest of 'count' held live records to the SD writer, as many as its queue has room for
+// (never waits, never drops): archive only when acknowledged, archive + pending (re-sent from there)
+// otherwise. Returns how many were handed over; the rest stay in the window for the next pass.
+int releaseLiveRecords(int count, bool sent) {
+    int space = (int)uxQueueSpacesAvailable(sdWriteQueue);
+    if (count > space) count = space;
+    if (count == 0) return 0;
+
+    SensorData* records = liveWindow.records();
+    for (int i = 0; i < count; ++i) records[i].tb_sent = sent;
+    enqueueSdWrite(records, count, sent ? SD_WRITE_ARCHIVE : (SD_WRITE_ARCHIVE | SD_WRITE_PENDING));
+    liveWindow.drop(count);
+    if (sent) Serial.printf("[TB] Sent %d records from Buffer.\n", count);
+    else Serial.printf("[TB] %d records from Buffer not acknowledged, queued for re-send\n", count);
+    return count;
+}
+
+// Requests an ack marker once LIVE_ACK_BATCHES batches (or LIVE_ACK_MAX_AGE) are uncovered and
+// resolves answered markers in publish order. Never blocks: the live path keeps publishing while
+// markers are outstanding. 'closing' (deep sleep) gives up on everything still unanswered.
+void serviceLiveAcks(bool closing) {
+    bool online = tbClient.isConnected();
+    if (online) tbClient.loop(); // Receives marker responses
+
+    if (online && liveWindow.canCover() &&
+        (closing || liveWindow.uncoveredBatches() >= LIVE_ACK_BATCHES ||
+         liveWindow.space() < MAX_SEND_BATCH_SIZE || millis() - liveWindow.uncoveredSince() >= LIVE_ACK_MAX_AGE)) {
+        uint32_t ackId = tbClient.requestAck();
+        if (ackId) liveWindow.cover(ackId);
+    }
+
+    if (closing && liveWindow.hasMarker() && !liveWindow.frontResolved()) {
+        tbClient.waitForAck(liveWindow.backAckId(), SLEEP_ACK_WAIT);
+    }
+
+    while (liveWindow.hasMarker()) {
+        if (!liveWindow.frontResolved()) {
+            AckState state = tbClient.ackState(liveWindow.frontAckId());
+            if (state == ACK_WAITING && !closing && millis() - liveWindow.frontSentAt() < PUBLISH_ACK_TIMEOUT) break;
+            liveWindow.resolveFront(state == ACK_DONE);
+        }
+        int count = liveWindow.frontCount();
+        if (releaseLiveRecords(count, liveWindow.frontSent()) < count) return; // SD writer queue full
+    }
+
+    // No marker behind them and none can be sent (offline, closing or publish failing)
+    if (!liveWindow.empty() && !liveWindow.hasMarker() &&
+        (!online || closing || millis() - liveWindow.uncoveredSince() >= LIVE_ACK_MAX_AGE + PUBLISH_ACK_TIMEOUT)) {
+        releaseLiveRecords(liveWindow.size(), false);
+    }
+}
+
 // --- TASK: ThingsBoard & SD Logging ---
 void TaskDataSync(void* pvParameters) {
     // Register Watchdog
     esp_task_wdt_add(NULL);
     
     SensorData batch[MAX_SEND_BATCH_SIZE];
+    static char pendingPayload[PENDING_PAYLOAD_SIZE];
+    static PublishWindow<PUBLISH_WINDOW> window; // Backlog batches waiting for their ack
     static unsigned long lastAttrRequest = 0;
 
     for (;;) {
@@ -570,95 +1032,122 @@ void TaskDataSync(void* pvParameters) {
             }
         }
 
-        // --- Process New Data (RAM Queue) ---
+        // --- Process New Data (RAM Buffer) ---
         // Flush the RAM buffer to prevent overflow
-        while (uxQueueMessagesWaiting(dataQueue) >= BUFFER_SEND_THRESHOLD) {
+        while (snapshotBuffer.size() >= BUFFER_SEND_THRESHOLD) {
             esp_task_wdt_reset();
 
-            // Pop data from Queue
-            int count = 0;
             // Limit batch size to either SEND_BATCH_SIZE or MAX available
             int limit = (SEND_BATCH_SIZE < MAX_SEND_BATCH_SIZE) ? SEND_BATCH_SIZE : MAX_SEND_BATCH_SIZE;
-
-            while (count < limit && uxQueueMessagesWaiting(dataQueue) > 0) {
-                if (xQueueReceive(dataQueue, &batch[count], 0) == pdTRUE) {
-                    count++;
-                }
-                else {
-                    break;
-                }
-            }
-
+            // Only what the SD writer can take now: during an SD stall records wait in the buffer
+            int sdSpace = (int)uxQueueSpacesAvailable(sdWriteQueue);
+            if (sdSpace < limit) limit = sdSpace;
+            // Published records wait in the live window for their ack: while it is full they stay in the buffer
+            bool online = tbClient.isConnected();
+            if (online && liveWindow.space() < limit) limit = liveWindow.space();
+
+            // Pop data from Buffer
+            int count = snapshotBuffer.pop(batch, limit);
             if (count == 0) break;
 
-            // Try to send via MQTT
-            bool sent = false;
-            if (tbClient.isConnected()) {
-                JsonDocument doc;
-                JsonArray arr = doc.to<JsonArray>();
-                for (int i = 0; i < count; ++i) {
-                    JsonObject o = arr.createNestedObject();
-                    sensorDataToTb(batch[i], o);
-                }
-                
-                if (tbClient.sendBatchDirect(arr)) {
-                    sent = true;
-                    Serial.printf("[TB] Sent %d records from Buffer.\n", count);
-                }
+            // Published: archived once the ack marker behind it is answered (serviceLiveAcks)
+            if (online && tbClient.sendBatch(batch, count)) {
+                liveWindow.add(batch, count);
+                serviceLiveAcks(false);
+                continue;
             }
 
-            // Update sent status in the struct
-            for (int i = 0; i < count; ++i) batch[i].tb_sent = sent;
-
-            // Save to SD Card
-            if (sdModule.ensureReady()) {
-                digitalWrite(LED_SD, HIGH);
-                
-                // Always save to Archive
-                sdModule.logToArchive(batch, count);
-                
-                // If offline, save to Pending as well
-                if (!sent) {
-                    sdModule.logToPending(batch, count);
-                }
-            } else {
-                digitalWrite(LED_SD, LOW);
-                Serial.println("[SD] SD Error: Cannot save data.");
-            }
+            // Offline or publish failed: Archive and Pending
+            for (int i = 0; i < count; ++i) batch[i].tb_sent = false;
+            enqueueSdWrite(batch, count, SD_WRITE_ARCHIVE | SD_WRITE_PENDING);
         }
+        serviceLiveAcks(false);
 
         // --- Process Old Data (Pending File) ---
         // Only if online AND RAM queue is empty
-        if (tbClient.isConnected() && uxQueueMessagesWaiting(dataQueue) == 0) {
-        
-            while (uxQueueMessagesWaiting(dataQueue) < BUFFER_SEND_THRESHOLD) {
+        // Batches are pipelined: up to PUBLISH_WINDOW are in flight, each followed by an ack
+        // marker. The upload cursor only moves past a batch once its marker is answered.
+        if (tbClient.isConnected() && snapshotBuffer.size() == 0) {
+            window.clear();
+            bool drained = false;
+            unsigned long lastPublish = millis() - drainController.gapMs();
+
+            for (;;) {
                 esp_task_wdt_reset();
 
-                JsonDocument doc;
-                JsonArray arr = doc.to<JsonArray>();
+                // Live data first: shrink the batch and let the loop above send it
+                // (unacknowledged batches are re-sent from the upload cursor later)
+                if (snapshotBuffer.size() >= BUFFER_SEND_THRESHOLD) {
+                    drainController.onPressure();
+                    break;
+                }
 
-                // Read from SD
-                int readCount = sdModule.readPendingBatch(arr, SEND_BATCH_SIZE);
+                // Publish the next batch while the window has room, paced by the drain gap
+                if (!drained && !window.full() && millis() - lastPublish >= drainController.gapMs()) {
+                    // Read from SD (raw records spliced into one payload), behind the batches in flight
+                    PendingCursor nextCursor;
+                    size_t payloadLength = 0;
+                    int readCount = sdModule.readPendingBatch(pendingPayload, sizeof(pendingPayload), drainController.batchSize(),
+                                                              payloadLength, nextCursor, window.empty() ? nullptr : &window.back().next);
+
+                    if (readCount == 0) {
+                        // Nothing valid left - still skip over any corrupted frames
+                        if (window.empty()) sdModule.commitPendingCursor(nextCursor);
+                        drained = true;
+                    } else {
+                        uint32_t ackId = tbClient.sendRawBatch(pendingPayload, payloadLength, readCount) ? tbClient.requestAck() : 0;
+                        if (!ackId) {
+                            // Failed to send, retry later
+                            drainController.onFailure();
+                            break;
+                        }
+                        lastPublish = millis();
+                        window.push({ackId, nextCursor, readCount, lastPublish});
+                    }
+                }
 
-                if (readCount == 0) break; // No more pending data
+                tbClient.loop(); // Receives the ack markers (and other incoming messages)
+                serviceLiveAcks(false);
+
+                // Acknowledged batches, in publish order: advance the upload cursor
+                bool lost = false;
+                while (!window.empty()) {
+                    const InFlightBatch &inFlight = window.front();
+                    AckState state = tbClient.ackState(inFlight.ackId);
+                    if (state == ACK_WAITING && millis() - inFlight.sentAt < PUBLISH_ACK_TIMEOUT) break;
+                    if (state != ACK_DONE) {
+                        lost = true;
+                        break;
+                    }
+                    Serial.printf("[TB] Sent %d records from Pending.\n", inFlight.count);
+                    sdModule.commitPendingCursor(inFlight.next);
+                    drainController.onSuccess(millis() - inFlight.sentAt);
+                    window.pop();
+                }
 
-                // Try to send
-                if (tbClient.sendBatchDirect(arr)) {
-                    Serial.printf("[TB] Sent %d records from Pending.\n", readCount);
-                    
-                    // Success: Clear the pending file
-                    sdModule.removeFirstRecords(readCount); 
-                } else {
-                    // Failed to send, retry later
-                    break; 
+                if (lost) {
+                    // Connection lost or no ack: re-send from the last acknowledged record later
+                    Serial.printf("[TB] %d batches not acknowledged, will retry\n", window.size());
+                    drainController.onFailure();
+                    break;
                 }
-                
-                vTaskDelay(pdMS_TO_TICKS(2000)); // Yield to other tasks
+                if (drained && window.empty()) break; // No more pending data
+
+                // Short polls: acks are seen within ACK_POLL_INTERVAL of their arrival, not after the gap,
+                // so the ack latency given to the drain controller is the link's
+                vTaskDelay(pdMS_TO_TICKS(ACK_POLL_INTERVAL));
             }
         }
 
         if (sleepRequestActive) {
             sleepRequestActive = false;
+            // Held live records to SD before the flush, waiting for room in the SD writer queue
+            unsigned long start = millis();
+            serviceLiveAcks(true);
+            while (!liveWindow.empty() && millis() - start < SLEEP_ACK_WAIT) {
+                vTaskDelay(pdMS_TO_TICKS(ACK_POLL_INTERVAL));
+                serviceLiveAcks(true);
+            }
             if (sleepTaskHandle) xTaskNotifyGive(sleepTaskHandle);
         }
     }
@@ -708,6 +1197,13 @@ void TaskSleep(void* pvParameters) {
             Serial.println("[SLEEP] Data sync timeout (forcing sleep anyway).");
         }
 
+        // Write and flush everything queued for the SD card
+        if (flushSdWriter(3000)) {
+            Serial.println("[SLEEP] SD flushed.");
+        } else {
+            Serial.println("[SLEEP] SD flush timeout.");
+        }
+
         // Enter Deep Sleep
         // Wake up when button pin goes LOW again
         esp_sleep_enable_ext0_wakeup((gpio_num_t)WAKE_BUTTON_PIN, 0);
@@ -734,13 +1230,22 @@ void setup() {
     pinMode(LED_SD, OUTPUT);
 
     // Resources
-    dataSem = xSemaphoreCreateMutex();
     sdMutex = xSemaphoreCreateMutex();
+    sdFlushDone = xSemaphoreCreateBinary();
     sensorEventGroup = xEventGroupCreate();
 
-    dataQueue = xQueueCreate(BUFFER_CAPACITY, sizeof(SensorData));
-    if (dataQueue == NULL) {
-        Serial.println("[SETUP] CRITICAL ERROR: Failed to create dataQueue!");
+    drainController.begin(SEND_BATCH_SIZE, PENDING_BATCH_SIZE, DRAIN_MIN_GAP, DRAIN_MAX_GAP, 2000);
+
+    if (!snapshotBuffer.begin(BUFFER_CAPACITY)) {
+        Serial.println("[SETUP] CRITICAL ERROR: Failed to create snapshotBuffer!");
+        while(1);
+    }
+    BUFFER_CAPACITY = snapshotBuffer.capacity();
+    Serial.printf("[SETUP] Snapshot buffer: %d records (%s)\n", BUFFER_CAPACITY, psramFound() ? "PSRAM" : "internal RAM");
+
+    sdWriteQueue = xQueueCreate(SD_WRITE_QUEUE_LENGTH, sizeof(SdWriteRequest));
+    if (sdWriteQueue == NULL) {
+        Serial.println("[SETUP] CRITICAL ERROR: Failed to create sdWriteQueue!");
         while(1);
     }
 
@@ -752,6 +1257,8 @@ void setup() {
     TimeManager::begin(PPS_PIN);
 
     // SD
+    sdModule.setArchiveFormat(ARCHIVE_FORMAT);
+    sdModule.setFlushPolicy(SD_FLUSH_BYTES, SD_FLUSH_INTERVAL);
     if (sdModule.ensureReady()){
         digitalWrite(LED_SD, HIGH);
         Serial.println("[SETUP] SD Card OK");
@@ -782,14 +1289,15 @@ void setup() {
     // CAN
     if (ENABLE_CAN) {
         Serial.println("[SETUP] Enabling CAN...");
-        canModule.begin();
+        canModule.begin(CAN_RX_QUEUE_LEN);
         xTaskCreate(TaskCAN, "CAN", 4096, NULL, 2, &canModuleTaskHandle);
     }
 
     // Logic Tasks
     xTaskCreate(CoordinatorTask, "SensorFusion", 8192, NULL, 2, &coordinatorTaskHandle);
     xTaskCreate(TaskDataSync, "Telemetry", 16384, NULL, 1, &dataSyncTaskHandle);
-    xTaskCreate(TaskWebServer, "HttpServer", 4096, NULL, 1, &webServerTaskHandle);
+    xTaskCreate(TaskSdWriter, "SdWriter", 8192, NULL, 1, &sdWriterTaskHandle);
+    xTaskCreate(TaskWebServer, "HttpServer", 8192, NULL, 1, &webServerTaskHandle);
     xTaskCreate(TaskSleep, "Sleep", 4096, NULL, 5, &sleepTaskHandle);
 
     // Interrupts
@@ -0,0 +1,167 @@
+// Arduino core pieces of the host simulation: virtual clock, Serial, time(), SNTP
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "Arduino.h"
+#include "esp_sleep.h"
+
+SimConfig simConfig;
+SimStats simStats;
+
+// -----------------------------------------------------
+// ------------------- Virtual clock -------------------
+// -----------------------------------------------------
+
+static std::chrono::steady_clock::time_point realStart = std::chrono::steady_clock::now();
+static uint64_t unixStartMs = 0;
+
+void simClockStart() {
+    realStart = std::chrono::steady_clock::now();
+    unixStartMs = simConfig.startUnixMs;
+    if (unixStartMs == 0) {
+        unixStartMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+}
+
+uint64_t simMicros64() {
+    std::chrono::duration<double, std::micro> real = std::chrono::steady_clock::now() - realStart;
+    return (uint64_t)(real.count() * simConfig.speed);
+}
+
+// Set while a simulated ISR runs: its clock reads stand still at the edge (µs latency on the device)
+static thread_local int64_t isrEdgeUs = -1;
+
+void simRunIsr(uint64_t edgeUs, void (*isr)()) {
+    isrEdgeUs = (int64_t)edgeUs;
+    isr();
+    isrEdgeUs = -1;
+}
+
+uint64_t simLocalMicros64() {
+    uint64_t us = isrEdgeUs >= 0 ? (uint64_t)isrEdgeUs : simMicros64();
+    return us + (int64_t)((double)us * simConfig.driftPpm * 1e-6);
+}
+
+uint64_t simUnixMsAt(uint64_t virtualMs) {
+    return unixStartMs + virtualMs;
+}
+
+std::chrono::steady_clock::time_point simRealTime(uint64_t virtualUs) {
+    std::chrono::duration<double, std::micro> real(virtualUs / simConfig.speed);
+    return realStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(real);
+}
+
+void simSleepUntilUs(uint64_t virtualUs) {
+    std::this_thread::sleep_until(simRealTime(virtualUs));
+}
+
+void simSleepMs(uint32_t virtualMs) {
+    simSleepUntilUs(simMicros64() + (uint64_t)virtualMs * 1000);
+}
+
+bool simWifiUp() {
+    if (simConfig.outagePeriodMs == 0 || simConfig.outageLengthMs == 0) return true;
+    return simMillis64() % simConfig.outagePeriodMs < simConfig.outagePeriodMs - simConfig.outageLengthMs;
+}
+
+// -----------------------------------------------------
+// ------------------------ Time -----------------------
+// -----------------------------------------------------
+
+static std::atomic<bool> sntpConfigured{false};
+static std::atomic<bool> sntpSynced{false};
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1, const char* server2,
+                const char* server3) {
+    (void)gmtOffsetSec; (void)daylightOffsetSec; (void)server1; (void)server2; (void)server3;
+    sntpConfigured = true;
+}
+
+void simOnGotIp() {
+    if (sntpConfigured) sntpSynced = true;
+}
+
+// Replaces the C library time() for the whole program (firmware and libraries)
+extern "C" time_t time(time_t* out) noexcept {
+    time_t now = sntpSynced ? (time_t)(simUnixMs() / 1000) : (time_t)(simMillis64() / 1000);
+    if (out) *out = now;
+    return now;
+}
+
+// -----------------------------------------------------
+// ---------------------- Serial -----------------------
+// -----------------------------------------------------
+
+HardwareSerial Serial(0);
+static std::mutex consoleMutex;
+
+size_t Print::printf(const char* format, ...) {
+    char stackBuf[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(stackBuf, sizeof(stackBuf), format, args);
+    va_end(args);
+    if (length < 0) return 0;
+    if ((size_t)length < sizeof(stackBuf)) return write((const uint8_t*)stackBuf, length);
+
+    std::string heapBuf(length + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&heapBuf[0], heapBuf.size(), format, args);
+    va_end(args);
+    return write((const uint8_t*)heapBuf.data(), length);
+}
+
+int HardwareSerial::available() {
+    return _uart == 0 ? 0 : simGpsAvailable(_rxBufferSize);
+}
+
+void HardwareSerial::onReceive(OnReceiveCb function, bool onlyOnTimeout) {
+    (void)onlyOnTimeout; // Every epoch is one burst
+    if (_uart == 0) return;
+    _onReceive = function;
+    simGpsOnReceive(_rxBufferSize, [this]() { if (_onReceive) _onReceive(); },
+                    [this]() { if (_onReceiveError) _onReceiveError(UART_BUFFER_FULL_ERROR); });
+}
+
+int HardwareSerial::read() {
+    return _uart == 0 ? -1 : simGpsRead(_rxBufferSize);
+}
+
+int HardwareSerial::peek() {
+    return _uart == 0 ? -1 : simGpsPeek(_rxBufferSize);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    if (_uart != 0) {
+        // Commands to the GPS receiver, one per line
+        for (size_t i = 0; i < size; ++i) {
+            if (buffer[i] == '\n') {
+                simGpsCommand(_txLine);
+                _txLine.clear();
+            } else if (buffer[i] != '\r') {
+                _txLine += (char)buffer[i];
+            }
+        }
+        return size;
+    }
+    if (simConfig.quiet) return size;
+    std::lock_guard<std::mutex> lock(consoleMutex);
+    return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush() {
+    if (_uart != 0) return;
+    std::lock_guard<std::mutex> lock(consoleMutex);
+    fflush(stdout);
+}
+
+// -----------------------------------------------------
+// ------------------------ Sleep ----------------------
+// -----------------------------------------------------
+
+void esp_deep_sleep_start() {
+    simFinish("deep sleep");
+}
@@ -0,0 +1,219 @@
+// SD/FS over a host directory (see hal/FS.h). Writes, flushes and opens are counted in simStats.
+#include "SD.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace fs {
+
+struct FileImpl {
+    FILE* f = nullptr;
+    std::string path; // Path on the card
+    std::string name;
+    bool writable = false;
+    bool dir = false;
+    std::vector<std::string> entries;
+    size_t nextEntry = 0;
+
+    ~FileImpl() {
+        if (f) fclose(f);
+    }
+};
+
+static std::string hostPath(const char* path) {
+    std::string p = path ? path : "";
+    if (p.empty() || p[0] != '/') p = "/" + p;
+    return simConfig.sdRoot + p;
+}
+
+// -----------------------------------------------------
+// ----------------------- File ------------------------
+// -----------------------------------------------------
+
+File::operator bool() const {
+    return _impl && (_impl->f || _impl->dir);
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+    if (!_impl || !_impl->f || !_impl->writable) return 0;
+    size_t n = fwrite(buffer, 1, size, _impl->f);
+    simStats.sdBytesWritten += n;
+    return n;
+}
+
+int File::available() {
+    if (!_impl || !_impl->f) return 0;
+    size_t pos = position();
+    size_t total = size();
+    return total > pos ? (int)(total - pos) : 0;
+}
+
+int File::read() {
+    if (!_impl || !_impl->f) return -1;
+    int c = fgetc(_impl->f);
+    return c == EOF ? -1 : c;
+}
+
+int File::peek() {
+    if (!_impl || !_impl->f) return -1;
+    int c = fgetc(_impl->f);
+    if (c == EOF) return -1;
+    ungetc(c, _impl->f);
+    return c;
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+    if (!_impl || !_impl->f) return 0;
+    return fread(buffer, 1, size, _impl->f);
+}
+
+void File::flush() {
+    if (!_impl || !_impl->f || !_impl->writable) return;
+    fflush(_impl->f);
+    simStats.sdFlushes++;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!_impl || !_impl->f) return false;
+    int whence = mode == SeekCur ? SEEK_CUR : (mode == SeekEnd ? SEEK_END : SEEK_SET);
+    return fseek(_impl->f, (long)pos, whence) == 0;
+}
+
+size_t File::position() const {
+    if (!_impl || !_impl->f) return 0;
+    long pos = ftell(_impl->f);
+    return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t File::size() const {
+    if (!_impl || !_impl->f) return 0;
+    if (_impl->writable) fflush(_impl->f); // Size includes buffered bytes, like the ESP32 VFS
+    struct stat st;
+    return fstat(fileno(_impl->f), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+void File::close() {
+    _impl.reset();
+}
+
+const char* File::path() const {
+    return _impl ? _impl->path.c_str() : nullptr;
+}
+
+const char* File::name() const {
+    return _impl ? _impl->name.c_str() : nullptr;
+}
+
+bool File::isDirectory() const {
+    return _impl && _impl->dir;
+}
+
+File File::openNextFile(const char* mode) {
+    if (!_impl || !_impl->dir || _impl->nextEntry >= _impl->entries.size()) return File();
+    std::string base = _impl->path == "/" ? "" : _impl->path;
+    std::string child = base + "/" + _impl->entries[_impl->nextEntry++];
+    return SD.open(child.c_str(), mode);
+}
+
+void File::rewindDirectory() {
+    if (_impl) _impl->nextEntry = 0;
+}
+
+// -----------------------------------------------------
+// ------------------------ FS -------------------------
+// -----------------------------------------------------
+
+File FS::open(const char* path, const char* mode, bool create) {
+    (void)create;
+    auto impl = std::make_shared<FileImpl>();
+    impl->path = path && path[0] == '/' ? path : std::string("/") + (path ? path : "");
+    size_t slash = impl->path.rfind('/');
+    impl->name = impl->path.substr(slash + 1);
+
+    std::string host = hostPath(path);
+    struct stat st;
+    if (stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        DIR* d = opendir(host.c_str());
+        if (!d) return File();
+        while (struct dirent* e = readdir(d)) {
+            std::string n = e->d_name;
+            if (n != "." && n != "..") impl->entries.push_back(n);
+        }
+        closedir(d);
+        impl->dir = true;
+        return File(impl);
+    }
+
+    std::string m = mode ? mode : FILE_READ;
+    const char* hostMode = "rb";
+    if (m == FILE_WRITE) hostMode = "w+b";
+    else if (m == FILE_APPEND) hostMode = "a+b";
+    else if (m == "r+") hostMode = "r+b";
+    impl->writable = m != FILE_READ;
+
+    impl->f = fopen(host.c_str(), hostMode);
+    if (!impl->f) return File();
+    simStats.sdOpens++;
+    return File(impl);
+}
+
+bool FS::exists(const char* path) {
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) {
+    return ::unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char* from, const char* to) {
+    return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+    return ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
+
+bool FS::rmdir(const char* path) {
+    return ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+// -----------------------------------------------------
+// ----------------------- SDFS ------------------------
+// -----------------------------------------------------
+
+bool SDFS::begin(uint8_t ssPin, SPIClass &spi, uint32_t frequency, const char* mountpoint, uint8_t maxFiles,
+                 bool formatIfEmpty) {
+    (void)ssPin; (void)spi; (void)frequency; (void)mountpoint; (void)maxFiles; (void)formatIfEmpty;
+    ::mkdir(simConfig.sdRoot.c_str(), 0755);
+    struct stat st;
+    _mounted = stat(simConfig.sdRoot.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    return _mounted;
+}
+
+void SDFS::end() {
+    _mounted = false;
+}
+
+sdcard_type_t SDFS::cardType() {
+    return _mounted ? CARD_SDHC : CARD_NONE;
+}
+
+uint64_t SDFS::cardSize() {
+    return 32ULL << 30;
+}
+
+uint64_t SDFS::totalBytes() {
+    return cardSize();
+}
+
+uint64_t SDFS::usedBytes() {
+    return 0;
+}
+
+} // namespace fs
+
+fs::SDFS SD;
+SPIClass SPI;
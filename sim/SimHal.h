@@ -0,0 +1,80 @@
+#pragma once
+// Host simulation runtime shared by the HAL headers in sim/hal: accelerated virtual clock,
+// run configuration and counters. Nothing in here exists on the device.
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+
+struct SimConfig {
+    double speed = 1000.0;                          // Virtual ms per real ms
+    uint64_t durationMs = 7ULL * 24 * 3600 * 1000;  // Virtual run time
+    uint64_t reportMs = 3600ULL * 1000;             // Virtual time between report lines
+    uint64_t startUnixMs = 0;                       // Virtual UTC at start (0 = host time)
+    std::string sdRoot = "sim_sd";                  // Host directory standing in for the SD card
+    std::string nmeaFile;                           // Recorded NMEA (empty = synthetic track)
+    std::string canFile;                            // candump log (empty = silent bus)
+    std::string brokerHost = "127.0.0.1";           // Every MQTT connection goes to this broker
+    int brokerPort = 1883;
+    uint64_t outagePeriodMs = 0;                    // Wi-Fi drops every period (0 = never)...
+    uint64_t outageLengthMs = 0;                    // ...for this long
+    int ppsPin = 32;                                // GPIO the receiver's PPS drives (-1 = none)
+    uint64_t ppsLossPeriodMs = 0;                   // PPS lost every period (0 = never)...
+    uint64_t ppsLossLengthMs = 0;                   // ...for this long
+    double driftPpm = 0;                            // Device oscillator error (millis, micros, esp_timer)
+    bool quiet = false;                             // Drop firmware Serial output
+};
+
+struct SimStats {
+    std::atomic<uint64_t> sdBytesWritten{0};
+    std::atomic<uint64_t> sdFlushes{0};
+    std::atomic<uint64_t> sdOpens{0};
+    std::atomic<uint64_t> netBytesOut{0};
+    std::atomic<uint64_t> netBytesIn{0};
+    std::atomic<uint64_t> telemetryPublishes{0};
+    std::atomic<uint64_t> telemetryBytes{0};        // Payload bytes
+    std::atomic<uint64_t> attributeRequests{0};     // Incl. ack markers
+    std::atomic<uint64_t> mqttConnects{0};
+    std::atomic<uint64_t> gpsBytesDropped{0};       // UART RX buffer overflow
+    std::atomic<uint64_t> canFramesDropped{0};      // TWAI RX queue overflow
+};
+
+extern SimConfig simConfig;
+extern SimStats simStats;
+
+// ---------------- Virtual clock ----------------
+// Virtual time runs simConfig.speed times faster than the host clock. Sleeps and RTOS
+// timeouts are scaled, so firmware delays keep their meaning relative to each other.
+void simClockStart();
+uint64_t simMicros64(); // Virtual µs since simClockStart()
+inline uint64_t simMillis64() { return simMicros64() / 1000; }
+uint64_t simUnixMsAt(uint64_t virtualMs); // Virtual UTC at a virtual time
+inline uint64_t simUnixMs() { return simUnixMsAt(simMillis64()); }
+uint64_t simLocalMicros64(); // Virtual µs as counted by the device oscillator (--drift-ppm)
+void simRunIsr(uint64_t edgeUs, void (*isr)()); // Runs an ISR with the clock held at the virtual edge time
+std::chrono::steady_clock::time_point simRealTime(uint64_t virtualUs); // Host deadline of a virtual time
+void simSleepUntilUs(uint64_t virtualUs);
+void simSleepMs(uint32_t virtualMs);
+
+// ---------------- Environment ----------------
+bool simWifiUp(); // False during scheduled outages
+void simAddAccessPoint(const char* ssid, int rssi); // Visible to WiFi.scanNetworks()
+void simOnGotIp(); // Station got an address (starts SNTP time after configTime())
+
+// GPS receiver behind UART1+ (sim/SimSources.cpp): NMEA epochs are released once per
+// virtual second into an RX buffer of 'rxBufferSize' bytes
+int simGpsAvailable(size_t rxBufferSize);
+int simGpsRead(size_t rxBufferSize);
+int simGpsPeek(size_t rxBufferSize);
+std::string simNmeaEpoch(uint64_t epoch); // Sentences of one epoch (recorded log or synthetic track)
+void simGpsFeed(const char* data, size_t length); // Queues bytes directly and stops the epoch clock (benchmarks)
+void simGpsCommand(const std::string &line); // Receiver command from the firmware (PAIR050 fix interval, PAIR062 sentence types)
+// Starts the UART event task: releases each epoch when due, then calls onData (and onOverflow first if bytes were dropped)
+void simGpsOnReceive(size_t rxBufferSize, std::function<void()> onData, std::function<void()> onOverflow);
+
+// PPS: the GPS receiver drives simConfig.ppsPin with one rising edge per UTC second (outside --pps-loss)
+void simAttachInterrupt(uint8_t pin, void (*isr)(), int mode);
+
+[[noreturn]] void simFinish(const char* reason); // Print the summary and exit (sim/sim_main.cpp)
@@ -0,0 +1,347 @@
+// Wi-Fi station, event loop and TCP client of the host simulation (see hal/WiFi.h)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "WiFi.h"
+
+esp_event_base_t const WIFI_EVENT = "WIFI_EVENT";
+esp_event_base_t const IP_EVENT = "IP_EVENT";
+
+WiFiClass WiFi;
+
+struct SimAccessPoint {
+    std::string ssid;
+    int rssi;
+};
+
+struct SimHandler {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void* arg;
+};
+
+#define STATION_POLL_MS 100     // Event task period (virtual)
+#define STATION_ASSOCIATE_MS 1500 // WiFi.begin() to WL_CONNECTED (virtual)
+
+static std::mutex stationMutex;
+static std::vector<SimAccessPoint> accessPoints;
+static std::vector<SimAccessPoint> scanResults;
+static std::vector<SimHandler> handlers;
+static bool staStartPending = false;
+static std::string joinSsid;     // Set by WiFi.begin(), cleared by disconnect() or a lost link
+static uint64_t associateAtMs = 0;
+static bool linkUp = false;
+static bool eventLoopStarted = false;
+
+void simAddAccessPoint(const char* ssid, int rssi) {
+    std::lock_guard<std::mutex> lock(stationMutex);
+    accessPoints.push_back({ssid, rssi});
+}
+
+static int findAccessPoint(const std::string &ssid) {
+    for (size_t i = 0; i < accessPoints.size(); ++i) {
+        if (accessPoints[i].ssid == ssid) return (int)i;
+    }
+    return -1;
+}
+
+// -----------------------------------------------------
+// -------------------- Event loop ---------------------
+// -----------------------------------------------------
+
+static void postEvent(esp_event_base_t base, int32_t id, void* data) {
+    std::vector<SimHandler> targets;
+    {
+        std::lock_guard<std::mutex> lock(stationMutex);
+        targets = handlers;
+    }
+    for (auto &h : targets) {
+        if (h.base == base && (h.id == ESP_EVENT_ANY_ID || h.id == id)) h.handler(h.arg, base, id, data);
+    }
+}
+
+// Station state machine, stepped by the event task
+static void stationStep() {
+    bool start = false;
+    bool connected = false;
+    bool lost = false;
+    {
+        std::lock_guard<std::mutex> lock(stationMutex);
+        start = staStartPending;
+        staStartPending = false;
+
+        bool reachable = !joinSsid.empty() && findAccessPoint(joinSsid) >= 0 && simWifiUp();
+        if (!linkUp && reachable && simMillis64() >= associateAtMs) {
+            linkUp = true;
+            connected = true;
+        } else if (linkUp && !reachable) {
+            linkUp = false;
+            joinSsid.clear(); // The firmware reconnects through WiFiManager
+            lost = true;
+        }
+    }
+
+    if (start) postEvent(WIFI_EVENT, WIFI_EVENT_STA_START, nullptr);
+    if (connected) {
+        postEvent(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED, nullptr);
+        simOnGotIp();
+        ip_event_got_ip_t gotIp = {};
+        gotIp.ip_info.ip = (uint32_t)WiFi.localIP();
+        postEvent(IP_EVENT, IP_EVENT_STA_GOT_IP, &gotIp);
+    }
+    if (lost) postEvent(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, nullptr);
+}
+
+esp_err_t esp_event_loop_create_default() {
+    {
+        std::lock_guard<std::mutex> lock(stationMutex);
+        if (eventLoopStarted) return ESP_ERR_INVALID_STATE;
+        eventLoopStarted = true;
+    }
+    xTaskCreate([](void*) {
+        for (;;) {
+            stationStep();
+            vTaskDelay(pdMS_TO_TICKS(STATION_POLL_MS));
+        }
+    }, "sys_evt", 4096, nullptr, 20, nullptr);
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t base, int32_t id, esp_event_handler_t handler,
+                                              void* arg, esp_event_handler_instance_t* instance) {
+    std::lock_guard<std::mutex> lock(stationMutex);
+    handlers.push_back({base, id, handler, arg});
+    if (instance) *instance = (void*)handler;
+    return ESP_OK;
+}
+
+// -----------------------------------------------------
+// ---------------------- Station ----------------------
+// -----------------------------------------------------
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+    std::lock_guard<std::mutex> lock(stationMutex);
+    if (mode == WIFI_STA || mode == WIFI_AP_STA) staStartPending = true;
+    return true;
+}
+
+int16_t WiFiClass::scanNetworks(bool async, bool showHidden) {
+    (void)async; (void)showHidden;
+    delay(2000); // Active scan of all channels
+    std::lock_guard<std::mutex> lock(stationMutex);
+    scanResults.clear();
+    if (simWifiUp()) scanResults = accessPoints;
+    return (int16_t)scanResults.size();
+}
+
+String WiFiClass::SSID(uint8_t i) const {
+    std::lock_guard<std::mutex> lock(stationMutex);
+    return i < scanResults.size() ? String(scanResults[i].ssid) : String();
+}
+
+int32_t WiFiClass::RSSI(uint8_t i) const {
+    std::lock_guard<std::mutex> lock(stationMutex);
+    return i < scanResults.size() ? scanResults[i].rssi : 0;
+}
+
+String WiFiClass::SSID() const {
+    std::lock_guard<std::mutex> lock(stationMutex);
+    return linkUp ? String(joinSsid) : String();
+}
+
+int8_t WiFiClass::RSSI() {
+    std::lock_guard<std::mutex> lock(stationMutex);
+    int i = linkUp ? findAccessPoint(joinSsid) : -1;
+    return i >= 0 ? (int8_t)accessPoints[i].rssi : 0;
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase) {
+    (void)passphrase;
+    std::lock_guard<std::mutex> lock(stationMutex);
+    joinSsid = ssid ? ssid : "";
+    associateAtMs = simMillis64() + STATION_ASSOCIATE_MS;
+    linkUp = false;
+    return WL_DISCONNECTED;
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+    (void)wifiOff; (void)eraseAp;
+    std::lock_guard<std::mutex> lock(stationMutex);
+    joinSsid.clear();
+    linkUp = false;
+    return true;
+}
+
+wl_status_t WiFiClass::status() {
+    std::lock_guard<std::mutex> lock(stationMutex);
+    return linkUp ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+IPAddress WiFiClass::localIP() {
+    return status() == WL_CONNECTED ? IPAddress(192, 168, 4, 2) : IPAddress();
+}
+
+// -----------------------------------------------------
+// --------------------- WiFiClient --------------------
+// -----------------------------------------------------
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+    (void)ip;
+    return connect("", port);
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+    (void)host; (void)port;
+    stop();
+    if (WiFi.status() != WL_CONNECTED) return 0;
+
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    std::string brokerPort = std::to_string(simConfig.brokerPort);
+    if (getaddrinfo(simConfig.brokerHost.c_str(), brokerPort.c_str(), &hints, &result) != 0) return 0;
+
+    int fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (fd >= 0 && ::connect(fd, result->ai_addr, result->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    if (fd < 0) return 0;
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    _fd = fd;
+    _rx.clear();
+    _rxPos = 0;
+    _tap.clear();
+    return 1;
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+    if (!connected()) return 0;
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t n = send(_fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            pollfd p = {_fd, POLLOUT, 0};
+            poll(&p, 1, 100);
+        } else {
+            stop();
+            break;
+        }
+    }
+    simStats.netBytesOut += sent;
+    tapMqtt(buffer, sent);
+    return sent;
+}
+
+bool WiFiClient::fill() {
+    if (_fd < 0) return false;
+    if (_rxPos == _rx.size()) {
+        _rx.clear();
+        _rxPos = 0;
+    }
+    uint8_t buf[2048];
+    ssize_t n = recv(_fd, buf, sizeof(buf), 0);
+    if (n > 0) {
+        _rx.insert(_rx.end(), buf, buf + n);
+        simStats.netBytesIn += n;
+        return true;
+    }
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+        close(_fd); // Peer closed: buffered bytes stay readable
+        _fd = -1;
+    }
+    return false;
+}
+
+int WiFiClient::available() {
+    if (WiFi.status() != WL_CONNECTED) stop();
+    fill();
+    return (int)(_rx.size() - _rxPos);
+}
+
+int WiFiClient::read() {
+    if (_rxPos == _rx.size() && !fill()) return -1;
+    return _rxPos < _rx.size() ? _rx[_rxPos++] : -1;
+}
+
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+    if (_rxPos == _rx.size()) fill();
+    size_t n = std::min(size, _rx.size() - _rxPos);
+    memcpy(buffer, _rx.data() + _rxPos, n);
+    _rxPos += n;
+    return n ? (int)n : -1;
+}
+
+int WiFiClient::peek() {
+    if (_rxPos == _rx.size() && !fill()) return -1;
+    return _rxPos < _rx.size() ? _rx[_rxPos] : -1;
+}
+
+void WiFiClient::stop() {
+    if (_fd >= 0) close(_fd);
+    _fd = -1;
+    _rx.clear();
+    _rxPos = 0;
+}
+
+uint8_t WiFiClient::connected() {
+    if (_fd >= 0 && WiFi.status() != WL_CONNECTED) stop(); // Link lost: the TCP session is gone
+    return _fd >= 0 || _rxPos < _rx.size();
+}
+
+// Counts MQTT packets on the way out (CONNECT, telemetry and attribute request PUBLISHes)
+void WiFiClient::tapMqtt(const uint8_t* buffer, size_t size) {
+    _tap.append((const char*)buffer, size);
+
+    for (;;) {
+        // Fixed header: type/flags byte and a variable-length "remaining length"
+        size_t pos = 1;
+        uint32_t remaining = 0;
+        int shift = 0;
+        bool complete = false;
+        while (pos < _tap.size() && pos <= 4) {
+            uint8_t b = (uint8_t)_tap[pos++];
+            remaining |= (uint32_t)(b & 0x7F) << shift;
+            shift += 7;
+            if (!(b & 0x80)) {
+                complete = true;
+                break;
+            }
+        }
+        if (!complete || _tap.size() < pos + remaining) return;
+
+        uint8_t type = (uint8_t)_tap[0] >> 4;
+        if (type == 1) {
+            simStats.mqttConnects++;
+        } else if (type == 3 && remaining >= 2) {
+            size_t topicLength = ((uint8_t)_tap[pos] << 8) | (uint8_t)_tap[pos + 1];
+            std::string topic = _tap.substr(pos + 2, topicLength);
+            size_t header = 2 + topicLength + (((uint8_t)_tap[0] & 0x06) ? 2 : 0); // Packet id for QoS > 0
+            if (topic == "v1/devices/me/telemetry") {
+                simStats.telemetryPublishes++;
+                simStats.telemetryBytes += remaining > header ? remaining - header : 0;
+            } else if (topic.rfind("v1/devices/me/attributes/request/", 0) == 0) {
+                simStats.attributeRequests++;
+            }
+        }
+        _tap.erase(0, pos + remaining);
+    }
+}
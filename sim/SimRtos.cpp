@@ -0,0 +1,273 @@
+// FreeRTOS subset on std::thread (see hal/freertos/FreeRTOS.h)
+#include "freertos/FreeRTOS.h"
+#include "SimHal.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <string.h>
+
+struct SimTask {
+    std::string name;
+    std::mutex m;
+    std::condition_variable cv;
+    uint32_t notifications = 0;
+};
+
+struct SimQueue {
+    std::mutex m;
+    std::condition_variable cv;
+    std::vector<uint8_t> storage;
+    size_t length;
+    size_t itemSize;
+    size_t head = 0;
+    size_t count = 0;
+};
+
+struct SimEventGroup {
+    std::mutex m;
+    std::condition_variable cv;
+    EventBits_t bits = 0;
+};
+
+static thread_local SimTask* currentTask = nullptr;
+
+// Waits on 'cv' until 'ready' or the virtual timeout passes
+template <typename Pred>
+static bool waitFor(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, TickType_t ticks, Pred ready) {
+    if (ticks == portMAX_DELAY) {
+        cv.wait(lock, ready);
+        return true;
+    }
+    return cv.wait_until(lock, simRealTime(simMicros64() + (uint64_t)ticks * 1000), ready);
+}
+
+// -----------------------------------------------------
+// ---------------------- Tasks ------------------------
+// -----------------------------------------------------
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* param,
+                       UBaseType_t priority, TaskHandle_t* created) {
+    (void)stackDepth;
+    (void)priority;
+    SimTask* task = new SimTask();
+    task->name = name ? name : "";
+    if (created) *created = task;
+
+    std::thread([task, fn, param]() {
+        currentTask = task;
+        fn(param);
+        vTaskDelete(nullptr); // FreeRTOS tasks must not return
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* param,
+                                   UBaseType_t priority, TaskHandle_t* created, BaseType_t core) {
+    (void)core;
+    return xTaskCreate(fn, name, stackDepth, param, priority, created);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    // Threads cannot be killed from outside; a task deleting itself just stops running
+    if (task || !currentTask) return;
+    for (;;) std::this_thread::sleep_for(std::chrono::hours(1));
+}
+
+void vTaskDelay(TickType_t ticks) {
+    simSleepMs(ticks);
+}
+
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t increment) {
+    *previousWake += increment;
+    simSleepUntilUs((uint64_t)*previousWake * 1000);
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)simMillis64();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return currentTask;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    (void)task;
+    return 0; // Host stacks are not measured
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    if (!task) return pdFAIL;
+    {
+        std::lock_guard<std::mutex> lock(task->m);
+        task->notifications++;
+    }
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+    if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+    xTaskNotifyGive(task);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    SimTask* task = currentTask;
+    if (!task) {
+        simSleepMs(ticks == portMAX_DELAY ? 0 : ticks);
+        return 0;
+    }
+
+    std::unique_lock<std::mutex> lock(task->m);
+    waitFor(task->cv, lock, ticks, [task] { return task->notifications > 0; });
+    uint32_t value = task->notifications;
+    if (value) task->notifications = clearOnExit ? 0 : value - 1;
+    return value;
+}
+
+// -----------------------------------------------------
+// ----------------- Queues / Semaphores ---------------
+// -----------------------------------------------------
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    if (length == 0) return nullptr;
+    SimQueue* queue = new SimQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    queue->storage.resize((size_t)length * itemSize);
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+static BaseType_t queuePut(QueueHandle_t queue, const void* item, TickType_t ticks, bool front) {
+    if (!queue) return pdFAIL;
+    std::unique_lock<std::mutex> lock(queue->m);
+    if (!waitFor(queue->cv, lock, ticks, [queue] { return queue->count < queue->length; })) return pdFAIL;
+
+    size_t slot;
+    if (front) {
+        queue->head = (queue->head + queue->length - 1) % queue->length;
+        slot = queue->head;
+    } else {
+        slot = (queue->head + queue->count) % queue->length;
+    }
+    if (queue->itemSize && item) memcpy(&queue->storage[slot * queue->itemSize], item, queue->itemSize);
+    queue->count++;
+    lock.unlock();
+    queue->cv.notify_all();
+    return pdPASS;
+}
+
+static BaseType_t queueGet(QueueHandle_t queue, void* item, TickType_t ticks, bool remove) {
+    if (!queue) return pdFAIL;
+    std::unique_lock<std::mutex> lock(queue->m);
+    if (!waitFor(queue->cv, lock, ticks, [queue] { return queue->count > 0; })) return pdFAIL;
+
+    if (queue->itemSize && item) memcpy(item, &queue->storage[queue->head * queue->itemSize], queue->itemSize);
+    if (remove) {
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+    }
+    lock.unlock();
+    queue->cv.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    return queuePut(queue, item, ticks, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    return queuePut(queue, item, ticks, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    return queueGet(queue, item, ticks, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t ticks) {
+    return queueGet(queue, item, ticks, false);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    if (!queue) return pdFAIL;
+    {
+        std::lock_guard<std::mutex> lock(queue->m);
+        queue->head = 0;
+        queue->count = 0;
+    }
+    queue->cv.notify_all();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    if (!queue) return 0;
+    std::lock_guard<std::mutex> lock(queue->m);
+    return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    if (!queue) return 0;
+    std::lock_guard<std::mutex> lock(queue->m);
+    return queue->length - queue->count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    SemaphoreHandle_t sem = xQueueCreate(maxCount, 0);
+    if (sem) sem->count = initialCount;
+    return sem;
+}
+
+// -----------------------------------------------------
+// ------------------- Event Groups --------------------
+// -----------------------------------------------------
+
+EventGroupHandle_t xEventGroupCreate() {
+    return new SimEventGroup();
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    EventBits_t value;
+    {
+        std::lock_guard<std::mutex> lock(group->m);
+        group->bits |= bits;
+        value = group->bits;
+    }
+    group->cv.notify_all();
+    return value;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->m);
+    EventBits_t value = group->bits;
+    group->bits &= ~bits;
+    return value;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    std::lock_guard<std::mutex> lock(group->m);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clearOnExit,
+                                BaseType_t waitForAll, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(group->m);
+    auto ready = [&] { return waitForAll ? (group->bits & bits) == bits : (group->bits & bits) != 0; };
+    bool met = waitFor(group->cv, lock, ticks, ready);
+    EventBits_t value = group->bits;
+    if (met && clearOnExit) group->bits &= ~bits;
+    return value;
+}
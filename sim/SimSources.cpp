@@ -0,0 +1,453 @@
+// Simulated peripherals fed on the virtual clock: GPS receiver (NMEA, PPS) and CAN bus (TWAI)
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#include "Arduino.h"
+#include "driver/twai.h"
+
+// -----------------------------------------------------
+// ------------------------ GPS ------------------------
+// -----------------------------------------------------
+// One epoch (GGA + RMC) per fix interval of UTC on the virtual clock (1 s, PAIR050 changes it).
+// A recorded log is replayed epoch by epoch with time and date rewritten to virtual UTC; otherwise
+// the receiver drives a 500 m circle at 36 km/h. PAIR062 turns sentence types on and off.
+
+#define GPS_EPOCH_MS 1000       // Default fix interval
+#define GPS_EPOCH_DELAY_MS 100  // Output starts this long after the interval boundary
+#define GPS_MAX_BACKFILL 4      // Epochs generated when the reader was away for longer
+#define GPS_EVENT_POLL_MS 50    // Longest sleep of the UART event task (picks up interval changes)
+
+static std::mutex gpsMutex;
+static std::deque<uint8_t> gpsRx;
+static uint32_t gpsIntervalMs = GPS_EPOCH_MS;
+static uint64_t gpsNextDueMs = 0; // Virtual time the next epoch is released (0 = not started)
+static uint64_t gpsEpochCount = 0; // Epochs released (index into the log)
+static bool gpsTypeOn[6] = {true, true, true, true, true, true}; // GGA, GLL, GSA, GSV, RMC, VTG (PAIR062 order)
+static std::vector<std::vector<std::string>> gpsLog; // Recorded epochs (empty = synthetic)
+static bool gpsLogLoaded = false;
+static bool gpsFed = false; // simGpsFeed() replaced the epoch clock
+static bool gpsOverflow = false; // Bytes dropped since the last UART event
+static size_t gpsEventBufferSize = 0;
+static std::function<void()> gpsOnData;
+static std::function<void()> gpsOnOverflow;
+
+static void nmeaAppend(std::string &out, const std::string &body) {
+    uint8_t sum = 0;
+    for (char c : body) sum ^= (uint8_t)c;
+    char tail[8];
+    snprintf(tail, sizeof(tail), "*%02X\r\n", sum);
+    out += "$" + body + tail;
+}
+
+static std::string nmeaCoord(double deg, bool lat) {
+    double a = fabs(deg);
+    int whole = (int)a;
+    char buf[24];
+    snprintf(buf, sizeof(buf), lat ? "%02d%08.5f,%c" : "%03d%08.5f,%c", whole, (a - whole) * 60.0,
+             lat ? (deg >= 0 ? 'N' : 'S') : (deg >= 0 ? 'E' : 'W'));
+    return buf;
+}
+
+static void loadGpsLog() {
+    gpsLogLoaded = true;
+    if (simConfig.nmeaFile.empty()) return;
+    std::ifstream in(simConfig.nmeaFile);
+    if (!in) {
+        fprintf(stderr, "[SIM] Cannot open NMEA log %s, using synthetic track\n", simConfig.nmeaFile.c_str());
+        return;
+    }
+
+    // A new epoch starts whenever the UTC field of GGA/RMC changes
+    std::string line, epochTime;
+    while (std::getline(in, line)) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == '\n')) line.pop_back();
+        size_t star = line.find('*');
+        if (line.size() < 7 || line[0] != '$' || star == std::string::npos) continue;
+        std::string body = line.substr(1, star - 1);
+        std::string type = body.substr(2, 3);
+        if (type == "GGA" || type == "RMC") {
+            size_t comma = body.find(',');
+            std::string t = body.substr(comma + 1, body.find(',', comma + 1) - comma - 1);
+            if (gpsLog.empty() || t != epochTime) gpsLog.emplace_back();
+            epochTime = t;
+        }
+        if (!gpsLog.empty()) gpsLog.back().push_back(body);
+    }
+    fprintf(stderr, "[SIM] NMEA log: %zu epochs\n", gpsLog.size());
+}
+
+// Replaces field 'index' of a comma separated sentence body
+static void setField(std::string &body, int index, const std::string &value) {
+    size_t start = 0;
+    for (int i = 0; i < index; ++i) {
+        start = body.find(',', start);
+        if (start == std::string::npos) return;
+        start++;
+    }
+    size_t end = body.find(',', start);
+    body.replace(start, (end == std::string::npos ? body.size() : end) - start, value);
+}
+
+// Epoch k of simNmeaEpoch() is the k-th whole UTC second after the simulation started
+static uint64_t gpsFirstSecond() {
+    return (simUnixMsAt(0) + 999) / 1000;
+}
+
+static bool gpsTypeEnabled(const std::string &type) {
+    static const char* types[6] = {"GGA", "GLL", "GSA", "GSV", "RMC", "VTG"};
+    for (int i = 0; i < 6; ++i) {
+        if (type == types[i]) return gpsTypeOn[i];
+    }
+    return true;
+}
+
+// Sentences of epoch 'epoch' with fix time 'fixUnixMs'
+static std::string gpsEpoch(uint64_t epoch, uint64_t fixUnixMs) {
+    time_t utc = (time_t)(fixUnixMs / 1000);
+    struct tm t;
+    gmtime_r(&utc, &t);
+    char hms[48], dmy[36]; // Sized for any int (-Wformat-truncation)
+    snprintf(hms, sizeof(hms), "%02d%02d%02d.%02d", t.tm_hour, t.tm_min, t.tm_sec, (int)(fixUnixMs % 1000 / 10));
+    snprintf(dmy, sizeof(dmy), "%02d%02d%02d", t.tm_mday, t.tm_mon + 1, t.tm_year % 100);
+
+    std::string out;
+    if (!gpsLog.empty()) {
+        for (std::string body : gpsLog[epoch % gpsLog.size()]) {
+            std::string type = body.substr(2, 3);
+            if (!gpsTypeEnabled(type)) continue;
+            if (type == "GGA" || type == "RMC") setField(body, 1, hms);
+            if (type == "RMC") setField(body, 9, dmy);
+            nmeaAppend(out, body);
+        }
+        return out;
+    }
+
+    const double centerLat = 52.2297, centerLon = 21.0122, radiusM = 500.0, speedMs = 10.0;
+    double elapsed = (double)(fixUnixMs - gpsFirstSecond() * 1000) / 1000.0;
+    double angle = fmod(elapsed * speedMs / radiusM, TWO_PI);
+    double lat = centerLat + radiusM * sin(angle) / 111320.0;
+    double lon = centerLon + radiusM * cos(angle) / (111320.0 * cos(radians(centerLat)));
+    double course = fmod(360.0 - degrees(angle), 360.0);
+    char buf[160];
+    if (gpsTypeOn[0]) {
+        snprintf(buf, sizeof(buf), "GPGGA,%s,%s,%s,1,09,0.9,112.0,M,33.9,M,,", hms, nmeaCoord(lat, true).c_str(),
+                 nmeaCoord(lon, false).c_str());
+        nmeaAppend(out, buf);
+    }
+    if (gpsTypeOn[4]) {
+        snprintf(buf, sizeof(buf), "GPRMC,%s,A,%s,%s,%.2f,%.1f,%s,,,A", hms, nmeaCoord(lat, true).c_str(),
+                 nmeaCoord(lon, false).c_str(), speedMs * 1.943844, course, dmy);
+        nmeaAppend(out, buf);
+    }
+    return out;
+}
+
+// Virtual time (ms) the first epoch at or after virtual 'afterMs' is released: the next UTC multiple
+// of the fix interval plus the output delay
+static uint64_t gpsNextBoundaryMs(uint64_t afterMs) {
+    uint64_t unix0 = simUnixMsAt(0);
+    uint64_t boundary = (unix0 + afterMs + gpsIntervalMs - 1) / gpsIntervalMs * gpsIntervalMs;
+    return boundary - unix0 + GPS_EPOCH_DELAY_MS;
+}
+
+// Releases the epochs due by now into the RX buffer (caller holds gpsMutex)
+static void gpsPump(size_t rxBufferSize) {
+    if (gpsFed) return;
+    if (!gpsLogLoaded) loadGpsLog();
+    if (!gpsNextDueMs) gpsNextDueMs = gpsNextBoundaryMs(0);
+    uint64_t now = simMillis64();
+    if (now < gpsNextDueMs) return;
+
+    uint64_t due = (now - gpsNextDueMs) / gpsIntervalMs + 1; // Epochs due by now
+    if (due > GPS_MAX_BACKFILL) {
+        // Nobody read for a while: the skipped epochs overflowed the buffer anyway
+        uint64_t skipped = due - GPS_MAX_BACKFILL;
+        simStats.gpsBytesDropped += skipped * gpsEpoch(gpsEpochCount, simUnixMsAt(gpsNextDueMs - GPS_EPOCH_DELAY_MS)).size();
+        gpsEpochCount += skipped;
+        gpsNextDueMs += skipped * gpsIntervalMs;
+        gpsOverflow = true;
+    }
+    for (; gpsNextDueMs <= now; gpsNextDueMs += gpsIntervalMs) {
+        std::string text = gpsEpoch(gpsEpochCount++, simUnixMsAt(gpsNextDueMs - GPS_EPOCH_DELAY_MS));
+        size_t room = gpsRx.size() < rxBufferSize ? rxBufferSize - gpsRx.size() : 0;
+        size_t n = std::min(room, text.size());
+        gpsRx.insert(gpsRx.end(), text.begin(), text.begin() + n);
+        simStats.gpsBytesDropped += text.size() - n;
+        if (n < text.size()) gpsOverflow = true;
+    }
+}
+
+std::string simNmeaEpoch(uint64_t epoch) {
+    std::lock_guard<std::mutex> lock(gpsMutex);
+    if (!gpsLogLoaded) loadGpsLog();
+    return gpsEpoch(epoch, (gpsFirstSecond() + epoch) * 1000);
+}
+
+void simGpsFeed(const char* data, size_t length) {
+    std::lock_guard<std::mutex> lock(gpsMutex);
+    gpsFed = true;
+    gpsRx.insert(gpsRx.end(), data, data + length);
+}
+
+void simGpsCommand(const std::string &line) {
+    std::lock_guard<std::mutex> lock(gpsMutex);
+    int a = 0, b = 0;
+    if (sscanf(line.c_str(), "$PAIR050,%d", &a) == 1 && a >= 100 && a <= 1000) {
+        gpsPump(gpsEventBufferSize ? gpsEventBufferSize : 256); // Epochs due at the old rate
+        gpsIntervalMs = a;
+        gpsNextDueMs = gpsNextBoundaryMs(simMillis64());
+    } else if (sscanf(line.c_str(), "$PAIR062,%d,%d", &a, &b) == 2 && a >= 0 && a < 6) {
+        gpsTypeOn[a] = b > 0;
+    }
+}
+
+// UART event task: wakes when the next epoch is due (its bytes arrive as one burst)
+static void gpsEventTask(void*) {
+    for (;;) {
+        uint64_t dueMs;
+        {
+            std::lock_guard<std::mutex> lock(gpsMutex);
+            if (!gpsFed && !gpsNextDueMs) gpsNextDueMs = gpsNextBoundaryMs(simMillis64());
+            dueMs = gpsFed ? simMillis64() + GPS_EPOCH_MS : gpsNextDueMs;
+        }
+        simSleepUntilUs(std::min(dueMs, simMillis64() + GPS_EVENT_POLL_MS) * 1000);
+
+        bool data, overflow;
+        {
+            std::lock_guard<std::mutex> lock(gpsMutex);
+            if (gpsFed || simMillis64() < gpsNextDueMs) continue; // Benchmarks read directly / interval changed
+            gpsPump(gpsEventBufferSize);
+            data = !gpsRx.empty();
+            overflow = gpsOverflow;
+            gpsOverflow = false;
+        }
+        if (overflow && gpsOnOverflow) gpsOnOverflow();
+        if (data && gpsOnData) gpsOnData();
+    }
+}
+
+void simGpsOnReceive(size_t rxBufferSize, std::function<void()> onData, std::function<void()> onOverflow) {
+    bool start;
+    {
+        std::lock_guard<std::mutex> lock(gpsMutex);
+        start = !gpsOnData;
+        if (start && !gpsFed && !gpsLogLoaded) loadGpsLog();
+        if (start && !gpsFed && (!gpsNextDueMs || gpsNextDueMs <= simMillis64())) {
+            // Epochs sent before the port was opened are not received (and not counted as dropped)
+            gpsNextDueMs = gpsNextBoundaryMs(simMillis64());
+        }
+        gpsEventBufferSize = rxBufferSize;
+        gpsOnData = onData;
+        gpsOnOverflow = onOverflow;
+    }
+    if (start) xTaskCreate(gpsEventTask, "uart_event", 2048, nullptr, 20, nullptr);
+}
+
+int simGpsAvailable(size_t rxBufferSize) {
+    std::lock_guard<std::mutex> lock(gpsMutex);
+    gpsPump(rxBufferSize);
+    return (int)gpsRx.size();
+}
+
+int simGpsRead(size_t rxBufferSize) {
+    std::lock_guard<std::mutex> lock(gpsMutex);
+    gpsPump(rxBufferSize);
+    if (gpsRx.empty()) return -1;
+    int c = gpsRx.front();
+    gpsRx.pop_front();
+    return c;
+}
+
+int simGpsPeek(size_t rxBufferSize) {
+    std::lock_guard<std::mutex> lock(gpsMutex);
+    gpsPump(rxBufferSize);
+    return gpsRx.empty() ? -1 : gpsRx.front();
+}
+
+// PPS: rising edge at every true UTC second, unaffected by --drift-ppm (the firmware times it with
+// its own oscillator). The ISR runs on a host thread but reads the clock as of the edge.
+static bool ppsLost() {
+    if (simConfig.ppsLossPeriodMs == 0 || simConfig.ppsLossLengthMs == 0) return false;
+    return simMillis64() % simConfig.ppsLossPeriodMs >= simConfig.ppsLossPeriodMs - simConfig.ppsLossLengthMs;
+}
+
+static void ppsTask(void* isr) {
+    uint64_t unix0 = simUnixMsAt(0);
+    for (;;) {
+        uint64_t nextSecondMs = (unix0 + simMillis64()) / 1000 * 1000 + 1000;
+        uint64_t edgeUs = (nextSecondMs - unix0) * 1000;
+        simSleepUntilUs(edgeUs);
+        if (!ppsLost()) simRunIsr(edgeUs, (void (*)())isr);
+    }
+}
+
+void simAttachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+    if ((int)pin != simConfig.ppsPin || mode != RISING || !isr) return; // Other inputs never change
+    xTaskCreate(ppsTask, "pps", 2048, (void*)isr, 24, nullptr);
+}
+
+// -----------------------------------------------------
+// ------------------------ CAN ------------------------
+// -----------------------------------------------------
+// candump -l lines "(1700000000.123456) can0 123#0011223344556677" are replayed in a loop at
+// their logged spacing. Without a log the bus is silent.
+
+struct SimCanFrame {
+    uint64_t offsetUs; // Since the first frame of the log
+    twai_message_t message;
+};
+
+static std::vector<SimCanFrame> canLog;
+static uint64_t canLogSpanUs = 0;
+static QueueHandle_t canRxQueue = nullptr;
+static EventGroupHandle_t canAlerts = nullptr; // Raised alerts (cleared by twai_read_alerts)
+static uint32_t canAlertsEnabled = 0;
+static std::atomic<uint32_t> canRxMissed{0};
+static twai_filter_config_t canFilter;
+static volatile bool canRunning = false;
+static bool canInstalled = false;
+static bool canFeederStarted = false;
+
+static void loadCanLog() {
+    if (simConfig.canFile.empty()) return;
+    std::ifstream in(simConfig.canFile);
+    if (!in) {
+        fprintf(stderr, "[SIM] Cannot open CAN log %s, bus is silent\n", simConfig.canFile.c_str());
+        return;
+    }
+
+    std::string line;
+    double first = -1;
+    while (std::getline(in, line)) {
+        double ts;
+        char iface[32], frame[64];
+        if (sscanf(line.c_str(), " (%lf) %31s %63s", &ts, iface, frame) != 3) continue;
+        char* hash = strchr(frame, '#');
+        if (!hash) continue;
+        *hash = 0;
+
+        SimCanFrame f = {};
+        f.message.identifier = strtoul(frame, nullptr, 16);
+        f.message.extd = strlen(frame) > 3;
+        const char* data = hash + 1;
+        if (*data == 'R') {
+            f.message.rtr = 1;
+        } else {
+            while (data[0] && data[1] && f.message.data_length_code < TWAI_FRAME_MAX_DLC) {
+                char byteText[3] = {data[0], data[1], 0};
+                f.message.data[f.message.data_length_code++] = (uint8_t)strtoul(byteText, nullptr, 16);
+                data += 2;
+            }
+        }
+        if (first < 0) first = ts;
+        f.offsetUs = (uint64_t)((ts - first) * 1e6);
+        canLog.push_back(f);
+    }
+    if (!canLog.empty()) canLogSpanUs = canLog.back().offsetUs + 1000; // 1 ms gap before the log repeats
+    fprintf(stderr, "[SIM] CAN log: %zu frames, %.1f s\n", canLog.size(), canLogSpanUs / 1e6);
+}
+
+// Single acceptance filter (ESP32 TWAI register layout), mask bits set = don't care
+static bool canAccept(const twai_message_t &m) {
+    uint32_t bits;
+    if (m.extd) {
+        bits = (m.identifier << 3) | (m.rtr ? 1u << 2 : 0);
+    } else {
+        bits = (m.identifier << 21) | (m.rtr ? 1u << 20 : 0);
+        if (m.data_length_code > 0) bits |= (uint32_t)m.data[0] << 8;
+        if (m.data_length_code > 1) bits |= m.data[1];
+    }
+    return ((bits ^ canFilter.acceptance_code) & ~canFilter.acceptance_mask) == 0;
+}
+
+static void canFeeder(void*) {
+    uint64_t loopStartUs = simMicros64();
+    size_t next = 0;
+    for (;;) {
+        if (next == canLog.size()) {
+            next = 0;
+            loopStartUs += canLogSpanUs;
+        }
+        const SimCanFrame &f = canLog[next++];
+        simSleepUntilUs(loopStartUs + f.offsetUs);
+        if (!canRunning || !canAccept(f.message)) continue;
+        if (xQueueSend(canRxQueue, &f.message, 0) == pdTRUE) {
+            xEventGroupSetBits(canAlerts, canAlertsEnabled & TWAI_ALERT_RX_DATA);
+        } else {
+            simStats.canFramesDropped++;
+            canRxMissed++;
+            xEventGroupSetBits(canAlerts, canAlertsEnabled & TWAI_ALERT_RX_QUEUE_FULL);
+        }
+    }
+}
+
+esp_err_t twai_driver_install(const twai_general_config_t* g_config, const twai_timing_config_t* t_config,
+                              const twai_filter_config_t* f_config) {
+    (void)t_config;
+    if (canInstalled) return ESP_ERR_INVALID_STATE;
+    // The feeder may still hold the queue of an earlier install, so it is created once
+    if (!canRxQueue) canRxQueue = xQueueCreate(g_config->rx_queue_len, sizeof(twai_message_t));
+    if (!canAlerts) canAlerts = xEventGroupCreate();
+    xEventGroupClearBits(canAlerts, 0xFFFFFFFF);
+    canAlertsEnabled = g_config->alerts_enabled;
+    canRxMissed = 0;
+    canFilter = *f_config;
+    canInstalled = true;
+    if (!canFeederStarted) {
+        canFeederStarted = true;
+        loadCanLog();
+        if (!canLog.empty()) xTaskCreate(canFeeder, "twai_sim", 4096, nullptr, 22, nullptr);
+    }
+    return ESP_OK;
+}
+
+esp_err_t twai_driver_uninstall() {
+    if (!canInstalled || canRunning) return ESP_ERR_INVALID_STATE;
+    canInstalled = false;
+    xQueueReset(canRxQueue);
+    return ESP_OK;
+}
+
+esp_err_t twai_start() {
+    if (!canInstalled) return ESP_ERR_INVALID_STATE;
+    canRunning = true;
+    return ESP_OK;
+}
+
+esp_err_t twai_stop() {
+    if (!canRunning) return ESP_ERR_INVALID_STATE;
+    canRunning = false;
+    return ESP_OK;
+}
+
+esp_err_t twai_receive(twai_message_t* message, TickType_t ticks_to_wait) {
+    if (!canRxQueue || !canRunning) return ESP_ERR_INVALID_STATE;
+    return xQueueReceive(canRxQueue, message, ticks_to_wait) == pdTRUE ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t twai_read_alerts(uint32_t* alerts, TickType_t ticks_to_wait) {
+    if (!canInstalled) return ESP_ERR_INVALID_STATE;
+    *alerts = xEventGroupWaitBits(canAlerts, 0xFFFFFFFF, pdTRUE, pdFALSE, ticks_to_wait);
+    return *alerts ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t twai_get_status_info(twai_status_info_t* status_info) {
+    if (!canInstalled) return ESP_ERR_INVALID_STATE;
+    *status_info = {};
+    status_info->state = canRunning ? TWAI_STATE_RUNNING : TWAI_STATE_STOPPED;
+    status_info->msgs_to_rx = uxQueueMessagesWaiting(canRxQueue);
+    status_info->rx_missed_count = canRxMissed;
+    return ESP_OK;
+}
+
+esp_err_t twai_initiate_recovery() {
+    return ESP_ERR_INVALID_STATE; // Never bus-off
+}
+
+esp_err_t twai_transmit(const twai_message_t* message, TickType_t ticks_to_wait) {
+    (void)message; (void)ticks_to_wait;
+    return canRunning ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
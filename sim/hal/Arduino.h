@@ -0,0 +1,220 @@
+#pragma once
+// Arduino-ESP32 core subset for the host simulation (implementation: sim/SimArduino.cpp)
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+
+#include "../SimHal.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_err.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define IRAM_ATTR
+#define PROGMEM
+#define F(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+
+#define HIGH 1
+#define LOW  0
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define DEC 10
+#define HEX 16
+
+#define PI         3.1415926535897932384626433832795
+#define HALF_PI    1.5707963267948966192313216916398
+#define TWO_PI     6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+#define radians(deg) ((deg) * DEG_TO_RAD)
+#define degrees(rad) ((rad) * RAD_TO_DEG)
+#define sq(x) ((x) * (x))
+#define constrain(v, lo, hi) ((v) < (lo) ? (lo) : ((v) > (hi) ? (hi) : (v)))
+using std::min;
+using std::max;
+
+// Sketch hook of the ESP32 core (wait before setup() for the serial monitor)
+#define SET_TIME_BEFORE_STARTING_SKETCH_MS(ms) uint64_t getArduinoSetupWaitTime_ms() { return ms; }
+
+// ---------------- Time ----------------
+inline unsigned long millis() { return (unsigned long)(simLocalMicros64() / 1000); }
+inline unsigned long micros() { return (unsigned long)simLocalMicros64(); }
+inline void delay(uint32_t ms) { simSleepMs(ms); }
+inline void delayMicroseconds(uint32_t us) { simSleepUntilUs(simMicros64() + us); }
+inline void yield() {}
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1,
+                const char* server2 = nullptr, const char* server3 = nullptr);
+
+// ---------------- Memory ----------------
+inline bool psramFound() { return true; } // Host RAM stands in for PSRAM (esp_heap_caps.h)
+
+// ---------------- GPIO ----------------
+// Inputs read HIGH (button released). Only the PPS pin (--pps) fires: one rising edge per UTC second.
+inline void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+inline void digitalWrite(uint8_t pin, uint8_t value) { (void)pin; (void)value; }
+inline int digitalRead(uint8_t pin) { (void)pin; return HIGH; }
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+inline void attachInterrupt(uint8_t pin, void (*isr)(), int mode) { simAttachInterrupt(pin, isr, mode); }
+inline void detachInterrupt(uint8_t pin) { (void)pin; }
+
+// ---------------- String ----------------
+class String {
+public:
+    String() {}
+    String(const char* s) : _s(s ? s : "") {}
+    String(const std::string &s) : _s(s) {}
+    explicit String(char c) : _s(1, c) {}
+    explicit String(int v) : _s(std::to_string(v)) {}
+    explicit String(unsigned int v) : _s(std::to_string(v)) {}
+    explicit String(long v) : _s(std::to_string(v)) {}
+    explicit String(unsigned long v) : _s(std::to_string(v)) {}
+    explicit String(long long v) : _s(std::to_string(v)) {}
+    explicit String(unsigned long long v) : _s(std::to_string(v)) {}
+    explicit String(double v, unsigned int decimals = 2) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+        _s = buf;
+    }
+
+    const char* c_str() const { return _s.c_str(); }
+    unsigned int length() const { return _s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    void reserve(unsigned int size) { _s.reserve(size); }
+    char charAt(unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+    char operator[](unsigned int i) const { return charAt(i); }
+
+    bool concat(const String &s) { _s += s._s; return true; }
+    bool concat(const char* s) { if (s) _s += s; return true; }
+    bool concat(const char* s, unsigned int n) { if (s) _s.append(s, n); return true; }
+    bool concat(char c) { _s += c; return true; }
+    template <typename T> bool concat(T v) { _s += String(v)._s; return true; }
+    String &operator+=(const String &s) { concat(s); return *this; }
+    String &operator+=(const char* s) { concat(s); return *this; }
+    String &operator+=(char c) { concat(c); return *this; }
+    template <typename T> String &operator+=(T v) { concat(v); return *this; }
+
+    bool equals(const String &s) const { return _s == s._s; }
+    bool operator==(const String &s) const { return _s == s._s; }
+    bool operator==(const char* s) const { return _s == (s ? s : ""); }
+    bool operator!=(const String &s) const { return _s != s._s; }
+    bool operator!=(const char* s) const { return !(*this == s); }
+    bool operator<(const String &s) const { return _s < s._s; }
+    bool operator>(const String &s) const { return _s > s._s; }
+    int compareTo(const String &s) const { return _s.compare(s._s); }
+
+    bool startsWith(const String &s) const { return _s.compare(0, s._s.size(), s._s) == 0; }
+    bool endsWith(const String &s) const {
+        return _s.size() >= s._s.size() && _s.compare(_s.size() - s._s.size(), s._s.size(), s._s) == 0;
+    }
+    int indexOf(char c, unsigned int from = 0) const { return pos(_s.find(c, from)); }
+    int indexOf(const String &s, unsigned int from = 0) const { return pos(_s.find(s._s, from)); }
+    int lastIndexOf(char c) const { return pos(_s.rfind(c)); }
+    int lastIndexOf(const String &s) const { return pos(_s.rfind(s._s)); }
+    String substring(unsigned int from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) std::swap(from, to);
+        return from < _s.size() ? String(_s.substr(from, to - from)) : String();
+    }
+
+    void trim() {
+        size_t a = _s.find_first_not_of(" \t\r\n");
+        size_t b = _s.find_last_not_of(" \t\r\n");
+        _s = a == std::string::npos ? std::string() : _s.substr(a, b - a + 1);
+    }
+    void toUpperCase() { for (auto &c : _s) c = (char)toupper((unsigned char)c); }
+    void toLowerCase() { for (auto &c : _s) c = (char)tolower((unsigned char)c); }
+    long toInt() const { return atol(_s.c_str()); }
+    float toFloat() const { return (float)atof(_s.c_str()); }
+    double toDouble() const { return atof(_s.c_str()); }
+
+    friend String operator+(const String &a, const String &b) { return String(a._s + b._s); }
+    friend String operator+(const String &a, const char* b) { return String(a._s + (b ? b : "")); }
+    friend String operator+(const char* a, const String &b) { return String(std::string(a ? a : "") + b._s); }
+    friend String operator+(const String &a, char b) { return String(a._s + b); }
+
+private:
+    std::string _s;
+    static int pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+};
+
+// ---------------- Print / Stream ----------------
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) n += write(*buffer++);
+        return n;
+    }
+    size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+    size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+    virtual void flush() {}
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String &s) { return write(s.c_str(), s.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v, int base = DEC) { return print((long long)v, base); }
+    size_t print(unsigned int v, int base = DEC) { return print((unsigned long long)v, base); }
+    size_t print(long v, int base = DEC) { return print((long long)v, base); }
+    size_t print(unsigned long v, int base = DEC) { return print((unsigned long long)v, base); }
+    size_t print(long long v, int base = DEC) { return base == HEX ? printf("%llx", v) : printf("%lld", v); }
+    size_t print(unsigned long long v, int base = DEC) { return base == HEX ? printf("%llx", v) : printf("%llu", v); }
+    size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+
+    size_t println() { return write("\r\n", 2); }
+    template <typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+    template <typename T> size_t println(T v, int format) { size_t n = print(v, format); return n + println(); }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    void setTimeout(unsigned long ms) { (void)ms; } // Sources never block
+
+    size_t readBytes(uint8_t* buffer, size_t length) {
+        size_t n = 0;
+        int c;
+        while (n < length && (c = read()) >= 0) buffer[n++] = (uint8_t)c;
+        return n;
+    }
+    size_t readBytes(char* buffer, size_t length) { return readBytes((uint8_t*)buffer, length); }
+    size_t readBytesUntil(char terminator, char* buffer, size_t length) {
+        size_t n = 0;
+        int c;
+        while (n < length && (c = read()) >= 0 && c != terminator) buffer[n++] = (char)c;
+        return n;
+    }
+    size_t readBytesUntil(char terminator, uint8_t* buffer, size_t length) {
+        return readBytesUntil(terminator, (char*)buffer, length);
+    }
+    String readStringUntil(char terminator) {
+        std::string s;
+        int c;
+        while ((c = read()) >= 0 && c != terminator) s += (char)c;
+        return String(s);
+    }
+};
+
+#include "HardwareSerial.h"
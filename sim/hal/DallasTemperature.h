@@ -0,0 +1,19 @@
+#pragma once
+// Simulated DS18B20: 20 °C with a ±5 °C daily swing on virtual UTC, 0.0625 °C resolution
+#include "OneWire.h"
+
+#define DEVICE_DISCONNECTED_C -127
+
+class DallasTemperature {
+public:
+    explicit DallasTemperature(OneWire* wire) { (void)wire; }
+    void begin() {}
+    void setWaitForConversion(bool wait) { (void)wait; }
+    void requestTemperatures() {}
+    float getTempCByIndex(uint8_t index) {
+        (void)index;
+        double dayPhase = (double)(simUnixMs() % 86400000ULL) / 86400000.0;
+        double tempC = 20.0 + 5.0 * sin(TWO_PI * (dayPhase - 0.375)); // Warmest at 15:00 UTC
+        return (float)(round(tempC * 16.0) / 16.0);
+    }
+};
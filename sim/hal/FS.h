@@ -0,0 +1,75 @@
+#pragma once
+// ESP32 FS/File subset over a host directory (implementation: sim/SimFs.cpp).
+// Paths are absolute on the "card" ("/queue/00000001.seg") and map below simConfig.sdRoot.
+#include "Arduino.h"
+#include <memory>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+struct FileImpl;
+
+class File : public Stream {
+public:
+    File() {}
+    explicit File(std::shared_ptr<FileImpl> impl) : _impl(impl) {}
+
+    operator bool() const;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t read(uint8_t* buffer, size_t size);
+    size_t readBytes(char* buffer, size_t length) { return read((uint8_t*)buffer, length); }
+    void flush() override;
+    bool seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void close();
+    const char* path() const;
+    const char* name() const;
+    bool isDirectory() const;
+    File openNextFile(const char* mode = FILE_READ);
+    void rewindDirectory();
+
+private:
+    std::shared_ptr<FileImpl> _impl;
+};
+
+class FS {
+public:
+    File open(const char* path, const char* mode = FILE_READ, bool create = false);
+    File open(const String &path, const char* mode = FILE_READ, bool create = false) {
+        return open(path.c_str(), mode, create);
+    }
+    bool exists(const char* path);
+    bool exists(const String &path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String &path) { return remove(path.c_str()); }
+    bool rename(const char* from, const char* to);
+    bool rename(const String &from, const String &to) { return rename(from.c_str(), to.c_str()); }
+    bool mkdir(const char* path);
+    bool mkdir(const String &path) { return mkdir(path.c_str()); }
+    bool rmdir(const char* path);
+    bool rmdir(const String &path) { return rmdir(path.c_str()); }
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
@@ -0,0 +1,62 @@
+#pragma once
+// UART0 is the console (stdout). Other UARTs are wired to the simulated GPS receiver,
+// which produces NMEA on the virtual clock; bytes beyond the RX buffer size are dropped.
+// onReceive() callbacks run in a UART event task once per released epoch (end of burst);
+// onReceiveError() reports UART_BUFFER_FULL_ERROR when bytes were dropped. Lines written to
+// the receiver are handled as PAIR commands (fix interval, sentence types).
+#include <functional>
+#include <string>
+#include "Arduino.h"
+
+#define SERIAL_8N1 0x800001c
+
+typedef enum {
+    UART_NO_ERROR,
+    UART_BREAK_ERROR,
+    UART_BUFFER_FULL_ERROR,
+    UART_FIFO_OVF_ERROR,
+    UART_FRAME_ERROR,
+    UART_PARITY_ERROR
+} hardwareSerial_error_t;
+
+typedef std::function<void(void)> OnReceiveCb;
+typedef std::function<void(hardwareSerial_error_t)> OnReceiveErrorCb;
+
+class HardwareSerial : public Stream {
+public:
+    explicit HardwareSerial(int uartNr) : _uart(uartNr) {}
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1) {
+        (void)baud; (void)config; (void)rxPin; (void)txPin;
+    }
+    void end() {}
+    size_t setRxBufferSize(size_t size) {
+        _rxBufferSize = size;
+        return size;
+    }
+    bool setRxTimeout(uint8_t symbolsTimeout) {
+        (void)symbolsTimeout;
+        return true;
+    }
+    void onReceive(OnReceiveCb function, bool onlyOnTimeout = false);
+    void onReceiveError(OnReceiveErrorCb function) { _onReceiveError = function; }
+    operator bool() const { return true; }
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t read(uint8_t* buffer, size_t size) { return readBytes(buffer, size); }
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    void flush() override;
+
+private:
+    int _uart;
+    size_t _rxBufferSize = 256; // Arduino-ESP32 default
+    OnReceiveCb _onReceive;
+    OnReceiveErrorCb _onReceiveError;
+    std::string _txLine; // Command being sent to the GPS receiver
+};
+
+extern HardwareSerial Serial;
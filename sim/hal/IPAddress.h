@@ -0,0 +1,26 @@
+#pragma once
+#include "Arduino.h"
+
+class IPAddress {
+public:
+    IPAddress() {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _bytes{a, b, c, d} {}
+    explicit IPAddress(uint32_t address) { memcpy(_bytes, &address, 4); }
+
+    operator uint32_t() const {
+        uint32_t address;
+        memcpy(&address, _bytes, 4);
+        return address;
+    }
+    uint8_t operator[](int i) const { return _bytes[i]; }
+    uint8_t* raw_address() { return _bytes; }
+
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+        return String(buf);
+    }
+
+private:
+    uint8_t _bytes[4] = {0, 0, 0, 0};
+};
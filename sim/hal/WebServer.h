@@ -0,0 +1,27 @@
+#pragma once
+// HTTP server stand-in: routes are registered and begin()/handleClient() succeed, but no
+// requests arrive.
+#include "Arduino.h"
+#include <functional>
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+class WebServer {
+public:
+    typedef std::function<void()> THandlerFunction;
+
+    explicit WebServer(int port = 80) { (void)port; }
+    void begin() {}
+    void handleClient() {}
+    void on(const char* uri, THandlerFunction handler) { (void)uri; (void)handler; }
+
+    bool hasArg(const char* name) const { (void)name; return false; }
+    String arg(const char* name) const { (void)name; return String(); }
+
+    void setContentLength(size_t length) { (void)length; }
+    void send(int code, const char* contentType = nullptr, const String &content = String()) {
+        (void)code; (void)contentType; (void)content;
+    }
+    void sendContent(const String &content) { (void)content; }
+    void sendContent(const char* content, size_t length) { (void)content; (void)length; }
+};
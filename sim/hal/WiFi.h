@@ -0,0 +1,73 @@
+#pragma once
+// Wi-Fi station and TCP client for the host simulation (implementation: sim/SimNet.cpp).
+// Access points come from simAddAccessPoint(); the link follows the outage schedule of
+// simWifiUp(). Every TCP connection goes to simConfig.brokerHost:brokerPort.
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "Client.h"
+#include "esp_event.h"
+#include <vector>
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6,
+    WL_NO_SHIELD = 255
+} wl_status_t;
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA,
+    WIFI_AP,
+    WIFI_AP_STA
+} wifi_mode_t;
+
+class WiFiClass {
+public:
+    bool mode(wifi_mode_t mode);
+    int16_t scanNetworks(bool async = false, bool showHidden = false);
+    String SSID(uint8_t i) const;
+    int32_t RSSI(uint8_t i) const;
+    String SSID() const;
+    int8_t RSSI();
+    wl_status_t begin(const char* ssid, const char* passphrase = nullptr);
+    bool disconnect(bool wifiOff = false, bool eraseAp = false);
+    wl_status_t status();
+    IPAddress localIP();
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient : public Client {
+public:
+    WiFiClient() {}
+    ~WiFiClient() { stop(); }
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buffer, size_t size) override;
+    int peek() override;
+    void flush() override {}
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+    void setNoDelay(bool noDelay) { (void)noDelay; } // Always on
+
+private:
+    int _fd = -1;
+    std::vector<uint8_t> _rx;
+    size_t _rxPos = 0;
+    std::string _tap; // Outgoing MQTT bytes not yet parsed into packets
+
+    bool fill(); // Non-blocking receive into _rx
+    void tapMqtt(const uint8_t* buffer, size_t size);
+};
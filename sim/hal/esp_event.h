@@ -0,0 +1,45 @@
+#pragma once
+// Default event loop: WIFI_EVENT / IP_EVENT are posted by the simulated station (sim/SimNet.cpp)
+// from its own task, like the ESP-IDF event task.
+#include "esp_err.h"
+#include <stdint.h>
+
+typedef const char* esp_event_base_t;
+typedef void (*esp_event_handler_t)(void* arg, esp_event_base_t base, int32_t id, void* data);
+typedef void* esp_event_handler_instance_t;
+
+extern esp_event_base_t const WIFI_EVENT;
+extern esp_event_base_t const IP_EVENT;
+
+#define ESP_EVENT_ANY_ID -1
+
+typedef enum {
+    WIFI_EVENT_WIFI_READY = 0,
+    WIFI_EVENT_SCAN_DONE,
+    WIFI_EVENT_STA_START,
+    WIFI_EVENT_STA_STOP,
+    WIFI_EVENT_STA_CONNECTED,
+    WIFI_EVENT_STA_DISCONNECTED
+} wifi_event_t;
+
+typedef enum {
+    IP_EVENT_STA_GOT_IP = 0,
+    IP_EVENT_STA_LOST_IP
+} ip_event_t;
+
+typedef struct {
+    uint32_t ip;
+    uint32_t netmask;
+    uint32_t gw;
+} esp_netif_ip_info_t;
+
+typedef struct {
+    int if_index;
+    void* esp_netif;
+    esp_netif_ip_info_t ip_info;
+    bool ip_changed;
+} ip_event_got_ip_t;
+
+esp_err_t esp_event_loop_create_default();
+esp_err_t esp_event_handler_instance_register(esp_event_base_t base, int32_t id, esp_event_handler_t handler,
+                                              void* arg, esp_event_handler_instance_t* instance);
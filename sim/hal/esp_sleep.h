@@ -0,0 +1,17 @@
+#pragma once
+// Deep sleep ends the simulation (sim/sim_main.cpp prints the summary first)
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+typedef enum {
+    ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+    ESP_SLEEP_WAKEUP_ALL,
+    ESP_SLEEP_WAKEUP_EXT0,
+    ESP_SLEEP_WAKEUP_EXT1,
+    ESP_SLEEP_WAKEUP_TIMER
+} esp_sleep_source_t;
+typedef esp_sleep_source_t esp_sleep_wakeup_cause_t;
+
+inline esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t pin, int level) { (void)pin; (void)level; return ESP_OK; }
+inline esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() { return ESP_SLEEP_WAKEUP_UNDEFINED; }
+[[noreturn]] void esp_deep_sleep_start();
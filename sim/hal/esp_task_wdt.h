@@ -0,0 +1,16 @@
+#pragma once
+// Task watchdog: accepted and ignored (a stalled task shows up as a flat line in the report)
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef struct {
+    uint32_t timeout_ms;
+    uint32_t idle_core_mask;
+    bool trigger_panic;
+} esp_task_wdt_config_t;
+
+inline esp_err_t esp_task_wdt_init(const esp_task_wdt_config_t* config) { (void)config; return ESP_OK; }
+inline esp_err_t esp_task_wdt_deinit() { return ESP_OK; }
+inline esp_err_t esp_task_wdt_add(TaskHandle_t task) { (void)task; return ESP_OK; }
+inline esp_err_t esp_task_wdt_delete(TaskHandle_t task) { (void)task; return ESP_OK; }
+inline esp_err_t esp_task_wdt_reset() { return ESP_OK; }
@@ -0,0 +1,6 @@
+#pragma once
+// High resolution timer: µs since boot on the device oscillator (virtual clock, off by --drift-ppm)
+#include <stdint.h>
+#include "../SimHal.h"
+
+inline int64_t esp_timer_get_time() { return (int64_t)simLocalMicros64(); }
@@ -0,0 +1,96 @@
+#pragma once
+// FreeRTOS subset on host threads (implementation: sim/SimRtos.cpp).
+// One tick = 1 ms of virtual time. Priorities, stack sizes and core affinity are ignored.
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <thread>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS 1
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY (-1)
+
+struct SimTask;
+struct SimQueue;
+struct SimEventGroup;
+typedef SimTask* TaskHandle_t;
+typedef SimQueue* QueueHandle_t;
+typedef SimQueue* SemaphoreHandle_t; // Semaphores are queues of zero-size items, as in FreeRTOS
+typedef SimEventGroup* EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+
+// ---------------- Tasks ----------------
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* param,
+                       UBaseType_t priority, TaskHandle_t* created);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* param,
+                                   UBaseType_t priority, TaskHandle_t* created, BaseType_t core);
+void vTaskDelete(TaskHandle_t task); // NULL from a task parks it forever; from main() it returns
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t increment);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+
+#define taskYIELD()
+#define portYIELD_FROM_ISR(...)
+
+// ---------------- Queues / semaphores ----------------
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks);
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks);
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t ticks);
+BaseType_t xQueueReset(QueueHandle_t queue);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+
+#define xQueueSendToBack(q, item, ticks) xQueueSend(q, item, ticks)
+#define xQueueSendFromISR(q, item, woken) xQueueSend(q, item, 0)
+#define xQueueReceiveFromISR(q, item, woken) xQueueReceive(q, item, 0)
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount);
+#define xSemaphoreTake(s, ticks) xQueueReceive(s, nullptr, ticks)
+#define xSemaphoreGive(s) xQueueSend(s, nullptr, 0)
+#define xSemaphoreGiveFromISR(s, woken) xQueueSend(s, nullptr, 0)
+#define vSemaphoreDelete(s) vQueueDelete(s)
+
+// ---------------- Critical sections ----------------
+// Spinlock shared by tasks and ISRs (ISRs are host threads here)
+struct portMUX_TYPE {
+    std::atomic_flag locked = ATOMIC_FLAG_INIT;
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+inline void simCriticalEnter(portMUX_TYPE* mux) {
+    while (mux->locked.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
+}
+inline void simCriticalExit(portMUX_TYPE* mux) { mux->locked.clear(std::memory_order_release); }
+#define portENTER_CRITICAL(mux) simCriticalEnter(mux)
+#define portEXIT_CRITICAL(mux) simCriticalExit(mux)
+#define portENTER_CRITICAL_ISR(mux) simCriticalEnter(mux)
+#define portEXIT_CRITICAL_ISR(mux) simCriticalExit(mux)
+
+// ---------------- Event groups ----------------
+EventGroupHandle_t xEventGroupCreate();
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clearOnExit,
+                                BaseType_t waitForAll, TickType_t ticks);
@@ -0,0 +1,4 @@
+#pragma once
+// SNTP: after configTime(), time() follows virtual UTC from the first Wi-Fi connection on
+// (before that it counts seconds since boot, like the ESP32 RTC)
+#include "Arduino.h"
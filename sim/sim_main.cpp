@@ -0,0 +1,183 @@
+// fw_sim - runs the unmodified firmware (main/) on a PC against simulated peripherals
+//
+// Build (Linux, one command), LIBS = Arduino libraries folder (ArduinoJson 7, PubSubClient):
+//   g++ -O2 -std=gnu++17 -pthread -DARDUINO=10819 -DARDUINOJSON_ENABLE_PROGMEM=0
+//       -Isim/hal -Imain -I$LIBS/ArduinoJson/src -I$LIBS/PubSubClient/src
+//       -x c++ main/main.ino -x none main/*.cpp sim/*.cpp
+//       $LIBS/PubSubClient/src/PubSubClient.cpp -o fw_sim
+// Usage:
+//   ./fw_sim [--speed 1000] [--days 7] [--report-min 60] [--sd sim_sd] [--nmea track.nmea]
+//            [--can drive.log] [--broker 127.0.0.1:1883] [--outage 120:30] [--start UNIX_S] [--quiet]
+//            [--pps 32] [--pps-loss 60:10] [--drift-ppm 20]
+//
+// Virtual time runs --speed times faster than real time. A report line (CSV) goes to stderr every
+// --report-min virtual minutes; firmware Serial output goes to stdout. --outage P:L drops Wi-Fi for
+// L of every P virtual minutes. --can also enables CAN in the firmware. The broker must accept any
+// credentials; ack markers need a responder on v1/devices/me/attributes/request/+ (README,
+// "Delivery Acknowledgement"). The receiver pulses --pps (GPIO, -1 = none) every UTC second except
+// during --pps-loss; --drift-ppm makes the device oscillator (millis, esp_timer) run off true time.
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <mutex>
+#include <string>
+
+#include <Arduino.h>
+#include "WiFiManager.h"
+#include "DrainController.h"
+#include "TimeManager.h"
+#include "SnapshotBuffer.h"
+
+void setup();
+uint64_t getArduinoSetupWaitTime_ms() __attribute__((weak));
+uint64_t getArduinoSetupWaitTime_ms() { return 0; }
+
+// Firmware state shown in the report (main.ino)
+extern std::vector<WiFiConfig> WIFI_CONFIG;
+extern bool ENABLE_CAN;
+extern SnapshotBuffer snapshotBuffer;
+extern QueueHandle_t sdWriteQueue;
+extern DrainController drainController;
+
+static std::chrono::steady_clock::time_point wallStart;
+
+static void usage() {
+    fprintf(stderr, "usage: fw_sim [--speed X] [--days D] [--report-min M] [--sd DIR] [--nmea FILE] [--can FILE]\n"
+                    "              [--broker HOST:PORT] [--outage PERIOD_MIN:LENGTH_MIN] [--start UNIX_S] [--quiet]\n"
+                    "              [--pps PIN] [--pps-loss PERIOD_MIN:LENGTH_MIN] [--drift-ppm PPM]\n");
+    exit(2);
+}
+
+static bool parseArgs(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--quiet") {
+            simConfig.quiet = true;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+
+        if (arg == "--speed") simConfig.speed = atof(value);
+        else if (arg == "--days") simConfig.durationMs = (uint64_t)(atof(value) * 86400000.0);
+        else if (arg == "--report-min") simConfig.reportMs = (uint64_t)(atof(value) * 60000.0);
+        else if (arg == "--sd") simConfig.sdRoot = value;
+        else if (arg == "--nmea") simConfig.nmeaFile = value;
+        else if (arg == "--can") simConfig.canFile = value;
+        else if (arg == "--start") simConfig.startUnixMs = strtoull(value, nullptr, 10) * 1000ULL;
+        else if (arg == "--broker") {
+            std::string broker = value;
+            size_t colon = broker.rfind(':');
+            simConfig.brokerHost = broker.substr(0, colon);
+            if (colon != std::string::npos) simConfig.brokerPort = atoi(broker.c_str() + colon + 1);
+        } else if (arg == "--outage") {
+            double period = 0, length = 0;
+            if (sscanf(value, "%lf:%lf", &period, &length) != 2) return false;
+            simConfig.outagePeriodMs = (uint64_t)(period * 60000.0);
+            simConfig.outageLengthMs = (uint64_t)(length * 60000.0);
+        } else if (arg == "--pps-loss") {
+            double period = 0, length = 0;
+            if (sscanf(value, "%lf:%lf", &period, &length) != 2) return false;
+            simConfig.ppsLossPeriodMs = (uint64_t)(period * 60000.0);
+            simConfig.ppsLossLengthMs = (uint64_t)(length * 60000.0);
+        } else if (arg == "--pps") {
+            simConfig.ppsPin = atoi(value);
+        } else if (arg == "--drift-ppm") {
+            simConfig.driftPpm = atof(value);
+        } else {
+            return false;
+        }
+    }
+    return simConfig.speed > 0 && simConfig.reportMs > 0;
+}
+
+// Bytes in the pending queue segments (not yet committed by the upload cursor)
+static uint64_t pendingBytes() {
+    std::string dir = simConfig.sdRoot + "/queue";
+    DIR* d = opendir(dir.c_str());
+    if (!d) return 0;
+    uint64_t total = 0;
+    while (struct dirent* e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name.size() < 4 || name.compare(name.size() - 4, 4, ".seg") != 0) continue;
+        struct stat st;
+        if (stat((dir + "/" + name).c_str(), &st) == 0) total += st.st_size;
+    }
+    closedir(d);
+    return total;
+}
+
+static void report() {
+    // Firmware clock minus true UTC (empty until the clock is set)
+    char clockErr[24] = "";
+    TimeStatus time = TimeManager::getStatus();
+    if (time.valid) {
+        int64_t trueUs = (int64_t)simUnixMsAt(0) * 1000 + (int64_t)simMicros64();
+        snprintf(clockErr, sizeof(clockErr), "%lld", (long long)((int64_t)TimeManager::getTimestampUs() - trueUs));
+    }
+    fprintf(stderr, "%.2f,%u,%u,%llu,%d,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%s,%ld\n",
+            simMillis64() / 3600000.0,
+            (unsigned)snapshotBuffer.size(),
+            (unsigned)uxQueueMessagesWaiting(sdWriteQueue),
+            (unsigned long long)pendingBytes(),
+            drainController.batchSize(),
+            (unsigned long long)simStats.sdBytesWritten,
+            (unsigned long long)simStats.sdFlushes,
+            (unsigned long long)simStats.telemetryPublishes,
+            (unsigned long long)simStats.telemetryBytes,
+            (unsigned long long)simStats.attributeRequests,
+            (unsigned long long)simStats.mqttConnects,
+            (unsigned long long)simStats.gpsBytesDropped,
+            (unsigned long long)simStats.canFramesDropped,
+            clockErr,
+            (long)time.freqErrorPpb);
+}
+
+void simFinish(const char* reason) {
+    static std::mutex finishMutex;
+    finishMutex.lock(); // Never released: the first caller ends the process
+    report();
+    double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    fprintf(stderr, "[SIM] End (%s): %.2f virtual h in %.1f s (x%.0f), SD: %llu bytes/%llu flushes/%llu opens, "
+                    "net: %llu out/%llu in\n",
+            reason, simMillis64() / 3600000.0, wallS, wallS > 0 ? simMillis64() / 1000.0 / wallS : 0,
+            (unsigned long long)simStats.sdBytesWritten, (unsigned long long)simStats.sdFlushes,
+            (unsigned long long)simStats.sdOpens, (unsigned long long)simStats.netBytesOut,
+            (unsigned long long)simStats.netBytesIn);
+    fflush(stdout);
+    fflush(stderr);
+    _exit(0); // Firmware tasks never return, so static destructors must not run under them
+}
+
+int main(int argc, char** argv) {
+    if (!parseArgs(argc, argv)) usage();
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    if (!simConfig.canFile.empty()) ENABLE_CAN = true; // A replayed bus needs TaskCAN
+
+    // Known networks are in range, the first one strongest
+    int rssi = -55;
+    for (const auto &cfg : WIFI_CONFIG) {
+        simAddAccessPoint(cfg.ssid, rssi);
+        rssi -= 10;
+    }
+
+    fprintf(stderr, "[SIM] speed x%.0f, %.2f days, SD in %s, broker %s:%d\n", simConfig.speed,
+            simConfig.durationMs / 86400000.0, simConfig.sdRoot.c_str(), simConfig.brokerHost.c_str(),
+            simConfig.brokerPort);
+    fprintf(stderr, "hours,data_queue,sd_queue,pending_bytes,drain_batch,sd_bytes,sd_flushes,"
+                    "publishes,telemetry_bytes,attr_requests,mqtt_connects,gps_dropped,can_dropped,clock_err_us,freq_error_ppb\n");
+
+    wallStart = std::chrono::steady_clock::now();
+    simClockStart();
+    delay(getArduinoSetupWaitTime_ms());
+    setup(); // Starts the firmware tasks, then returns from vTaskDelete(NULL)
+
+    for (uint64_t next = simConfig.reportMs; next < simConfig.durationMs; next += simConfig.reportMs) {
+        simSleepUntilUs(next * 1000);
+        report();
+    }
+    simSleepUntilUs(simConfig.durationMs * 1000);
+    simFinish("duration"); // Prints the last report line
+}
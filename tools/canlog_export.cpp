@@ -0,0 +1,151 @@
+// canlog_export - converts raw CAN captures (CAN_*.can) to candump or Vector ASC text
+//
+// Build (Linux): g++ -O2 -std=c++17 -o canlog_export canlog_export.cpp
+// Usage:         ./canlog_export [--asc] [--iface can0] CAN_20260101_120000.can [more files...] > out.log
+//
+// Default output is the candump -l format, "(1767268800.123456) can0 123#0011223344556677", which
+// can-utils (canplayer, log2asc) and the host simulation (fw_sim --can) read. --asc writes a Vector
+// ASC trace with timestamps relative to the first frame (channel 1).
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "../main/LogFrame.h"
+#include "../main/CanCapture.h"
+
+struct Frame {
+    uint64_t timeUs;
+    uint32_t id;
+    bool extended;
+    bool remote;
+    uint8_t dlc;
+    uint8_t data[8];
+};
+
+static uint64_t getLe(const uint8_t* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+// Appends the records of one block. Returns false if the block is truncated.
+static bool decodeBlock(const uint8_t* p, size_t len, std::vector<Frame> &frames) {
+    if (len < CAN_CAPTURE_BLOCK_HEADER) return false;
+    uint64_t base = getLe(p, 8);
+    size_t pos = CAN_CAPTURE_BLOCK_HEADER;
+    while (pos < len) {
+        if (pos + 9 > len) return false;
+        Frame f = {};
+        f.timeUs = base + getLe(p + pos, 4);
+        uint32_t word = (uint32_t)getLe(p + pos + 4, 4);
+        f.id = word & CAN_CAPTURE_ID_MASK;
+        f.extended = word & CAN_CAPTURE_ID_EXTD;
+        f.remote = word & CAN_CAPTURE_ID_RTR;
+        f.dlc = p[pos + 8];
+        if (f.dlc > 8 || pos + 9 + f.dlc > len) return false;
+        memcpy(f.data, p + pos + 9, f.dlc);
+        pos += 9 + f.dlc;
+        frames.push_back(f);
+    }
+    return true;
+}
+
+static bool readFile(const char* path, std::vector<Frame> &frames) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "[export] Cannot open %s\n", path);
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+
+    size_t offset = 0;
+    size_t before = frames.size();
+    int skipped = 0;
+    while (offset + LOG_FRAME_HEADER_SIZE <= data.size()) {
+        LogFrameHeader hdr;
+        const uint8_t* payload = &data[offset + LOG_FRAME_HEADER_SIZE];
+        if (!logFrameDecodeHeader(&data[offset], hdr, CAN_CAPTURE_BLOCK_SIZE) ||
+            offset + LOG_FRAME_HEADER_SIZE + hdr.length > data.size() || !logFrameVerify(hdr, payload)) {
+            offset++; // Resync on next frame
+            skipped++;
+            continue;
+        }
+        offset += LOG_FRAME_HEADER_SIZE + hdr.length;
+        if (hdr.flags == CAN_CAPTURE_FRAME_BLOCK && !decodeBlock(payload, hdr.length, frames)) skipped++;
+    }
+
+    fprintf(stderr, "[export] %s: %zu frames%s\n", path, frames.size() - before, skipped ? " (corrupted bytes skipped)" : "");
+    return true;
+}
+
+static void writeCandump(const std::vector<Frame> &frames, const char* iface) {
+    for (const Frame &f : frames) {
+        printf("(%llu.%06llu) %s ", (unsigned long long)(f.timeUs / 1000000), (unsigned long long)(f.timeUs % 1000000), iface);
+        printf(f.extended ? "%08X#" : "%03X#", f.id);
+        if (f.remote) {
+            printf("R");
+        } else {
+            for (int i = 0; i < f.dlc; ++i) printf("%02X", f.data[i]);
+        }
+        printf("\n");
+    }
+}
+
+static void writeAsc(const std::vector<Frame> &frames) {
+    uint64_t startUs = frames.empty() ? 0 : frames[0].timeUs;
+    time_t start = (time_t)(startUs / 1000000);
+    struct tm t;
+    gmtime_r(&start, &t);
+    char date[64];
+    strftime(date, sizeof(date), "%a %b %d %I:%M:%S", &t);
+    char stamp[96];
+    snprintf(stamp, sizeof(stamp), "%s.%03u %s %d", date, (unsigned)(startUs % 1000000 / 1000), t.tm_hour < 12 ? "am" : "pm",
+             t.tm_year + 1900);
+
+    printf("date %s\n", stamp);
+    printf("base hex  timestamps absolute\n");
+    printf("internal events logged\n");
+    printf("Begin Triggerblock %s\n", stamp);
+    printf("   0.000000 Start of measurement\n");
+    for (const Frame &f : frames) {
+        uint64_t dt = f.timeUs - startUs;
+        char id[16];
+        snprintf(id, sizeof(id), f.extended ? "%Xx" : "%X", f.id);
+        printf("%4llu.%06llu 1  %-15s Rx   %c %u", (unsigned long long)(dt / 1000000), (unsigned long long)(dt % 1000000), id,
+               f.remote ? 'r' : 'd', f.dlc);
+        for (int i = 0; i < f.dlc; ++i) printf(" %02X", f.data[i]);
+        printf("\n");
+    }
+    printf("End TriggerBlock\n");
+}
+
+int main(int argc, char** argv) {
+    bool asc = false;
+    const char* iface = "can0";
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--asc") == 0) asc = true;
+        else if (strcmp(argv[i], "--iface") == 0 && i + 1 < argc) iface = argv[++i];
+        else files.push_back(argv[i]);
+    }
+    if (files.empty()) {
+        fprintf(stderr, "Usage: %s [--asc] [--iface can0] CAN_*.can [...] > out.log\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<Frame> frames;
+    bool ok = true;
+    for (const char* path : files) ok = readFile(path, frames) && ok;
+
+    if (asc) writeAsc(frames);
+    else writeCandump(frames, iface);
+    return ok ? 0 : 1;
+}
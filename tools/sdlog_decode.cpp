@@ -0,0 +1,158 @@
+// sdlog_decode - converts binary (LOG_*.bin) and compressed (LOG_*.lz) SD archives back to JSON lines
+//
+// Build (Linux): g++ -O2 -std=c++17 -o sdlog_decode sdlog_decode.cpp
+// Usage:         ./sdlog_decode LOG_20260101_120000.bin [more files...] > out.jsonl
+//
+// The field list is read from the schema frame in each file, so archives written by
+// older/newer firmware (different SENSOR_DATA_MAP) decode without rebuilding this tool.
+// Compressed blocks already hold the JSON lines and are written out as they are.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../main/LogFrame.h"
+#include "../main/ArchiveLz.h"
+#include "../main/ArchiveSchema.h"
+#include "../main/JsonFloat.h"
+
+struct Field {
+    uint8_t type;
+    std::string key;
+};
+
+static bool parseSchema(const uint8_t* p, size_t len, std::vector<Field> &fields) {
+    if (len < 6 || memcmp(p, "SDLB", 4) != 0 || p[4] != ARCHIVE_SCHEMA_VERSION) return false;
+    fields.clear();
+    size_t pos = 6;
+    for (int i = 0; i < p[5]; ++i) {
+        if (pos + 2 > len || pos + 2 + p[pos + 1] > len) return false;
+        Field f;
+        f.type = p[pos];
+        f.key.assign((const char*)p + pos + 2, p[pos + 1]);
+        pos += 2 + p[pos + 1];
+        fields.push_back(f);
+    }
+    return true;
+}
+
+// Prints all records of one frame. Returns number of records.
+static int decodeRecords(const uint8_t* p, size_t len, const std::vector<Field> &fields) {
+    std::vector<int64_t> prev(fields.size(), 0); // Keyframe: deltas against zero
+    size_t pos = 0;
+    int records = 0;
+    std::string line;
+
+    while (pos < len) {
+        line = "{";
+        for (size_t i = 0; i < fields.size(); ++i) {
+            const Field &f = fields[i];
+            int64_t v;
+            if (f.type == ARCHIVE_TYPE_U8 || f.type == ARCHIVE_TYPE_BOOL) {
+                if (pos >= len) return records;
+                v = p[pos++];
+            } else {
+                uint64_t raw;
+                if (!archiveGetVarint(p, len, pos, raw)) return records;
+                v = archiveUndelta(prev[i], archiveUnzigzag(raw));
+            }
+            prev[i] = v;
+
+            if (i) line += ',';
+            line += '"';
+            line += f.key;
+            line += "\":";
+
+            char buf[JSON_FLOAT_MAX_LENGTH];
+            double d;
+            float fl;
+            switch (f.type) {
+                case ARCHIVE_TYPE_U64: snprintf(buf, sizeof(buf), "%llu", (unsigned long long)v); line += buf; break;
+                case ARCHIVE_TYPE_INT:
+                case ARCHIVE_TYPE_U8:  snprintf(buf, sizeof(buf), "%lld", (long long)v); line += buf; break;
+                case ARCHIVE_TYPE_F64:
+                    archiveDequantize(v, d); // Same value as the firmware decodes (NaN for null)
+                    line.append(buf, jsonFormatFloat(buf, d, JSON_FLOAT_PLACES_DOUBLE));
+                    break;
+                case ARCHIVE_TYPE_F32:
+                    archiveDequantize(v, fl);
+                    line.append(buf, jsonFormatFloat(buf, fl, JSON_FLOAT_PLACES_FLOAT));
+                    break;
+                case ARCHIVE_TYPE_BOOL: line += v ? "true" : "false"; break;
+                default: line += "null"; break;
+            }
+        }
+        line += "}\r\n"; // Same line ending as File::println() on the device
+        fputs(line.c_str(), stdout);
+        records++;
+    }
+    return records;
+}
+
+// Prints the JSON lines of one compressed block. Returns number of records.
+static int decodeLzBlock(const uint8_t* p, size_t len) {
+    static uint8_t block[ARCHIVE_LZ_BLOCK_SIZE];
+    int n = archiveLzDecompress(p, len, block, sizeof(block));
+    if (n < 0) return 0;
+    fwrite(block, 1, n, stdout);
+
+    int records = 0;
+    for (int i = 0; i < n; ++i) {
+        if (block[i] == '\n') records++;
+    }
+    return records;
+}
+
+static bool decodeFile(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "[decode] Cannot open %s\n", path);
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+
+    std::vector<Field> fields;
+    size_t offset = 0;
+    int records = 0;
+    int skipped = 0;
+
+    while (offset + LOG_FRAME_HEADER_SIZE <= data.size()) {
+        LogFrameHeader hdr;
+        const uint8_t* payload = &data[offset + LOG_FRAME_HEADER_SIZE];
+        if (!logFrameDecodeHeader(&data[offset], hdr, ARCHIVE_LZ_MAX_OUTPUT) ||
+            offset + LOG_FRAME_HEADER_SIZE + hdr.length > data.size() || !logFrameVerify(hdr, payload)) {
+            offset++; // Resync on next frame
+            skipped++;
+            continue;
+        }
+        offset += LOG_FRAME_HEADER_SIZE + hdr.length;
+
+        if (hdr.flags == ARCHIVE_FRAME_SCHEMA) {
+            if (!parseSchema(payload, hdr.length, fields)) fprintf(stderr, "[decode] %s: unsupported schema\n", path);
+        } else if (hdr.flags == ARCHIVE_FRAME_RECORDS && !fields.empty()) {
+            records += decodeRecords(payload, hdr.length, fields);
+        } else if (hdr.flags == ARCHIVE_FRAME_LZ) {
+            records += decodeLzBlock(payload, hdr.length);
+        }
+    }
+
+    fprintf(stderr, "[decode] %s: %d records%s\n", path, records, skipped ? " (corrupted bytes skipped)" : "");
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s LOG_*.bin [...] > out.jsonl\n", argv[0]);
+        return 1;
+    }
+    bool ok = true;
+    for (int i = 1; i < argc; ++i) ok = decodeFile(argv[i]) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+// track_export - converts GPS track logs (TRK_*.trk) to CSV or GPX
+//
+// Build (Linux): g++ -O2 -std=c++17 -o track_export track_export.cpp
+// Usage:         ./track_export [--gpx] TRK_20260101_120000.trk [more files...] > track.csv
+//
+// Default output is CSV (time_ms,lat,lon,alt_m,speed_kmh,course_deg,satellites,hdop), --gpx writes
+// a GPX 1.1 track. A summary with the fix count, the median fix interval and every gap longer than
+// 1.5 intervals goes to stderr - no gaps means no fix was lost between receiver and SD.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "../main/LogFrame.h"
+#include "../main/GpsTrack.h"
+
+static uint64_t getLe(const uint8_t* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+// Appends the fixes of one block. Returns false if the block is truncated.
+static bool decodeBlock(const uint8_t* p, size_t len, std::vector<GpsTrackFix> &fixes) {
+    if (len < GPS_TRACK_BLOCK_HEADER || (len - GPS_TRACK_BLOCK_HEADER) % GPS_TRACK_RECORD_SIZE) return false;
+    uint64_t base = getLe(p, 8);
+    for (size_t pos = GPS_TRACK_BLOCK_HEADER; pos < len; pos += GPS_TRACK_RECORD_SIZE) {
+        GpsTrackFix f = {};
+        f.timeMs = base + getLe(p + pos, 4);
+        f.lat = (int32_t)getLe(p + pos + 4, 4);
+        f.lon = (int32_t)getLe(p + pos + 8, 4);
+        f.altCm = (int32_t)getLe(p + pos + 12, 4);
+        f.speedCms = (uint16_t)getLe(p + pos + 16, 2);
+        f.courseCdeg = (uint16_t)getLe(p + pos + 18, 2);
+        f.satellites = p[pos + 20];
+        f.hdopDm = p[pos + 21];
+        fixes.push_back(f);
+    }
+    return true;
+}
+
+static bool readFile(const char* path, std::vector<GpsTrackFix> &fixes) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "[export] Cannot open %s\n", path);
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+
+    size_t offset = 0;
+    size_t before = fixes.size();
+    int skipped = 0;
+    while (offset + LOG_FRAME_HEADER_SIZE <= data.size()) {
+        LogFrameHeader hdr;
+        const uint8_t* payload = &data[offset + LOG_FRAME_HEADER_SIZE];
+        if (!logFrameDecodeHeader(&data[offset], hdr, GPS_TRACK_BLOCK_SIZE) ||
+            offset + LOG_FRAME_HEADER_SIZE + hdr.length > data.size() || !logFrameVerify(hdr, payload)) {
+            offset++; // Resync on next frame
+            skipped++;
+            continue;
+        }
+        offset += LOG_FRAME_HEADER_SIZE + hdr.length;
+        if (hdr.flags == GPS_TRACK_FRAME_BLOCK && !decodeBlock(payload, hdr.length, fixes)) skipped++;
+    }
+
+    fprintf(stderr, "[export] %s: %zu fixes%s\n", path, fixes.size() - before, skipped ? " (corrupted bytes skipped)" : "");
+    return true;
+}
+
+// Fix count, median interval and gaps (> 1.5 intervals) to stderr. Returns the number of gaps.
+static int reportGaps(const std::vector<GpsTrackFix> &fixes) {
+    if (fixes.size() < 2) {
+        fprintf(stderr, "[export] %zu fixes\n", fixes.size());
+        return 0;
+    }
+    std::vector<uint64_t> dts;
+    for (size_t i = 1; i < fixes.size(); ++i) dts.push_back(fixes[i].timeMs - fixes[i - 1].timeMs);
+    std::vector<uint64_t> sorted = dts;
+    std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+    uint64_t median = sorted[sorted.size() / 2];
+
+    int gaps = 0;
+    uint64_t missing = 0;
+    for (size_t i = 0; i < dts.size(); ++i) {
+        if (median == 0 || dts[i] * 2 <= median * 3) continue;
+        gaps++;
+        missing += dts[i] / median - 1;
+        if (gaps <= 20) fprintf(stderr, "[export] Gap of %llu ms after %llu\n", (unsigned long long)dts[i], (unsigned long long)fixes[i].timeMs);
+    }
+    fprintf(stderr, "[export] %zu fixes, interval %llu ms, %d gaps (~%llu fixes missing)\n", fixes.size(), (unsigned long long)median, gaps,
+            (unsigned long long)missing);
+    return gaps;
+}
+
+static void writeCsv(const std::vector<GpsTrackFix> &fixes) {
+    printf("time_ms,lat,lon,alt_m,speed_kmh,course_deg,satellites,hdop\n");
+    for (const GpsTrackFix &f : fixes) {
+        printf("%llu,%.7f,%.7f,%.2f,%.2f,%.2f,%u,%.1f\n", (unsigned long long)f.timeMs, f.lat / 1e7, f.lon / 1e7, f.altCm / 100.0,
+               f.speedCms * 0.036, f.courseCdeg / 100.0, f.satellites, f.hdopDm / 10.0);
+    }
+}
+
+static void writeGpx(const std::vector<GpsTrackFix> &fixes) {
+    printf("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    printf("<gpx version=\"1.1\" creator=\"track_export\" xmlns=\"http://www.topografix.com/GPX/1/1\">\n");
+    printf("<trk><trkseg>\n");
+    for (const GpsTrackFix &f : fixes) {
+        time_t sec = (time_t)(f.timeMs / 1000);
+        struct tm t;
+        gmtime_r(&sec, &t);
+        char stamp[32];
+        strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &t);
+        printf("<trkpt lat=\"%.7f\" lon=\"%.7f\"><ele>%.2f</ele><time>%s.%03uZ</time><course>%.2f</course><speed>%.2f</speed>"
+               "<sat>%u</sat><hdop>%.1f</hdop></trkpt>\n",
+               f.lat / 1e7, f.lon / 1e7, f.altCm / 100.0, stamp, (unsigned)(f.timeMs % 1000), f.courseCdeg / 100.0, f.speedCms / 100.0,
+               f.satellites, f.hdopDm / 10.0);
+    }
+    printf("</trkseg></trk>\n</gpx>\n");
+}
+
+int main(int argc, char** argv) {
+    bool gpx = false;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--gpx") == 0) gpx = true;
+        else files.push_back(argv[i]);
+    }
+    if (files.empty()) {
+        fprintf(stderr, "Usage: %s [--gpx] TRK_*.trk [...] > track.csv\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<GpsTrackFix> fixes;
+    bool ok = true;
+    for (const char* path : files) ok = readFile(path, fixes) && ok;
+    reportGaps(fixes);
+
+    if (gpx) writeGpx(fixes);
+    else writeCsv(fixes);
+    return ok ? 0 : 1;
+}